@@ -0,0 +1,88 @@
+#include "DNSCache.h"
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 多线程缓存命中吞吐测试：对比单分片（全局锁）与多分片在不同线程数下的表现
+namespace {
+    constexpr size_t HOSTNAME_COUNT = 5000;
+    constexpr auto RUN_DURATION = std::chrono::milliseconds(500);
+
+    double runHits(DNSCache &cache, const std::vector<std::string> &hostnames, unsigned threads) {
+        std::atomic<bool> start{false};
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> total{0};
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                DNSAddressList ips;
+                uint64_t count = 0;
+                size_t index = t * 7919;
+                while (!start) {
+                    std::this_thread::yield();
+                }
+                while (!stop) {
+                    // 每检查一次停止标志执行一批查询，减少原子操作开销
+                    for (int i = 0; i < 256; ++i) {
+                        cache.get(hostnames[index++ % hostnames.size()], ips);
+                    }
+                    count += 256;
+                }
+                total += count;
+            });
+        }
+
+        const auto begin = std::chrono::steady_clock::now();
+        start = true;
+        std::this_thread::sleep_for(RUN_DURATION);
+        stop = true;
+        for (auto &worker: workers) {
+            worker.join();
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        return static_cast<double>(total) / elapsed;
+    }
+}// namespace
+
+int main(int argc, char *argv[]) {
+    const unsigned max_threads = argc > 1 ? std::stoul(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+    const size_t shards = argc > 2 ? std::stoul(argv[2]) : DNSCache::DEFAULT_SHARD_COUNT;
+
+    std::vector<std::string> hostnames;
+    hostnames.reserve(HOSTNAME_COUNT);
+    for (size_t i = 0; i < HOSTNAME_COUNT; ++i) {
+        hostnames.push_back("host-" + std::to_string(i) + ".bench.example.com");
+    }
+
+    DNSCache global_lock_cache(std::chrono::seconds(3600), 1);
+    DNSCache sharded_cache(std::chrono::seconds(3600), shards);
+    for (const auto &hostname: hostnames) {
+        global_lock_cache.update(hostname, {"10.0.0.1", "10.0.0.2"});
+        sharded_cache.update(hostname, {"10.0.0.1", "10.0.0.2"});
+    }
+
+    std::cout << "DNSCache hit throughput (million gets/s)\n"
+              << std::left << std::setw(10) << "threads"
+              << std::setw(14) << "1 shard"
+              << std::setw(14) << (std::to_string(sharded_cache.shard_count()) + " shards")
+              << "speedup" << std::endl;
+
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        const double single = runHits(global_lock_cache, hostnames, threads) / 1e6;
+        const double sharded = runHits(sharded_cache, hostnames, threads) / 1e6;
+        std::cout << std::left << std::setw(10) << threads
+                  << std::setw(14) << std::fixed << std::setprecision(2) << single
+                  << std::setw(14) << sharded
+                  << std::setprecision(2) << sharded / single << "x" << std::endl;
+        if (threads * 2 > max_threads && threads != max_threads) {
+            threads = max_threads / 2;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "DNSResolver.h"
+#include "FakeDNSServer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+
+// 未命中路径的分配次数测试：本地UDP应答器对每个A查询返回一条记录，
+// 统计每次未命中（从resolve_async到回调完成，包括c-ares内部与缓存写入）平均调用operator new的次数
+namespace {
+    std::atomic<uint64_t> g_allocations{0};
+
+    constexpr size_t WARMUP_QUERIES = 2000;
+    constexpr size_t MEASURED_QUERIES = 20000;
+    constexpr size_t WINDOW = 256;
+
+    // 以固定窗口发出count个互不相同的未命中查询，返回耗时
+    std::chrono::nanoseconds runMisses(DNSResolver &resolver, size_t first, size_t count) {
+        std::atomic<size_t> done{0};
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i += WINDOW) {
+            const size_t batch = std::min(WINDOW, count - i);
+            const size_t target = done.load() + batch;
+            for (size_t k = 0; k < batch; ++k) {
+                resolver.resolve_async("miss-" + std::to_string(first + i + k) + ".bench.example",
+                                       [&done](const DNSResolver::ResolveResult &) { done.fetch_add(1); });
+            }
+            while (done.load() < target) {
+                std::this_thread::yield();
+            }
+        }
+        return std::chrono::steady_clock::now() - start;
+    }
+}// namespace
+
+void *operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+int main() {
+    auto resolver = std::make_shared<DNSResolver>();
+    FakeDNSServer responder;
+
+    CacheConfig cache_config = DNSResolverConfig().cache();
+    cache_config.max_size = WARMUP_QUERIES + MEASURED_QUERIES;
+    cache_config.prefetch_enabled = false;
+    if (!resolver->init({responder.address()}, cache_config)) {
+        std::cerr << "Failed to initialize resolver" << std::endl;
+        return 1;
+    }
+
+    // 预热：让对象池、c-ares内部结构与缓存分片达到稳定状态
+    runMisses(*resolver, 0, WARMUP_QUERIES);
+
+    const auto before = g_allocations.load();
+    const auto elapsed = runMisses(*resolver, WARMUP_QUERIES, MEASURED_QUERIES);
+    const auto allocations = g_allocations.load() - before;
+
+    std::cout << "Cache miss path (" << MEASURED_QUERIES << " queries, window " << WINDOW << ")\n"
+              << std::fixed << std::setprecision(2)
+              << "allocations/query: " << static_cast<double>(allocations) / MEASURED_QUERIES << "\n"
+              << "us/query:          "
+              << std::chrono::duration<double, std::micro>(elapsed).count() / MEASURED_QUERIES << std::endl;
+    return 0;
+}
@@ -0,0 +1,371 @@
+#include "DNSCache.h"
+#include "DNSCachePersistor.h"
+#include "DNSMetrics.h"
+#include "DNSMetricsPrimitives.h"
+#include "DNSResolver.h"
+#include "FakeDNSServer.h"
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+// 解析器、缓存、持久化与指标的基准测试（Google Benchmark）
+// 端到端测试使用进程内的FakeDNSServer，不依赖外部网络，结果可离线复现。
+// 运行示例：dns_resolver_bench --benchmark_filter=Cache --benchmark_min_time=1
+namespace {
+    constexpr size_t CACHE_HOSTNAMES = 10000;
+
+    std::string benchHostname(size_t i) {
+        return "host-" + std::to_string(i) + ".bench.example.com";
+    }
+
+    const std::vector<std::string> &cacheHostnames() {
+        static const std::vector<std::string> hostnames = [] {
+            std::vector<std::string> names;
+            names.reserve(CACHE_HOSTNAMES);
+            for (size_t i = 0; i < CACHE_HOSTNAMES; ++i) {
+                names.push_back(benchHostname(i));
+            }
+            return names;
+        }();
+        return hostnames;
+    }
+
+    // 按分片数建立的预热缓存，同一配置的所有线程共用
+    DNSCache &sharedCache(size_t shard_count) {
+        static std::mutex mutex;
+        static std::vector<std::pair<size_t, std::unique_ptr<DNSCache>>> caches;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &[shards, cache]: caches) {
+            if (shards == shard_count) {
+                return *cache;
+            }
+        }
+        auto cache = std::make_unique<DNSCache>(std::chrono::seconds(3600), shard_count, CACHE_HOSTNAMES * 2);
+        for (const auto &hostname: cacheHostnames()) {
+            cache->update(hostname, std::vector<std::string>{"10.0.0.1", "10.0.0.2"});
+        }
+        caches.emplace_back(shard_count, std::move(cache));
+        return *caches.back().second;
+    }
+
+    // 每个线程从不同位置开始遍历，避免所有线程同时访问同一分片
+    size_t threadOffset(const benchmark::State &state) {
+        return static_cast<size_t>(state.thread_index()) * 7919;
+    }
+
+    void BM_CacheGet(benchmark::State &state) {
+        auto &cache = sharedCache(static_cast<size_t>(state.range(0)));
+        const auto &hostnames = cacheHostnames();
+        DNSAddressList ips;
+        size_t index = threadOffset(state);
+        for (auto _: state) {
+            benchmark::DoNotOptimize(cache.get(hostnames[index++ % hostnames.size()], ips));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_CacheGet)->Arg(1)->Arg(16)->ThreadRange(1, 16)->UseRealTime();
+
+    // 只取得只读记录的引用，不复制地址
+    void BM_CacheFind(benchmark::State &state) {
+        auto &cache = sharedCache(static_cast<size_t>(state.range(0)));
+        const auto &hostnames = cacheHostnames();
+        size_t index = threadOffset(state);
+        for (auto _: state) {
+            const std::string_view hostname = hostnames[index++ % hostnames.size()];
+            benchmark::DoNotOptimize(cache.find(hostname));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_CacheFind)->Arg(1)->Arg(16)->ThreadRange(1, 16)->UseRealTime();
+
+    void BM_CacheUpdate(benchmark::State &state) {
+        auto &cache = sharedCache(static_cast<size_t>(state.range(0)));
+        const auto &hostnames = cacheHostnames();
+        const auto ips = DNSAddressList::fromStrings({"10.0.0.1", "10.0.0.2"});
+        size_t index = threadOffset(state);
+        for (auto _: state) {
+            cache.update(hostnames[index++ % hostnames.size()], ips);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_CacheUpdate)->Arg(1)->Arg(16)->ThreadRange(1, 16)->UseRealTime();
+
+    // 读多写少的混合负载：每16次查找写入一次
+    void BM_CacheMixed(benchmark::State &state) {
+        auto &cache = sharedCache(static_cast<size_t>(state.range(0)));
+        const auto &hostnames = cacheHostnames();
+        const auto ips = DNSAddressList::fromStrings({"10.0.0.1", "10.0.0.2"});
+        DNSAddressList out;
+        size_t index = threadOffset(state);
+        for (auto _: state) {
+            const auto &hostname = hostnames[index++ % hostnames.size()];
+            if ((index & 15) == 0) {
+                cache.update(hostname, ips);
+            } else {
+                benchmark::DoNotOptimize(cache.get(hostname, out));
+            }
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_CacheMixed)->Arg(16)->ThreadRange(1, 16)->UseRealTime();
+
+    // 堆上已分配的字节数，用于计算每条记录的内存占用；非glibc平台返回0
+    size_t heapInUse() {
+#if defined(__GLIBC__)
+        return mallinfo2().uordblks;
+#else
+        return 0;
+#endif
+    }
+
+    // 大规模缓存：state.range(0)为记录数，按大步长访问以模拟实际负载中分散的热点
+    void BM_CacheFindLarge(benchmark::State &state) {
+        const auto entries = static_cast<size_t>(state.range(0));
+        std::vector<std::string> hostnames;
+        hostnames.reserve(entries);
+        for (size_t i = 0; i < entries; ++i) {
+            hostnames.push_back(benchHostname(i));
+        }
+        const auto ips = DNSAddressList::fromStrings({"10.0.0.1", "2001:db8::1"});
+        const size_t heap_before = heapInUse();
+        auto cache = std::make_unique<DNSCache>(std::chrono::seconds(3600), DNSCache::DEFAULT_SHARD_COUNT, entries);
+        for (const auto &hostname: hostnames) {
+            cache->update(hostname, ips);
+        }
+        const size_t heap_after = heapInUse();
+
+        size_t index = 0;
+        for (auto _: state) {
+            index = (index + 104729) % entries;
+            benchmark::DoNotOptimize(cache->find(std::string_view(hostnames[index])));
+        }
+        state.SetItemsProcessed(state.iterations());
+        // 包括记录本身（主机名与地址）的全部堆内存
+        state.counters["bytes_per_entry"] =
+                static_cast<double>(heap_after - heap_before) / static_cast<double>(entries);
+    }
+    BENCHMARK(BM_CacheFindLarge)->Arg(100000)->Arg(1000000)->Arg(2000000)->ArgName("entries");
+
+    // 持久化：state.range(0)为记录数，state.range(1)为格式（0二进制，1 JSON）
+    std::unique_ptr<DNSCache> filledCache(size_t entries) {
+        auto cache = std::make_unique<DNSCache>(std::chrono::seconds(3600), DNSCache::DEFAULT_SHARD_COUNT, entries);
+        const auto ips = DNSAddressList::fromStrings({"10.0.0.1", "2001:db8::1"});
+        for (size_t i = 0; i < entries; ++i) {
+            cache->update(benchHostname(i), ips);
+        }
+        return cache;
+    }
+
+    std::string snapshotPath(size_t entries, DNSCachePersistor::Format format) {
+        const auto name = "dns_resolver_bench_" + std::to_string(entries) +
+                          (format == DNSCachePersistor::Format::Json ? ".json" : ".bin");
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    DNSCachePersistor::Format snapshotFormat(const benchmark::State &state) {
+        return state.range(1) == 0 ? DNSCachePersistor::Format::Binary : DNSCachePersistor::Format::Json;
+    }
+
+    void BM_PersistorSave(benchmark::State &state) {
+        const auto entries = static_cast<size_t>(state.range(0));
+        const auto format = snapshotFormat(state);
+        const auto cache = filledCache(entries);
+        const auto path = snapshotPath(entries, format);
+        for (auto _: state) {
+            if (!DNSCachePersistor::save(*cache, path, format)) {
+                state.SkipWithError("save failed");
+                break;
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(entries));
+        state.counters["bytes"] = static_cast<double>(std::filesystem::file_size(path));
+        std::filesystem::remove(path);
+    }
+    BENCHMARK(BM_PersistorSave)
+            ->ArgsProduct({{10000, 1000000}, {0, 1}})
+            ->ArgNames({"entries", "json"})
+            ->Unit(benchmark::kMillisecond);
+
+    void BM_PersistorLoad(benchmark::State &state) {
+        const auto entries = static_cast<size_t>(state.range(0));
+        const auto format = snapshotFormat(state);
+        const auto path = snapshotPath(entries, format);
+        if (!DNSCachePersistor::save(*filledCache(entries), path, format)) {
+            state.SkipWithError("save failed");
+            return;
+        }
+        for (auto _: state) {
+            state.PauseTiming();
+            auto cache = std::make_unique<DNSCache>(std::chrono::seconds(3600), DNSCache::DEFAULT_SHARD_COUNT, entries);
+            state.ResumeTiming();
+            if (!DNSCachePersistor::load(*cache, path)) {
+                state.SkipWithError("load failed");
+                break;
+            }
+            state.PauseTiming();
+            cache.reset();
+            state.ResumeTiming();
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(entries));
+        std::filesystem::remove(path);
+    }
+    BENCHMARK(BM_PersistorLoad)
+            ->ArgsProduct({{10000, 1000000}, {0, 1}})
+            ->ArgNames({"entries", "json"})
+            ->Unit(benchmark::kMillisecond);
+
+    void BM_MetricsRecordQuery(benchmark::State &state) {
+        static DNSMetrics metrics;
+        const std::string &hostname = cacheHostnames()[static_cast<size_t>(state.thread_index())];
+        int64_t i = 0;
+        for (auto _: state) {
+            ++i;
+            metrics.recordQuery(hostname, std::chrono::milliseconds(i & 63), (i & 31) != 0);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_MetricsRecordQuery)->ThreadRange(1, 16)->UseRealTime();
+
+    // 端到端：解析器连接进程内的FakeDNSServer，每个查询使用新的主机名以保证未命中
+    struct ResolverFixture {
+        FakeDNSServer server;
+        std::shared_ptr<DNSResolver> resolver = std::make_shared<DNSResolver>();
+        std::atomic<uint64_t> next_name{0};
+
+        ResolverFixture() {
+            CacheConfig cache_config = DNSResolverConfig().cache();
+            cache_config.max_size = 100000;
+            cache_config.prefetch_enabled = false;
+            if (!resolver->init({server.address()}, cache_config)) {
+                resolver.reset();
+            }
+        }
+
+        std::string missHostname() {
+            return "miss-" + std::to_string(next_name.fetch_add(1, std::memory_order_relaxed)) + ".bench.example";
+        }
+    };
+
+    ResolverFixture &resolverFixture() {
+        static ResolverFixture fixture;
+        return fixture;
+    }
+
+    // resolve_batch吞吐：state.range(0)为每批查询数，state.range(1)为窗口大小
+    void BM_ResolveBatch(benchmark::State &state) {
+        auto &fixture = resolverFixture();
+        if (!fixture.resolver) {
+            state.SkipWithError("resolver initialization failed");
+            return;
+        }
+        const auto count = static_cast<size_t>(state.range(0));
+        const auto window = static_cast<size_t>(state.range(1));
+        std::vector<std::string> hostnames(count);
+        int64_t failures = 0;
+        for (auto _: state) {
+            state.PauseTiming();
+            for (auto &hostname: hostnames) {
+                hostname = fixture.missHostname();
+            }
+            state.ResumeTiming();
+            auto futures = fixture.resolver->resolve_batch(hostnames, window);
+            for (auto &future: futures) {
+                if (future.get().status != ARES_SUCCESS) {
+                    ++failures;
+                }
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+        state.counters["failures"] = static_cast<double>(failures);
+    }
+    BENCHMARK(BM_ResolveBatch)
+            ->Args({1000, 64})
+            ->Args({1000, 256})
+            ->Args({10000, 256})
+            ->ArgNames({"queries", "window"})
+            ->Unit(benchmark::kMillisecond)
+            ->UseRealTime();
+
+    // 未命中延迟分布：保持state.range(0)个查询在途，记录每个查询从发出到回调的时间
+    void BM_ResolveLatency(benchmark::State &state) {
+        auto &fixture = resolverFixture();
+        if (!fixture.resolver) {
+            state.SkipWithError("resolver initialization failed");
+            return;
+        }
+        constexpr size_t QUERIES_PER_ITERATION = 1000;
+        const auto window = static_cast<size_t>(state.range(0));
+        DNSLatencyHistogram histogram;
+        std::mutex mutex;
+        std::condition_variable cv;
+
+        for (auto _: state) {
+            size_t in_flight = 0;
+            size_t done = 0;
+            for (size_t i = 0; i < QUERIES_PER_ITERATION; ++i) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&] { return in_flight < window; });
+                    ++in_flight;
+                }
+                const auto start = std::chrono::steady_clock::now();
+                fixture.resolver->resolve_async(fixture.missHostname(), [&, start](const DNSResolver::ResolveResult &) {
+                    histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - start));
+                    std::lock_guard<std::mutex> lock(mutex);
+                    --in_flight;
+                    ++done;
+                    cv.notify_one();
+                });
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return done == QUERIES_PER_ITERATION; });
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(QUERIES_PER_ITERATION));
+        state.counters["p50_us"] = static_cast<double>(histogram.percentile(0.50).count());
+        state.counters["p99_us"] = static_cast<double>(histogram.percentile(0.99).count());
+        state.counters["p999_us"] = static_cast<double>(histogram.percentile(0.999).count());
+    }
+    BENCHMARK(BM_ResolveLatency)->Arg(1)->Arg(16)->Arg(256)->ArgName("window")->Unit(benchmark::kMillisecond)->UseRealTime();
+
+    // 命中路径：对同一批主机名反复解析，回调在调用线程内联执行
+    void BM_ResolveCached(benchmark::State &state) {
+        auto &fixture = resolverFixture();
+        if (!fixture.resolver) {
+            state.SkipWithError("resolver initialization failed");
+            return;
+        }
+        static const std::vector<std::string> hostnames = [&fixture] {
+            std::vector<std::string> names;
+            for (size_t i = 0; i < 1000; ++i) {
+                names.push_back(fixture.missHostname());
+            }
+            for (auto &future: fixture.resolver->resolve_batch(names, 256)) {
+                future.wait();
+            }
+            return names;
+        }();
+        size_t index = threadOffset(state);
+        for (auto _: state) {
+            fixture.resolver->resolve_async(hostnames[index++ % hostnames.size()],
+                                            [](const DNSResolver::ResolveResult &result) {
+                                                benchmark::DoNotOptimize(result.status);
+                                            });
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_ResolveCached)->ThreadRange(1, 16)->UseRealTime();
+}// namespace
+
+BENCHMARK_MAIN();
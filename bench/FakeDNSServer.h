@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// 基准测试用的本地UDP应答器
+// 监听127.0.0.1的随机端口，原样返回问题段，A查询追加一条10.0.0.1（TTL 300）的记录，其他类型返回空应答。
+// 应答路径不做任何堆分配，结果可离线复现。
+class FakeDNSServer {
+public:
+#if defined(_WIN32)
+    using socket_t = SOCKET;
+#else
+    using socket_t = int;
+#endif
+
+    FakeDNSServer() {
+        socket_ = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(socket_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+        socklen_t len = sizeof(addr);
+        ::getsockname(socket_, reinterpret_cast<sockaddr *>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+#if defined(_WIN32)
+        DWORD timeout = 100;
+#else
+        timeval timeout{0, 100000};
+#endif
+        ::setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char *>(&timeout), sizeof(timeout));
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~FakeDNSServer() {
+        running_ = false;
+        thread_.join();
+#if defined(_WIN32)
+        closesocket(socket_);
+#else
+        ::close(socket_);
+#endif
+    }
+
+    FakeDNSServer(const FakeDNSServer &) = delete;
+    FakeDNSServer &operator=(const FakeDNSServer &) = delete;
+
+    [[nodiscard]] std::string address() const { return "127.0.0.1:" + std::to_string(port_); }
+    [[nodiscard]] uint64_t answered() const { return answered_.load(std::memory_order_relaxed); }
+
+private:
+    void run() {
+        unsigned char buf[512];
+        while (running_) {
+            sockaddr_storage peer{};
+            socklen_t peer_len = sizeof(peer);
+            const auto n = ::recvfrom(socket_, reinterpret_cast<char *>(buf), 400, 0,
+                                      reinterpret_cast<sockaddr *>(&peer), &peer_len);
+            if (n < 12) {
+                continue;
+            }
+            size_t len = static_cast<size_t>(n);
+            // 去掉EDNS等附加段，只保留问题段
+            size_t pos = 12;
+            while (pos < len && buf[pos] != 0) {
+                pos += buf[pos] + 1;
+            }
+            pos += 5;
+            if (pos > len) {
+                continue;
+            }
+            const bool is_a = buf[pos - 4] == 0 && buf[pos - 3] == 1;
+            len = pos;
+            buf[2] = 0x81;
+            buf[3] = 0x80;
+            buf[6] = 0;
+            buf[7] = is_a ? 1 : 0;
+            std::memset(buf + 8, 0, 4);
+            if (is_a) {
+                const unsigned char answer[] = {0xC0, 0x0C, 0, 1, 0, 1, 0, 0, 0x01, 0x2C, 0, 4, 10, 0, 0, 1};
+                std::memcpy(buf + len, answer, sizeof(answer));
+                len += sizeof(answer);
+            }
+            ::sendto(socket_, reinterpret_cast<const char *>(buf), static_cast<int>(len), 0,
+                     reinterpret_cast<sockaddr *>(&peer), peer_len);
+            answered_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    socket_t socket_{};
+    uint16_t port_{};
+    std::atomic<bool> running_{true};
+    std::atomic<uint64_t> answered_{0};
+    std::thread thread_{};
+};
@@ -5,12 +5,13 @@
 #include <future>
 #include <iomanip>
 #include <iostream>
+#include <latch>
 #include <thread>
 #include <vector>
 
 // 打印查询结果
 void printResult(const std::string &hostname,
-                 const std::vector<std::string> &addresses,
+                 const DNSAddressList &addresses,
                  std::chrono::milliseconds duration) {
     std::cout << "Hostname: " << std::left << std::setw(30) << hostname;
     std::cout << " Status: ";
@@ -27,6 +28,24 @@ void printResult(const std::string &hostname,
     std::cout << " (took " << duration.count() << "ms)" << std::endl;
 }
 
+// 最简单的即发即弃协程类型，仅用于演示co_await接口
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+DetachedTask resolveWithCoroutine(DNSResolver &resolver, const std::string &hostname, std::latch &done) {
+    // 命中缓存时不会挂起，也不会分配promise/future
+    auto result = co_await resolver.resolve_co(hostname);
+    printResult(hostname, result.ip_addresses, result.resolution_time);
+    done.count_down();
+}
+
 int main(int argc, char *argv[]) {
     try {
         // 创建DNS配置
@@ -83,15 +102,11 @@ int main(int argc, char *argv[]) {
         // 启动异步查询
         std::vector<std::future<DNSResolver::ResolveResult>> futures = resolver->resolve_batch(domains);
 
-        // 等待并处理结果
+        // 等待并处理结果：耗时取解析器记录的解析时间，get()的等待时间会受前面查询的影响
         for (size_t i = 0; i < domains.size(); ++i) {
             try {
-                auto query_start = std::chrono::steady_clock::now();
-                auto addresses = futures[i].get();
-                auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        std::chrono::steady_clock::now() - query_start);
-
-                printResult(domains[i], addresses.ip_addresses, duration);
+                auto result = futures[i].get();
+                printResult(domains[i], result.ip_addresses, result.resolution_time);
 
             } catch (const std::exception &e) {
                 std::cout << "Error resolving " << domains[i]
@@ -106,6 +121,25 @@ int main(int argc, char *argv[]) {
         std::cout << "\nBatch resolution completed in "
                   << total_duration.count() << "ms" << std::endl;
 
+        // 回调接口：结果已在缓存中，回调在当前线程内联执行
+        std::cout << "\nResolving again with callbacks:" << std::endl;
+        std::latch callbacks_done(static_cast<std::ptrdiff_t>(domains.size()));
+        for (const auto &domain: domains) {
+            resolver->resolve_async(domain, [&callbacks_done](const DNSResolver::ResolveResult &result) {
+                printResult(result.hostname, result.ip_addresses, result.resolution_time);
+                callbacks_done.count_down();
+            });
+        }
+        callbacks_done.wait();
+
+        // 协程接口
+        std::cout << "\nResolving again with coroutines:" << std::endl;
+        std::latch coroutines_done(static_cast<std::ptrdiff_t>(domains.size()));
+        for (const auto &domain: domains) {
+            resolveWithCoroutine(*resolver, domain, coroutines_done);
+        }
+        coroutines_done.wait();
+
         auto stats = resolver->getStats();
 
         // 输出缓存和性能统计
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+// 紧凑的IP地址：以二进制形式保存in_addr/in6_addr及地址族，可平凡复制，不涉及堆分配。
+// 字符串形式只在调用toString()时才生成。
+class DNSAddress {
+public:
+    DNSAddress() = default;
+    explicit DNSAddress(const in_addr &addr);
+    explicit DNSAddress(const in6_addr &addr);
+
+    // 解析文本形式的IPv4/IPv6地址
+    static std::optional<DNSAddress> parse(std::string_view text);
+    // 从AF_INET/AF_INET6的sockaddr中取出地址
+    static std::optional<DNSAddress> fromSockaddr(const sockaddr *addr);
+
+    // AF_INET、AF_INET6，空地址为AF_UNSPEC
+    [[nodiscard]] int family() const { return family_; }
+    [[nodiscard]] bool isV4() const { return family_ == AF_INET; }
+    [[nodiscard]] bool isV6() const { return family_ == AF_INET6; }
+    [[nodiscard]] const in_addr &v4() const { return addr_.v4; }
+    [[nodiscard]] const in6_addr &v6() const { return addr_.v6; }
+
+    // 网络字节序的原始地址（4或16字节）
+    [[nodiscard]] const unsigned char *data() const { return reinterpret_cast<const unsigned char *>(&addr_); }
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] std::string toString() const;
+    // 填充可直接用于connect()等调用的sockaddr，返回有效长度（空地址返回0）
+    socklen_t toSockaddr(sockaddr_storage &out, uint16_t port = 0) const;
+
+    bool operator==(const DNSAddress &other) const;
+    bool operator!=(const DNSAddress &other) const { return !(*this == other); }
+
+private:
+    union {
+        in_addr v4;
+        in6_addr v6;
+    } addr_{};
+    uint8_t family_{AF_UNSPEC};
+};
+
+std::ostream &operator<<(std::ostream &os, const DNSAddress &address);
+
+// 地址列表：少量地址内联存放（大多数应答不超过INLINE_CAPACITY个），超出时才使用堆内存
+class DNSAddressList {
+public:
+    static constexpr size_t INLINE_CAPACITY = 4;
+
+    DNSAddressList() = default;
+    DNSAddressList(std::initializer_list<DNSAddress> addresses);
+    DNSAddressList(const DNSAddressList &other);
+    DNSAddressList(DNSAddressList &&other) noexcept;
+    DNSAddressList &operator=(const DNSAddressList &other);
+    DNSAddressList &operator=(DNSAddressList &&other) noexcept;
+    ~DNSAddressList() = default;
+
+    // 从文本地址转换，无法解析的地址被忽略
+    static DNSAddressList fromStrings(const std::vector<std::string> &addresses);
+    [[nodiscard]] std::vector<std::string> toStrings() const;
+
+    void push_back(const DNSAddress &address);
+    void reserve(size_t capacity);
+    void clear() { size_ = 0; }
+
+    [[nodiscard]] size_t size() const { return size_; }
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+    [[nodiscard]] const DNSAddress *data() const { return heap_ ? heap_.get() : inline_; }
+    [[nodiscard]] const DNSAddress *begin() const { return data(); }
+    [[nodiscard]] const DNSAddress *end() const { return data() + size_; }
+    [[nodiscard]] const DNSAddress &operator[](size_t index) const { return data()[index]; }
+
+    bool operator==(const DNSAddressList &other) const;
+    bool operator!=(const DNSAddressList &other) const { return !(*this == other); }
+
+private:
+    DNSAddress *mutableData() { return heap_ ? heap_.get() : inline_; }
+
+    DNSAddress inline_[INLINE_CAPACITY]{};
+    std::unique_ptr<DNSAddress[]> heap_{};
+    uint32_t size_{0};
+    uint32_t capacity_{INLINE_CAPACITY};
+};
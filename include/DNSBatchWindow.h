@@ -0,0 +1,27 @@
+#pragma once
+
+#include "DNSResolver.h"
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+
+// 批量解析的滑动窗口
+// 始终保持最多limit个查询在途，每完成一个立即补充下一个，单个慢查询只占用一个槽位而不会阻塞整批。
+class DNSBatchWindow {
+public:
+    using ResolveResult = DNSResolver::ResolveResult;
+    using ResolveCallback = DNSResolver::ResolveCallback;
+    using HostnameSource = DNSResolver::HostnameSource;
+    // 发起一次解析（DNSResolver::resolve_async或DNSResolverPool::resolve_async）
+    using ResolveFn = std::function<void(const std::string &hostname, ResolveCallback callback)>;
+
+    // 非阻塞：立即返回与输入顺序一致的future，后续查询由完成回调驱动发出
+    static std::vector<std::future<ResolveResult>> batch(const ResolveFn &resolve_fn,
+                                                         const std::vector<std::string> &hostnames,
+                                                         size_t limit);
+
+    // 阻塞：在调用线程中按需从source读取主机名，结果按完成顺序串行回调，全部完成后返回
+    static void stream(const ResolveFn &resolve_fn, const HostnameSource &source,
+                       const ResolveCallback &on_result, size_t limit);
+};
@@ -1,50 +1,249 @@
 #pragma once
 
+#include "DNSAddress.h"
+#include "DNSConfig.h"
+#include "DNSFlatIndex.h"
+#include "DNSHostname.h"
+#include "DNSRecordTypes.h"
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <nlohmann/json.hpp>
+#include <shared_mutex>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+// 否定应答（RFC 2308）：NXDomain表示名字不存在，NoData表示名字存在但没有所查询类型的记录
+enum class DNSNegativeKind : uint8_t {
+    None,
+    NXDomain,
+    NoData,
+};
+
+// 缓存中的记录写入后不再修改，更新时发布新的记录，读者持有的旧记录保持有效
 struct DNSRecord {
     std::string hostname{};
-    std::vector<std::string> ip_addresses{};
+    DNSAddressList ip_addresses{};
     std::chrono::system_clock::time_point expire_time{};
+    std::chrono::seconds ttl{};// 写入时生效的TTL（已按上下限截断）
     bool is_valid{};
+    DNSNegativeKind negative{DNSNegativeKind::None};// 否定记录没有地址
+    std::shared_ptr<const DNSRecordSet> records{};// 类型化查询（SRV/TXT等）的应答，此时没有地址
 };
 
 class DNSCache {
 public:
+    using RecordPtr = std::shared_ptr<const DNSRecord>;
     using ForEachFn = std::function<void(const std::string &, const DNSRecord &)>;
+    // 命中即将过期的记录时调用，参数为主机名与该记录自写入以来的命中次数
+    using RefreshFn = std::function<void(const std::string &, uint32_t)>;
+    // 写入观察者：record为新发布的记录，为空表示该主机名被删除，hostname也为空表示清空缓存。
+    // 在分片锁内调用，同一主机名的写入按生效顺序通知；回调须保持轻量且不能访问缓存
+    using WriteFn = std::function<void(const std::string &hostname, const RecordPtr &record)>;
 
-    explicit DNSCache(std::chrono::seconds ttl = std::chrono::seconds(300));
+    static constexpr size_t DEFAULT_MAX_SIZE = 10000;
+    static constexpr size_t DEFAULT_SHARD_COUNT = 16;
+    static constexpr size_t MAX_SHARD_COUNT = 1024;
+    static constexpr std::chrono::seconds DEFAULT_MIN_TTL{5};
+    static constexpr std::chrono::seconds DEFAULT_MAX_TTL{86400};
+    static constexpr size_t DEFAULT_NEGATIVE_MAX_SIZE = 1000;
+    static constexpr std::chrono::seconds DEFAULT_NEGATIVE_TTL{30};
 
+    // shard_count会向上取整为2的幂，主机名按哈希分配到各分片，每个分片独立加锁
+    explicit DNSCache(std::chrono::seconds ttl = std::chrono::seconds(300), size_t shard_count = 1,
+                      size_t max_size = DEFAULT_MAX_SIZE);
+    // 按配置创建：默认TTL、TTL上下限、容量与分片数，以及否定缓存的TTL与容量
+    explicit DNSCache(const CacheConfig &config);
+    ~DNSCache();
+
+    // 使用默认TTL写入
+    void update(const std::string &hostname, const DNSAddressList &ips);
+    // 使用服务器返回的TTL写入，TTL会被截断到[min_ttl, max_ttl]
+    void update(const std::string &hostname, const DNSAddressList &ips, std::chrono::seconds ttl);
+    // 文本地址版本，无法解析的地址被忽略
     void update(const std::string &hostname, const std::vector<std::string> &ips);
+    void update(const std::string &hostname, const std::vector<std::string> &ips, std::chrono::seconds ttl);
+    // 类型化记录，键由调用方区分（如"主机名/SRV"），ttl为应答中的最小TTL，截断规则同上
+    void update(const std::string &key, std::shared_ptr<const DNSRecordSet> records, std::chrono::seconds ttl);
+
+    // 命中未过期的正向记录时返回共享的只读记录：只做一次查找和一次引用计数递增，地址在锁外按需读取。
+    // 主机名以string_view查找，调用方无需构造std::string
+    RecordPtr find(std::string_view hostname);
+    // 命中时同时返回记录的剩余TTL
+    RecordPtr find(std::string_view hostname, std::chrono::seconds &remaining_ttl);
+    // 使用驻留主机名预先计算的哈希，分片选择与表内查找都不再计算哈希
+    RecordPtr find(const DNSHostname &hostname);
+    RecordPtr find(const DNSHostname &hostname, std::chrono::seconds &remaining_ttl);
+    // 内部读取（如比较新旧地址）：返回未过期的正向记录，不计入命中统计，也不影响淘汰与预取
+    RecordPtr peek(std::string_view hostname) const;
 
-    bool get(const std::string &hostname, std::vector<std::string> &ips);
+    // 复制地址的版本，基于find()实现
+    bool get(std::string_view hostname, DNSAddressList &ips);
+    bool get(std::string_view hostname, std::vector<std::string> &ips);
+    bool get(std::string_view hostname, DNSAddressList &ips, std::chrono::seconds &remaining_ttl);
 
-    void remove(const std::string &hostname);
+    // 否定记录单独存放、单独计算容量，写入时替换同名的正向记录（正向记录写入时也会替换否定记录）。
+    // 没有指定ttl时使用默认否定TTL；指定时（如SOA的MINIMUM）截断到[min_ttl, 默认否定TTL]。否定缓存关闭时忽略
+    void updateNegative(const std::string &hostname, DNSNegativeKind kind);
+    void updateNegative(const std::string &hostname, DNSNegativeKind kind, std::chrono::seconds ttl);
+    // 命中未过期的否定记录时返回其类型，否则返回None
+    DNSNegativeKind getNegative(std::string_view hostname);
+    DNSNegativeKind getNegative(std::string_view hostname, std::chrono::seconds &remaining_ttl);
+
+    // 批量写入（用于启动时加载快照）：记录保留自身的expire_time与ttl，已过期的被跳过；
+    // 按分片分组后每个分片只加一次锁，也不做顺带清理，返回写入数量
+    size_t bulkInsert(std::vector<DNSRecord> &&records);
+
+    void remove(std::string_view hostname);
     void clear();
 
-    // 遍历缓存的方法
+    // 遍历缓存的方法（逐分片加锁），包括否定记录
     void forEach(const ForEachFn &fn) const;
+    // 取得全部记录（包括否定记录）的引用，每个分片只在复制指针期间加锁，调用方在锁外处理（如持久化）
+    std::vector<RecordPtr> snapshot() const;
 
-    // 获取缓存统计信息
+    // 获取缓存统计信息，size与capacity只计正向记录
     size_t size() const;
     size_t capacity() const;
+    size_t shard_count() const;
+    // 主机名所在的分片下标，供写入观察者按分片划分自己的状态
+    size_t shard_of(std::string_view hostname) const;
     double hit_rate() const;
+    size_t negative_size() const;
+    size_t negative_capacity() const;
+    size_t negative_hits() const;
+
+    // 设置预取回调：剩余TTL低于threshold比例且命中至少min_hits次的记录，在命中时触发一次刷新。
+    // 需在并发访问开始前设置
+    void setRefreshCallback(RefreshFn fn, double threshold = 0.2, uint32_t min_hits = 2);
+
+    // 设置写入观察者（如缓存日志），可在运行中设置或以nullptr清除。
+    // update/updateNegative/bulkInsert/remove/clear会通知，过期清理与容量淘汰不通知
+    void setWriteObserver(WriteFn fn);
+
+    // 在线调整TTL、容量与预取阈值，超出新容量的记录立即淘汰；分片数量与预取开关只在构造时生效
+    void reconfigure(const CacheConfig &config);
+
+    // 增量清理过期记录，每个分片最多清理budget条，返回清理数量
+    size_t purgeExpired(size_t budget_per_shard = EXPIRE_BATCH_BACKGROUND);
+
+    // 后台过期清理线程
+    void startExpiryThread(std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+    void stopExpiryThread();
 
 private:
-    std::unordered_map<std::string, DNSRecord> cache_;
-    mutable std::mutex mutex_;
-    std::chrono::seconds ttl_;
-    size_t max_size_;
+    // update()时顺带清理的过期记录数量上限，保证插入为均摊O(1)
+    static constexpr size_t EXPIRE_BATCH_INLINE = 8;
+    static constexpr size_t EXPIRE_BATCH_BACKGROUND = 1024;
+
+    // 带有预先计算哈希的查找键，一次查找中分片选择与表内查找共用同一个哈希
+    struct HashedKey {
+        std::string_view name;
+        size_t hash;
+    };
+
+    // 条目不单独保存主机名：键就是record->hostname，索引按指纹筛选后只对候选条目比较一次完整哈希与主机名。
+    // 元数据紧凑排列，一个条目48字节
+    struct Entry {
+        RecordPtr record;                                   // 只读记录，更新时整体替换
+        std::chrono::system_clock::time_point expire_time{};// record->expire_time的副本，过期检查与堆调整不必解引用
+        size_t hash{};                                      // 主机名的完整哈希，扩容时不必重新计算
+        uint32_t heap_index{};                              // 过期最小堆中的位置
+        mutable std::atomic<uint32_t> hits{0};              // 写入以来的命中次数
+        mutable std::atomic<bool> referenced{false};
+        mutable std::atomic<bool> refresh_pending{false};// 已提交预取，等待新结果写入
+        bool used{false};                                // 槽位是否存放着记录
+    };
 
-    // 统计信息
-    std::atomic<size_t> hits_{0};
-    std::atomic<size_t> misses_{0};
+    // 条目按块分配，地址固定，以槽位号引用；每块ENTRY_CHUNK个条目连续存放
+    static constexpr size_t ENTRY_CHUNK = 256;
 
-    void cleanup();
-};
\ No newline at end of file
+    // 一组记录及其淘汰与过期索引，正向记录与否定记录各用一组，容量互不影响
+    struct Table {
+        DNSFlatIndex index;// 主机名哈希到槽位号
+        std::vector<std::unique_ptr<Entry[]>> chunks;
+        std::vector<uint32_t> free_slots;
+        uint32_t slot_count{0};// 已分配的槽位数，含空闲槽位
+        size_t max_size{};
+
+        // CLOCK淘汰：命中时置引用位，指针按槽位号顺序扫描并清除，未被引用的记录被淘汰
+        uint32_t hand{0};
+
+        // 以expire_time为键的侵入式最小堆，条目自身记录下标，删除与更新均为O(log n)
+        std::vector<uint32_t> expiry_heap;
+
+        [[nodiscard]] size_t size() const { return index.size(); }
+        [[nodiscard]] Entry &at(uint32_t slot) const { return chunks[slot / ENTRY_CHUNK][slot % ENTRY_CHUNK]; }
+        // 返回键所在的槽位号，不存在时返回DNSFlatIndex::NPOS
+        [[nodiscard]] uint32_t lookup(const HashedKey &key) const;
+        [[nodiscard]] const Entry *find(const HashedKey &key) const;
+        void insert(const HashedKey &key, RecordPtr record);
+        void erase(uint32_t slot);
+        void erase(const HashedKey &key);
+        void evictOne();
+        size_t purgeExpired(std::chrono::system_clock::time_point now, size_t budget);
+        void reserve(size_t count);
+        void clear();
+        template<typename Fn>
+        void forEach(Fn &&fn) const {
+            for (uint32_t slot = 0; slot < slot_count; ++slot) {
+                if (const auto &entry = at(slot); entry.used) {
+                    fn(entry);
+                }
+            }
+        }
+
+        uint32_t allocateSlot();
+        void heapPush(uint32_t slot);
+        void heapRemove(size_t index);
+        void heapFix(size_t index);
+        void heapSwap(size_t a, size_t b);
+        bool heapSiftUp(size_t index);
+        void heapSiftDown(size_t index);
+    };
+
+    // 每个分片独占缓存行，避免不同分片的锁与计数器伪共享
+    struct alignas(64) Shard {
+        Table positive;
+        Table negative;
+        mutable std::shared_mutex mutex;
+
+        // 统计信息
+        std::atomic<size_t> hits{0};
+        std::atomic<size_t> misses{0};
+        std::atomic<size_t> negative_hits{0};
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    size_t shard_mask_;
+    // TTL与容量可由reconfigure()在线修改，读取时不加锁
+    std::atomic<std::chrono::seconds> ttl_;
+    std::atomic<std::chrono::seconds> min_ttl_{DEFAULT_MIN_TTL};
+    std::atomic<std::chrono::seconds> max_ttl_{DEFAULT_MAX_TTL};
+    std::atomic<size_t> max_size_;
+    std::atomic<std::chrono::seconds> negative_ttl_{DEFAULT_NEGATIVE_TTL};
+    std::atomic<size_t> negative_max_size_{DEFAULT_NEGATIVE_MAX_SIZE};// 为0时不缓存否定应答
+
+    RefreshFn refresh_fn_{};
+    std::atomic<double> refresh_threshold_{0.2};
+    uint32_t refresh_min_hits_{2};
+
+    std::atomic<std::shared_ptr<const WriteFn>> write_observer_{};
+
+    std::thread expiry_thread_{};
+    std::mutex expiry_mutex_;
+    std::condition_variable expiry_cv_;
+    bool expiry_running_{false};
+
+    size_t shardIndex(size_t hash) const;
+    RecordPtr find(const HashedKey &key, std::chrono::seconds &remaining_ttl);
+    DNSNegativeKind getNegative(const HashedKey &key, std::chrono::seconds &remaining_ttl);
+    // 发布正向记录（TTL已截断），同名的否定记录随之失效
+    void publish(std::shared_ptr<DNSRecord> record);
+    bool eraseExpired(Shard &shard, const HashedKey &key, std::chrono::system_clock::time_point now);
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "DNSCache.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 缓存的追加日志与后台检查点
+// 每次写入（update/updateNegative/bulkInsert/remove/clear）在分片锁内编码为一条日志追加到内存缓冲区，
+// 后台线程按flush_interval把缓冲区成组写入"<快照文件>.wal.<序号>"。检查点先切换到新序号的日志，
+// 再用DNSCachePersistor逐分片取快照写入快照文件，最后删除已被快照覆盖的旧日志。
+// 恢复时加载快照并按序号重放所有日志，日志按主机名幂等，检查点中途崩溃也不会丢失或回退数据。
+// 日志超过max_log_size时提前做检查点，恢复时间只取决于快照大小与这一上限。
+// 写入文件后不调用fsync，能承受进程崩溃，系统掉电时可能丢失最近的写入
+class DNSCacheJournal {
+public:
+    struct Options {
+        std::chrono::milliseconds flush_interval{1000};
+        std::chrono::seconds checkpoint_interval{300};
+        size_t max_log_size{64 * 1024 * 1024};
+        size_t max_buffer_size{4 * 1024 * 1024};// 缓冲区超过该大小时立即唤醒写线程
+    };
+
+    struct Stats {
+        uint64_t appended{};     // 追加的日志条数
+        uint64_t flushed_bytes{};// 写入日志文件的字节数
+        uint64_t checkpoints{};
+        uint64_t failed_checkpoints{};
+        uint64_t dropped{};      // 日志文件不可用或写入失败而丢弃的条目数，由下一次检查点的快照补上
+        uint64_t replayed{};     // 恢复时重放的日志条数
+        size_t log_size{};       // 当前日志文件的大小
+        std::chrono::milliseconds last_checkpoint_duration{};
+    };
+
+    DNSCacheJournal(std::shared_ptr<DNSCache> cache, std::string snapshot_file, Options options);
+    DNSCacheJournal(std::shared_ptr<DNSCache> cache, std::string snapshot_file);
+    // 按配置创建：快照文件为cache_file，刷新间隔、检查点间隔与日志上限取自journal相关字段
+    DNSCacheJournal(std::shared_ptr<DNSCache> cache, const CacheConfig &config);
+    // 等同于stop()
+    ~DNSCacheJournal();
+
+    DNSCacheJournal(const DNSCacheJournal &) = delete;
+    DNSCacheJournal &operator=(const DNSCacheJournal &) = delete;
+
+    // 加载快照并重放全部日志，须在start()之前调用；快照与日志都不存在时返回false
+    bool recover();
+    // 打开新的日志文件、注册写入观察者并启动后台线程；未调用recover()时已有的日志在首次检查点后被删除
+    bool start();
+    // 注销观察者，写出缓冲区并做最后一次检查点
+    void stop();
+    [[nodiscard]] bool running() const;
+
+    // 立即把缓冲区写入日志文件
+    bool flush();
+    // 立即做一次检查点，与后台线程互斥
+    bool checkpoint();
+
+    [[nodiscard]] Stats getStats() const;
+
+    // 日志文件路径
+    [[nodiscard]] std::string logFile(uint64_t seq) const;
+
+private:
+    // 追加缓冲区与缓存分片一一对应：观察者在分片锁内调用，只与写线程竞争本分片的缓冲区
+    struct alignas(64) Lane {
+        std::mutex mutex;
+        std::string data{};
+        size_t entries{};// data中的条目数
+    };
+
+    // 观察者与写线程共用的缓冲区。观察者持有共享引用，stop()之后仍在执行的回调不会访问已销毁的日志对象
+    struct Buffer {
+        std::mutex mutex;// 只配合cv供写线程等待
+        std::condition_variable cv;
+        std::vector<std::unique_ptr<Lane>> lanes{};
+        std::atomic<size_t> pending{0};// 各缓冲区中尚未写出的字节数
+        size_t wake_size{};
+        // 在缓冲区锁内读取，stop()置为false后取出缓冲区即可保证之后不再有追加
+        std::atomic<bool> running{false};
+        std::atomic<uint64_t> appended{0};
+    };
+
+    // 在分片锁内调用，只编码并追加到该分片的缓冲区。清空在持有全部分片锁时通知，再持有全部缓冲区的锁，
+    // 丢弃尚未写出的条目（它们已被清空覆盖）后写入第一个缓冲区，保证按缓冲区顺序写出时清空之后的条目不会排在它前面
+    static void append(Buffer &buffer, size_t lane, const std::string &hostname, const DNSCache::RecordPtr &record);
+    void run();
+    // 调用方持有file_mutex_。日志未打开或写入失败时丢弃取出的条目并计数
+    bool writeBuffer();
+    bool openLog(uint64_t seq);
+    // 已存在的日志序号（升序）
+    [[nodiscard]] std::vector<uint64_t> existingLogs() const;
+    size_t replay(const std::string &filename);
+
+    std::shared_ptr<DNSCache> cache_;
+    std::string snapshot_file_;
+    Options options_;
+    std::shared_ptr<Buffer> buffer_;
+
+    // 当前日志文件，写入与切换时持有
+    std::mutex file_mutex_;
+    std::ofstream log_{};
+    std::vector<std::string> write_buffers_{};// 与各缓冲区的data交换，保留容量
+    // 日志未打开或有条目被丢弃，日志不再完整：写线程在重试时间到后做检查点，重新打开日志并以快照补上
+    std::atomic<bool> log_incomplete_{false};
+    uint64_t seq_{0};
+    size_t log_size_{0};
+
+    // 检查点之间互斥
+    std::mutex checkpoint_mutex_;
+    std::chrono::steady_clock::time_point last_checkpoint_{};
+    std::chrono::steady_clock::time_point retry_after_{};// 检查点失败后的重试时间
+    bool checkpoint_pending_{false};                     // 恢复了旧日志，启动后尽快合并进快照
+
+    std::thread thread_{};
+
+    std::atomic<uint64_t> flushed_bytes_{0};
+    std::atomic<uint64_t> checkpoints_{0};
+    std::atomic<uint64_t> failed_checkpoints_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> replayed_{0};
+    std::atomic<size_t> current_log_size_{0};
+    std::atomic<std::chrono::milliseconds> last_checkpoint_duration_{};
+};
@@ -6,7 +6,14 @@
 
 class DNSCachePersistor {
 public:
-    static bool save(const DNSCache &cache, const std::string &filename);
+    // 快照格式：二进制格式用于持久化与快速启动，JSON格式便于查看与导出
+    enum class Format {
+        Binary,
+        Json
+    };
+
+    static bool save(const DNSCache &cache, const std::string &filename, Format format = Format::Binary);
+    // 根据文件头自动识别格式
     static bool load(DNSCache &cache, const std::string &filename);
     static bool backup(const DNSCache &cache, const std::string &backup_dir);
     static bool restore(DNSCache &cache, const std::string &backup_file);
@@ -26,6 +33,12 @@ public:
     static CacheStats analyzeCache(const std::string &filename);
 
 private:
+    static bool saveJson(const DNSCache &cache, const std::string &filename);
+    static bool saveBinary(const DNSCache &cache, const std::string &filename);
+    static bool loadJson(DNSCache &cache, const std::string &filename);
+    static bool loadBinary(DNSCache &cache, const std::string &filename);
+    static bool isBinarySnapshot(const std::string &filename);
+
     static nlohmann::json serializeRecord(const DNSRecord &record);
     static DNSRecord deserializeRecord(const nlohmann::json &j);
     static std::string getCurrentTimestamp();
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "DNSAddress.h"
+#include "DNSBatchWindow.h"
+#include "DNSCache.h"
+#include "DNSMetrics.h"
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// 启动预热
+// 预热目标来自主机名列表或hosts格式的文件：hosts条目（"地址 主机名 [别名...]"）作为静态记录，
+// 按分片分组一次性写入缓存，不经过上游；其余主机名以有限并发的滑动窗口解析，应答由解析器按正常路径写入缓存。
+// 超过时限后不再发起新查询，启动耗时不超过时限加一次查询的超时。进度通过DNSMetrics报告。
+class DNSCacheWarmer {
+public:
+    using ResolveFn = DNSBatchWindow::ResolveFn;
+
+    struct Options {
+        size_t max_in_flight{64};
+        std::chrono::milliseconds timeout{10000};
+        std::chrono::seconds static_ttl{86400};// 静态记录到期后按普通主机名解析
+        // 与解析器的split_family_queries一致：静态地址按地址族分别写入各自的缓存键，
+        // 缺少的地址族写入NoData，使其同样不向上游查询
+        bool split_families{false};
+    };
+
+    struct Report {
+        size_t static_entries{};// 写入缓存的静态记录数
+        size_t hostnames{};     // 需要解析的主机名数
+        size_t resolved{};
+        size_t failed{};
+        size_t skipped{};// 超过时限而未发起查询的主机名
+        std::chrono::milliseconds elapsed{};
+    };
+
+    // 从CacheConfig的warmup_*取得选项
+    static Options fromConfig(const CacheConfig &config);
+
+    // resolve_fn为DNSResolver::resolve_async或DNSResolverPool::resolve_async；metrics可以为空
+    DNSCacheWarmer(ResolveFn resolve_fn, std::shared_ptr<DNSCache> cache, std::shared_ptr<DNSMetrics> metrics,
+                   Options options);
+
+    // 读取预热文件：每行为hosts条目或空白分隔的主机名，'#'之后为注释。文件无法打开时返回false
+    bool loadFile(const std::string &filename);
+    void addHostname(const std::string &hostname);
+    // 同一主机名的多个静态条目合并地址，静态条目的主机名不再向上游查询
+    void addStatic(const std::string &hostname, const DNSAddress &address);
+
+    // 阻塞：先写入静态记录，再解析其余主机名，全部结束或超过时限后返回
+    Report run();
+
+    [[nodiscard]] size_t hostnameCount() const { return hostnames_.size(); }
+    [[nodiscard]] size_t staticCount() const { return static_entries_.size(); }
+
+private:
+    size_t insertStatic();
+
+    ResolveFn resolve_fn_;
+    std::shared_ptr<DNSCache> cache_;
+    std::shared_ptr<DNSMetrics> metrics_;
+    Options options_;
+
+    // 规范化后的主机名，保持文件中的顺序并去重
+    std::vector<std::string> hostnames_{};
+    std::unordered_set<std::string> seen_{};
+    std::unordered_map<std::string, DNSAddressList> static_entries_{};
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <nlohmann/json.hpp>
 #include <string>
 #include <vector>
 #include <yaml-cpp/yaml.h>
@@ -15,16 +16,52 @@ struct DNSServerConfig {
 
 struct CacheConfig {
     bool enabled;
-    std::chrono::seconds ttl;
+    std::chrono::seconds ttl;    // 服务器未返回TTL时使用的默认TTL
+    std::chrono::seconds min_ttl;// 记录TTL的下限
+    std::chrono::seconds max_ttl;// 记录TTL的上限
     size_t max_size;
     bool persistent;
     std::string cache_file;
+    size_t shard_count;// 分片数量（2的幂），分片越多读并发越好
+    bool prefetch_enabled;     // 是否在记录过期前后台刷新热点记录
+    double prefetch_threshold; // 剩余TTL低于该比例时触发刷新
+    uint32_t prefetch_max_qps; // 后台刷新的最大速率
+    bool negative_enabled;             // 是否缓存NXDOMAIN/NODATA应答
+    std::chrono::seconds negative_ttl; // 否定记录的TTL，应答带SOA时取其MINIMUM但不超过该值
+    size_t negative_max_size;          // 否定记录的容量，与正向记录分开计算
+    bool journal_enabled;                     // 持久化时以追加日志记录缓存写入，崩溃后可恢复
+    uint32_t journal_flush_interval_ms;       // 日志缓冲区写入文件的间隔
+    std::chrono::seconds checkpoint_interval; // 后台把日志合并进快照的间隔
+    size_t journal_max_size;                  // 日志超过该大小时提前做检查点
+    std::string warmup_file;                  // 启动预热的主机名列表或hosts文件，为空时不预热
+    uint32_t warmup_max_in_flight;            // 预热时同时在途的查询数
+    uint32_t warmup_timeout_ms;               // 预热的最长时间，到期后不再发起新查询
+    std::chrono::seconds warmup_static_ttl;   // hosts文件中静态条目的TTL
 };
 
 struct RetryConfig {
     uint32_t max_attempts;
     uint32_t base_delay_ms;
     uint32_t max_delay_ms;
+    double budget_ratio;        // 重试量占查询量的最大比例
+    uint32_t budget_min_per_sec;// 查询量很小时每秒保底允许的重试次数
+
+    // 对冲查询：首个上游超过其RTT的hedge_percentile分位仍未应答时，向另一个上游再发一次，取先到的应答
+    bool hedge_enabled;
+    double hedge_percentile;
+    uint32_t hedge_min_delay_ms;
+    uint32_t hedge_max_delay_ms;            // 同时用于还没有RTT样本的上游
+    double hedge_budget_ratio;              // 对冲量占查询量的最大比例
+    std::vector<std::string> hedge_domains; // 只对这些域名及其子域对冲，为空时对所有域名对冲
+};
+
+struct UpstreamConfig {
+    std::string selection;          // 上游选择策略："p2c"（二选一，默认）或"weighted"（加权随机）
+    double rtt_ewma_alpha;          // RTT与错误率EWMA的平滑系数
+    uint32_t failure_threshold;     // 连续失败多少次后摘除
+    double latency_outlier_factor;  // RTT超过其他上游中位数的倍数时摘除，0表示不按延迟摘除
+    uint32_t ejection_time_ms;      // 首次摘除时长，探测失败后翻倍
+    uint32_t max_ejection_time_ms;  // 摘除时长上限
 };
 
 struct MetricsConfig {
@@ -61,17 +98,24 @@ public:
 
     bool loadFromFile(const std::string &filename);
     [[nodiscard]] bool saveToFile(const std::string &filename) const;
+    // 与配置文件结构相同的JSON表示，用于DNSConfigVersion的版本保存与比较
+    [[nodiscard]] nlohmann::json toJson() const;
     // 配置访问器
     [[nodiscard]] const std::vector<DNSServerConfig> &servers() const { return servers_; }
     [[nodiscard]] CacheConfig &cache() { return cache_; }
     [[nodiscard]] RetryConfig &retry() { return retry_; }
+    [[nodiscard]] UpstreamConfig &upstream() { return upstream_; }
     [[nodiscard]] MetricsConfig &metrics() { return metrics_; }
     [[nodiscard]] const CacheConfig &cache() const { return cache_; }
     [[nodiscard]] const RetryConfig &retry() const { return retry_; }
+    [[nodiscard]] const UpstreamConfig &upstream() const { return upstream_; }
     [[nodiscard]] const MetricsConfig &metrics() const { return metrics_; }
     [[nodiscard]] uint32_t query_timeout_ms() const { return query_timeout_ms_; }
     [[nodiscard]] uint32_t max_concurrent_queries() const { return max_concurrent_queries_; }
     [[nodiscard]] bool ipv6_enabled() const { return ipv6_enabled_; }
+    // 启用IPv6时A与AAAA分别查询、分别缓存，先到的地址族最多再等待family_grace_ms毫秒
+    [[nodiscard]] bool split_family_queries() const { return split_family_queries_; }
+    [[nodiscard]] uint32_t family_grace_ms() const { return family_grace_ms_; }
 
     // 配置修改器
     void addServer(const DNSServerConfig &server);
@@ -81,11 +125,13 @@ public:
 
     void setCacheConfig(const CacheConfig &cache);
     void setRetryConfig(const RetryConfig &retry);
+    void setUpstreamConfig(const UpstreamConfig &upstream);
     void setMetricsConfig(const MetricsConfig &metrics);
 
     void setQueryTimeout(uint32_t timeout_ms);
     void setMaxConcurrentQueries(uint32_t max_queries);
     void setIPv6Enabled(bool enabled);
+    void setSplitFamilyQueries(bool enabled, uint32_t grace_ms = 50);
 
     // 应用配置更新
     void update(const DNSResolverConfig &other);
@@ -96,11 +142,14 @@ private:
     std::vector<DNSServerConfig> servers_{};
     CacheConfig cache_{};
     RetryConfig retry_{};
+    UpstreamConfig upstream_{};
     MetricsConfig metrics_{};
 
     uint32_t query_timeout_ms_ = 5000;
     uint32_t max_concurrent_queries_ = 100;
     bool ipv6_enabled_ = true;
+    bool split_family_queries_ = false;
+    uint32_t family_grace_ms_ = 50;
 };
 
 class DNSResolverConfigBuilder {
@@ -114,14 +163,35 @@ public:
     // 缓存配置
     DNSResolverConfigBuilder &setCacheEnabled(bool enabled);
     DNSResolverConfigBuilder &setCacheTTL(std::chrono::seconds ttl);
+    DNSResolverConfigBuilder &setCacheTTLBounds(std::chrono::seconds min_ttl, std::chrono::seconds max_ttl);
     DNSResolverConfigBuilder &setCacheMaxSize(size_t max_size);
     DNSResolverConfigBuilder &setCachePersistent(bool persistent);
     DNSResolverConfigBuilder &setCacheFile(const std::string &file);
+    DNSResolverConfigBuilder &setCacheShardCount(size_t shard_count);
+    DNSResolverConfigBuilder &setCachePrefetch(bool enabled, double threshold = 0.2, uint32_t max_qps = 100);
+    DNSResolverConfigBuilder &setCacheNegative(bool enabled, std::chrono::seconds ttl = std::chrono::seconds(30),
+                                               size_t max_size = 1000);
+    DNSResolverConfigBuilder &setCacheJournal(bool enabled, std::chrono::seconds checkpoint_interval = std::chrono::seconds(300),
+                                              uint32_t flush_interval_ms = 1000, size_t max_size = 64 * 1024 * 1024);
+    DNSResolverConfigBuilder &setCacheWarmup(const std::string &file, uint32_t max_in_flight = 64,
+                                             uint32_t timeout_ms = 10000,
+                                             std::chrono::seconds static_ttl = std::chrono::seconds(86400));
 
     // 重试配置
     DNSResolverConfigBuilder &setRetryAttempts(uint32_t attempts);
     DNSResolverConfigBuilder &setRetryBaseDelay(uint32_t delay_ms);
     DNSResolverConfigBuilder &setRetryMaxDelay(uint32_t delay_ms);
+    DNSResolverConfigBuilder &setRetryBudget(double ratio, uint32_t min_per_sec = 10);
+    DNSResolverConfigBuilder &setHedging(bool enabled, double percentile = 0.95, uint32_t min_delay_ms = 5,
+                                         uint32_t max_delay_ms = 500);
+    DNSResolverConfigBuilder &setHedgeBudget(double ratio);
+    DNSResolverConfigBuilder &addHedgeDomain(const std::string &domain);
+
+    // 上游选择配置
+    DNSResolverConfigBuilder &setUpstreamSelection(const std::string &selection);
+    DNSResolverConfigBuilder &setUpstreamEjection(uint32_t failure_threshold, uint32_t ejection_time_ms,
+                                                  uint32_t max_ejection_time_ms = 30000);
+    DNSResolverConfigBuilder &setUpstreamLatencyOutlier(double factor);
 
     // 监控配置
     DNSResolverConfigBuilder &setMetricsEnabled(bool enabled);
@@ -133,6 +203,7 @@ public:
     DNSResolverConfigBuilder &setQueryTimeout(uint32_t timeout_ms);
     DNSResolverConfigBuilder &setMaxConcurrentQueries(uint32_t max_queries);
     DNSResolverConfigBuilder &setIPv6Enabled(bool enabled);
+    DNSResolverConfigBuilder &setSplitFamilyQueries(bool enabled, uint32_t grace_ms = 50);
 
     // 构建配置
     [[nodiscard]] DNSResolverConfig build() const;
@@ -141,8 +212,11 @@ private:
     std::vector<DNSServerConfig> servers_;
     CacheConfig cache_;
     RetryConfig retry_{};
+    UpstreamConfig upstream_{};
     MetricsConfig metrics_;
     uint32_t query_timeout_ms_;
     uint32_t max_concurrent_queries_;
     bool ipv6_enabled_;
+    bool split_family_queries_;
+    uint32_t family_grace_ms_;
 };
\ No newline at end of file
@@ -18,6 +18,7 @@ private:
     static void validateServers(const std::vector<DNSServerConfig> &servers);
     static void validateCache(const CacheConfig &cache);
     static void validateRetry(const RetryConfig &retry);
+    static void validateUpstream(const UpstreamConfig &upstream);
     static void validateMetrics(const MetricsConfig &metrics);
     static bool isValidIpAddress(const std::string &ip);
     static bool isValidPath(const std::string &path);
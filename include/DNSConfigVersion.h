@@ -29,6 +29,9 @@ public:
 
     bool compareVersions(const std::string &version1, const std::string &version2,
                          std::vector<std::string> &differences) const;
+    // 比较两份配置（DNSResolverConfig::toJson()的结果），每项差异形如"cache.max_size: Value changed ..."
+    static void compareConfigs(const nlohmann::json &config1, const nlohmann::json &config2,
+                               std::vector<std::string> &differences);
 
     [[nodiscard]] bool exportVersion(const std::string &version, const std::string &output_file) const;
 
@@ -43,6 +46,6 @@ private:
     bool loadVersion(const std::string &version, ConfigVersion &config) const;
     bool validateVersion(const ConfigVersion &version) const;
     void maintainVersionHistory(size_t max_versions = 100);
-    void compareJsonObjects(const nlohmann::json &obj1, const nlohmann::json &obj2,
-                            const std::string &path, std::vector<std::string> &differences) const;
+    static void compareJsonObjects(const nlohmann::json &obj1, const nlohmann::json &obj2,
+                                   const std::string &path, std::vector<std::string> &differences);
 };
\ No newline at end of file
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <shared_mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -21,52 +25,98 @@ struct DNSAddressEvent {
 };
 
 using DNSEventCallback = std::function<void(const DNSAddressEvent &)>;
+// 返回false的事件被丢弃
+using DNSEventFilter = std::function<bool(const DNSAddressEvent &)>;
 
 class DnsEventListener {
 public:
     virtual ~DnsEventListener() = default;
     virtual void onAddressChanged(const DNSAddressEvent &event) = 0;
+    // 分发线程按批回调，默认逐个转交onAddressChanged
+    virtual void onAddressesChanged(const std::vector<DNSAddressEvent> &events) {
+        for (const auto &event: events) {
+            onAddressChanged(event);
+        }
+    }
     [[nodiscard]] virtual std::string getName() const = 0;
 
-    [[nodiscard]] virtual bool isEnabled() const { return enabled_; }
-    virtual void setEnabled(bool enabled) { enabled_ = enabled; }
+    [[nodiscard]] virtual bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+    virtual void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
 
 protected:
-    bool enabled_ = true;
+    // 分发线程不加锁读取，enableListener/disableListener在其他线程写入
+    std::atomic<bool> enabled_{true};
 };
 
+// 地址变更事件的异步分发
+// notifyAddressChanged只做过滤与入队，不调用任何订阅者：事件进入有界队列，由独立的分发线程成批交给监听器与回调，
+// 订阅者再慢也不会阻塞解析线程。队列中尚未分发的同一主机名、同一记录类型的事件会被合并，队列满时丢弃新事件。
 class DNSEventManager {
 public:
     static DNSEventManager &getInstance();
 
+    static constexpr size_t DEFAULT_QUEUE_CAPACITY = 4096;
+
     void registerListener(const std::shared_ptr<DnsEventListener> &listener);
     void unregisterListener(const std::string &listener_name);
     void addCallback(const std::string &name, const DNSEventCallback &callback);
     void removeCallback(const std::string &name);
+    // 可在任意线程调用，不阻塞；过滤器在调用线程中执行，应保持轻量
     void notifyAddressChanged(const DNSAddressEvent &event);
     size_t getListenerCount() const;
 
     void enableListener(const std::string &listener_name);
     void disableListener(const std::string &listener_name);
+    // 暂停期间事件继续入队与合并，恢复后一并分发
     void pauseEvents();
     void resumeEvents();
     void clearEventQueue();
+    // 等待调用前入队的事件全部分发完成（暂停时立即返回）。
+    // 在分发线程中（监听器或回调内）调用时立即返回，否则会等待自身
+    void flush();
+
+    void setQueueCapacity(size_t capacity);
+    [[nodiscard]] size_t pendingEvents() const;
+    [[nodiscard]] uint64_t droppedEvents() const;
+    [[nodiscard]] uint64_t coalescedEvents() const;
 
-    // 事件过滤
-    void addEventFilter(const DNSEventCallback &filter);
+    // 事件过滤：所有过滤器都返回true的事件才会入队
+    void addEventFilter(const std::string &filter_name, DNSEventFilter filter);
     void removeEventFilter(const std::string &filter_name);
 
 private:
-    DNSEventManager() = default;
+    DNSEventManager();
+    ~DNSEventManager();
+
+    DNSEventManager(const DNSEventManager &) = delete;
+    DNSEventManager &operator=(const DNSEventManager &) = delete;
 
+    // 订阅者，受mutex_保护；分发时复制一份快照，回调期间不持有锁
     mutable std::mutex mutex_;
     std::unordered_map<std::string, std::shared_ptr<DnsEventListener>> listeners_;
     std::unordered_map<std::string, DNSEventCallback> callbacks_;
 
-    bool paused_;
-    std::queue<DNSAddressEvent> event_queue_;
-    std::unordered_map<std::string, std::function<bool(const DNSAddressEvent &)>> filters_;
+    mutable std::shared_mutex filter_mutex_;
+    std::unordered_map<std::string, DNSEventFilter> filters_;
 
-    void processEventQueue();
+    // 待分发的事件，受queue_mutex_保护；pending_index_以"主机名\0记录类型"索引其在队列中的位置，用于合并
+    mutable std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::condition_variable idle_cv_;
+    std::vector<DNSAddressEvent> event_queue_;
+    std::unordered_map<std::string, size_t> pending_index_;
+    size_t queue_capacity_{DEFAULT_QUEUE_CAPACITY};
+    bool paused_{false};
+    bool stopping_{false};
+    bool dispatching_{false};// 分发线程正在回调一批事件
+    uint64_t enqueued_{0};   // 已入队（含被合并）的事件序号
+    uint64_t dispatched_{0}; // 已分发完成（或被清除）的事件序号
+    uint64_t discarded_{0};  // clearEventQueue()时的入队序号
+    uint64_t dropped_{0};
+    uint64_t coalesced_{0};
+    std::thread dispatcher_;
+
+    void run();
+    void processEventQueue(const std::vector<DNSAddressEvent> &events);
     bool shouldProcessEvent(const DNSAddressEvent &event) const;
-};
\ No newline at end of file
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <ares.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// c-ares事件循环
+// 独立的I/O线程驱动一个或多个ares_channel：Linux使用epoll，BSD/macOS使用kqueue，其他平台回退到poll。
+// socket的关注事件来自sock_state_cb，等待超时来自ares_timeout()，因此不依赖fd_set，也没有FD_SETSIZE上限。
+class DNSEventLoop {
+public:
+    using TimerId = uint64_t;
+    using TimerFn = std::function<void()>;
+
+    DNSEventLoop();
+    ~DNSEventLoop();
+
+    DNSEventLoop(const DNSEventLoop &) = delete;
+    DNSEventLoop &operator=(const DNSEventLoop &) = delete;
+
+    // 启动/停止I/O线程
+    bool start();
+    void stop();
+    [[nodiscard]] bool running() const;
+
+    // 注册/注销由该循环驱动的channel
+    void addChannel(ares_channel channel);
+    void removeChannel(ares_channel channel);
+
+    // 由sock_state_cb调用，更新socket关注的读写事件（readable与writable都为false时移除）
+    void updateSocket(ares_channel channel, ares_socket_t socket_fd, bool readable, bool writable);
+
+    // 唤醒I/O线程，使其重新计算下一个超时时间（发起新查询后调用）
+    void wakeup();
+
+    // 是否在I/O线程中
+    [[nodiscard]] bool inLoopThread() const;
+
+    // 定时器：回调在I/O线程中执行，可在任意线程调用
+    TimerId schedule(std::chrono::milliseconds delay, TimerFn fn);
+    bool cancel(TimerId id);
+    [[nodiscard]] size_t pendingTimers() const;
+
+private:
+    struct SocketState {
+        ares_channel channel{};
+        bool readable{};
+        bool writable{};
+    };
+
+    struct ReadyEvent {
+        ares_channel channel{};
+        ares_socket_t socket_fd{ARES_SOCKET_BAD};
+        bool readable{};
+        bool writable{};
+    };
+
+    using Clock = std::chrono::steady_clock;
+    using TimerQueue = std::multimap<Clock::time_point, std::pair<TimerId, TimerFn>>;
+
+    void run();
+    void runDueTimers();
+    void waitEvents(int timeout_ms, std::vector<ReadyEvent> &ready);
+    [[nodiscard]] int nextTimeoutMs(const std::vector<ares_channel> &channels) const;
+    void drainWakeup();
+
+    // 平台相关的后端操作
+    bool openBackend();
+    void closeBackend();
+    void registerSocket(ares_socket_t socket_fd, const SocketState &state, bool is_new);
+    void unregisterSocket(ares_socket_t socket_fd);
+
+    mutable std::mutex mutex_;
+    std::vector<ares_channel> channels_{};
+    std::unordered_map<ares_socket_t, SocketState> sockets_{};
+
+    // 按到期时间排序的定时器，另以id索引以支持取消
+    TimerQueue timers_{};
+    std::unordered_map<TimerId, TimerQueue::iterator> timer_index_{};
+    TimerId next_timer_id_{1};
+
+    std::thread thread_{};
+    std::atomic<bool> running_{false};
+
+    int backend_fd_{-1};  // epoll/kqueue描述符
+    int wakeup_fds_[2]{-1, -1};// 唤醒描述符（eventfd或pipe）
+    // wakeup()持读锁写入唤醒描述符，打开与关闭后端时持写锁，避免写入已关闭（或已被复用）的描述符
+    mutable std::shared_mutex wakeup_mutex_;
+
+    // 最长等待时间，保证stop()等操作在无I/O时也能及时生效
+    static constexpr int MAX_WAIT_MS = 1000;
+};
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DNS_FLAT_INDEX_SSE2 1
+#endif
+
+// 开放寻址的扁平哈希索引（Swiss table风格）
+// 把哈希映射到调用方存储中的槽位号，本身不保存键：每个位置只有1字节控制字节（空、墓碑，或哈希低7位的指纹）
+// 与4字节槽位号，两者各自连续存放。查找时一次比较一组控制字节（SSE2为16个，否则以64位整数比较8个），
+// 只有指纹相同的位置才回调调用方比较完整的键，绝大多数探测不访问条目本身。
+// 删除在必要时留下墓碑，记录与墓碑合计达到容量的7/8时原地重建或扩容一倍。不是线程安全的，由调用方加锁
+class DNSFlatIndex {
+public:
+    static constexpr uint32_t NPOS = UINT32_MAX;
+
+    DNSFlatIndex() = default;
+    DNSFlatIndex(const DNSFlatIndex &) = delete;
+    DNSFlatIndex &operator=(const DNSFlatIndex &) = delete;
+
+    // 返回eq(slot)为真的槽位号，不存在时返回NPOS
+    template<typename Eq>
+    [[nodiscard]] uint32_t find(size_t hash, Eq &&eq) const {
+        if (capacity_ == 0) {
+            return NPOS;
+        }
+        const auto h2 = fingerprint(hash);
+        size_t pos = probeStart(hash);
+        for (size_t step = Group::WIDTH;; step += Group::WIDTH) {
+            const Group group(ctrl_.get() + pos);
+            for (auto mask = group.match(h2); mask; mask = Group::clearLowest(mask)) {
+                const uint32_t slot = slots_[(pos + Group::lowestIndex(mask)) & (capacity_ - 1)];
+                if (eq(slot)) {
+                    return slot;
+                }
+            }
+            if (group.matchEmpty()) {
+                return NPOS;
+            }
+            pos = (pos + step) & (capacity_ - 1);
+        }
+    }
+
+    // 插入调用方确认不存在的键；扩容时以hash_of(slot)取得已有条目的哈希
+    template<typename HashOf>
+    void insert(size_t hash, uint32_t slot, HashOf &&hash_of) {
+        if (growth_left_ == 0) {
+            // 墓碑较多时原地重建即可回收空间
+            rehash(capacity_ == 0 ? Group::WIDTH : size_ * 16 <= capacity_ * 7 ? capacity_ : capacity_ * 2, hash_of);
+        }
+        const size_t index = findInsertPosition(hash);
+        if (ctrl_[index] == EMPTY) {
+            --growth_left_;
+        }
+        setCtrl(index, fingerprint(hash));
+        slots_[index] = slot;
+        ++size_;
+    }
+
+    // 删除指向slot的位置
+    bool erase(size_t hash, uint32_t slot) {
+        if (capacity_ == 0) {
+            return false;
+        }
+        const auto h2 = fingerprint(hash);
+        size_t pos = probeStart(hash);
+        for (size_t step = Group::WIDTH;; step += Group::WIDTH) {
+            const Group group(ctrl_.get() + pos);
+            for (auto mask = group.match(h2); mask; mask = Group::clearLowest(mask)) {
+                const size_t index = (pos + Group::lowestIndex(mask)) & (capacity_ - 1);
+                if (slots_[index] == slot) {
+                    eraseAt(index);
+                    return true;
+                }
+            }
+            if (group.matchEmpty()) {
+                return false;
+            }
+            pos = (pos + step) & (capacity_ - 1);
+        }
+    }
+
+    // 预留至少能容纳count条记录而不扩容的空间
+    template<typename HashOf>
+    void reserve(size_t count, HashOf &&hash_of) {
+        size_t capacity = Group::WIDTH;
+        while (capacity * 7 / 8 < count) {
+            capacity *= 2;
+        }
+        if (capacity > capacity_) {
+            rehash(capacity, hash_of);
+        }
+    }
+
+    // 释放全部空间
+    void clear() {
+        ctrl_.reset();
+        slots_.reset();
+        capacity_ = 0;
+        size_ = 0;
+        growth_left_ = 0;
+    }
+
+    [[nodiscard]] size_t size() const { return size_; }
+    [[nodiscard]] size_t capacity() const { return capacity_; }
+    // 控制字节与槽位号数组占用的字节数
+    [[nodiscard]] size_t memoryUsage() const {
+        return capacity_ == 0 ? 0 : capacity_ + Group::WIDTH - 1 + capacity_ * sizeof(uint32_t);
+    }
+
+private:
+    // 控制字节：最高位为0时是记录的7位指纹
+    static constexpr int8_t EMPTY = -128;// 0b10000000
+    static constexpr int8_t DELETED = -2;// 0b11111110
+
+#if defined(DNS_FLAT_INDEX_SSE2)
+    // 16个控制字节一组，匹配结果每位对应一个位置
+    struct Group {
+        static constexpr size_t WIDTH = 16;
+        using Mask = uint32_t;
+
+        explicit Group(const int8_t *ctrl) : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl))) {}
+
+        [[nodiscard]] Mask match(int8_t h2) const {
+            return static_cast<Mask>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_)));
+        }
+        [[nodiscard]] Mask matchEmpty() const { return match(EMPTY); }
+        // 空位与墓碑的最高位都是1
+        [[nodiscard]] Mask matchEmptyOrDeleted() const { return static_cast<Mask>(_mm_movemask_epi8(ctrl_)); }
+
+        static size_t lowestIndex(Mask mask) { return static_cast<size_t>(std::countr_zero(mask)); }
+        static Mask clearLowest(Mask mask) { return mask & (mask - 1); }
+        // 从低端/高端起连续不匹配的位置数
+        static size_t trailingUnmatched(Mask mask) { return mask ? lowestIndex(mask) : WIDTH; }
+        static size_t leadingUnmatched(Mask mask) {
+            return mask ? static_cast<size_t>(std::countl_zero(mask << (32 - WIDTH))) : WIDTH;
+        }
+
+    private:
+        __m128i ctrl_;
+    };
+#else
+    // 8个控制字节一组，以64位整数并行比较，匹配结果为每字节的最高位。
+    // match可能把紧邻真实匹配、值为h2^1的记录误报为匹配，调用方总会再比较键，不影响正确性
+    struct Group {
+        static constexpr size_t WIDTH = 8;
+        using Mask = uint64_t;
+
+        explicit Group(const int8_t *ctrl) {
+            // 按小端组装，字节序与位置一一对应
+            for (size_t i = 0; i < WIDTH; ++i) {
+                ctrl_ |= static_cast<uint64_t>(static_cast<uint8_t>(ctrl[i])) << (8 * i);
+            }
+        }
+
+        [[nodiscard]] Mask match(int8_t h2) const {
+            const uint64_t x = ctrl_ ^ (LSBS * static_cast<uint8_t>(h2));
+            return (x - LSBS) & ~x & MSBS;
+        }
+        // 空位最高位为1且第1位为0，墓碑两位都是1
+        [[nodiscard]] Mask matchEmpty() const { return ctrl_ & ~(ctrl_ << 6) & MSBS; }
+        [[nodiscard]] Mask matchEmptyOrDeleted() const { return ctrl_ & MSBS; }
+
+        static size_t lowestIndex(Mask mask) { return static_cast<size_t>(std::countr_zero(mask)) / 8; }
+        static Mask clearLowest(Mask mask) { return mask & (mask - 1); }
+        static size_t trailingUnmatched(Mask mask) { return static_cast<size_t>(std::countr_zero(mask)) / 8; }
+        static size_t leadingUnmatched(Mask mask) { return static_cast<size_t>(std::countl_zero(mask)) / 8; }
+
+    private:
+        static constexpr uint64_t LSBS = 0x0101010101010101ull;
+        static constexpr uint64_t MSBS = 0x8080808080808080ull;
+        uint64_t ctrl_{0};
+    };
+#endif
+
+    static int8_t fingerprint(size_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+    [[nodiscard]] size_t probeStart(size_t hash) const { return (hash >> 7) & (capacity_ - 1); }
+
+    // 末尾复制了前WIDTH-1个控制字节，从任意位置读取一整组都不越界
+    void setCtrl(size_t index, int8_t value) {
+        ctrl_[index] = value;
+        if (index < Group::WIDTH - 1) {
+            ctrl_[capacity_ + index] = value;
+        }
+    }
+
+    [[nodiscard]] size_t findInsertPosition(size_t hash) const {
+        size_t pos = probeStart(hash);
+        for (size_t step = Group::WIDTH;; step += Group::WIDTH) {
+            const auto mask = Group(ctrl_.get() + pos).matchEmptyOrDeleted();
+            if (mask) {
+                return (pos + Group::lowestIndex(mask)) & (capacity_ - 1);
+            }
+            pos = (pos + step) & (capacity_ - 1);
+        }
+    }
+
+    void eraseAt(size_t index) {
+        --size_;
+        // 该位置所在的任何一组都有空位时，没有探测序列经过它继续向后，可以直接置空
+        const auto empty_before = Group(ctrl_.get() + ((index - Group::WIDTH) & (capacity_ - 1))).matchEmpty();
+        const auto empty_after = Group(ctrl_.get() + index).matchEmpty();
+        if (empty_before && empty_after &&
+            Group::trailingUnmatched(empty_after) + Group::leadingUnmatched(empty_before) < Group::WIDTH) {
+            setCtrl(index, EMPTY);
+            ++growth_left_;
+        } else {
+            setCtrl(index, DELETED);
+        }
+    }
+
+    template<typename HashOf>
+    void rehash(size_t capacity, HashOf &&hash_of) {
+        auto old_ctrl = std::move(ctrl_);
+        auto old_slots = std::move(slots_);
+        const size_t old_capacity = capacity_;
+
+        capacity_ = capacity;
+        ctrl_ = std::make_unique<int8_t[]>(capacity_ + Group::WIDTH - 1);
+        std::memset(ctrl_.get(), static_cast<uint8_t>(EMPTY), capacity_ + Group::WIDTH - 1);
+        slots_ = std::make_unique<uint32_t[]>(capacity_);
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old_ctrl[i] >= 0) {
+                const size_t hash = hash_of(old_slots[i]);
+                const size_t index = findInsertPosition(hash);
+                setCtrl(index, fingerprint(hash));
+                slots_[index] = old_slots[i];
+            }
+        }
+        growth_left_ = capacity_ * 7 / 8 - size_;
+    }
+
+    std::unique_ptr<int8_t[]> ctrl_{};
+    std::unique_ptr<uint32_t[]> slots_{};
+    size_t capacity_{0};
+    size_t size_{0};
+    size_t growth_left_{0};// 不扩容还能占用的空位数
+};
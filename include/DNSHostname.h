@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// 规范化并驻留的主机名
+// 主机名按DNS大小写不敏感的规则转为小写并去掉末尾的'.'，哈希在驻留时只计算一次。
+// 相同的主机名共享同一份只读存储：句柄只有一个指针大小，复制为一次引用计数递增，比较为指针比较。
+// 驻留表不持有条目，最后一个句柄释放时条目随之移除。
+class DNSHostname {
+public:
+    DNSHostname() = default;
+    // 规范化后驻留
+    explicit DNSHostname(std::string_view hostname);
+    // 原样驻留，用于已规范化的名称或内部使用的缓存键（如带"/AAAA"后缀的键）
+    static DNSHostname verbatim(std::string_view name);
+
+    [[nodiscard]] const std::string &str() const;
+    [[nodiscard]] std::string_view view() const { return str(); }
+    [[nodiscard]] size_t hash() const;
+    [[nodiscard]] bool empty() const { return !data_ || data_->name.empty(); }
+
+    bool operator==(const DNSHostname &other) const { return data_ == other.data_; }
+    friend bool operator==(const DNSHostname &hostname, std::string_view other) { return hostname.view() == other; }
+
+    // 规范形式：ASCII字母小写，最多去掉一个末尾的'.'
+    static std::string canonicalize(std::string_view hostname);
+    // hostname已是规范形式时直接返回它，否则规范化到scratch中并返回scratch，常见情况下不产生复制
+    static const std::string &canonicalize(const std::string &hostname, std::string &scratch);
+    [[nodiscard]] static bool isCanonical(std::string_view hostname);
+    // 与hash()以及缓存、在途查询表内部使用的散列一致
+    static size_t hashOf(std::string_view hostname) { return std::hash<std::string_view>{}(hostname); }
+    // 当前驻留的主机名数量
+    static size_t internedCount();
+
+    // 供无序容器使用，支持以string_view查找
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(const DNSHostname &hostname) const { return hostname.hash(); }
+        size_t operator()(std::string_view hostname) const { return hashOf(hostname); }
+    };
+
+private:
+    struct Data {
+        std::string name;
+        size_t hash{};
+    };
+    class Table;
+
+    std::shared_ptr<const Data> data_{};
+};
+
+template<>
+struct std::hash<DNSHostname> {
+    size_t operator()(const DNSHostname &hostname) const { return hostname.hash(); }
+};
@@ -1,26 +1,57 @@
 #pragma once
 
+#include "DNSMetricsPrimitives.h"
 #include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <prometheus/counter.h>
 #include <prometheus/exposer.h>
 #include <prometheus/gauge.h>
 #include <prometheus/histogram.h>
 #include <prometheus/registry.h>
+#include <shared_mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
+// 解析器运行指标
+// record*在每次查询的热路径上调用，只写分片计数器和固定分桶直方图；
+// 后台线程按固定间隔把增量同步到Prometheus，并在同一时机按窗口评估错误率和延迟告警。
 class DNSMetrics {
 public:
     using AlertCallback = std::function<void(const std::string &)>;
 
     DNSMetrics();
-    void recordQuery(const std::string &hostname, std::chrono::milliseconds duration, bool success);
+    ~DNSMetrics();
+
+    DNSMetrics(const DNSMetrics &) = delete;
+    DNSMetrics &operator=(const DNSMetrics &) = delete;
+
+    // duration按微秒记录，毫秒以下的查询不会被截断为0
+    void recordQuery(const std::string &hostname, std::chrono::microseconds duration, bool success);
     void recordCacheHit(const std::string &hostname);
     void recordCacheMiss(const std::string &hostname);
-    void recordServerLatency(const std::string &server, std::chrono::milliseconds latency);
+    // 命中否定缓存（NXDOMAIN/NODATA），不计入cache_hits与cache_misses
+    void recordNegativeCacheHit(const std::string &hostname);
+    void recordPrefetch(const std::string &hostname);
+    void recordCoalescedQuery(const std::string &hostname);
+    void recordServerLatency(const std::string &server, std::chrono::microseconds latency);
+    // 单个上游服务器的应答结果
+    void recordServerQuery(const std::string &server, bool success);
+    // detail作为dns_errors_total的ares_status标签，应为有限取值的状态名
     void recordError(const std::string &type, const std::string &detail);
+    void recordError(const std::string &type, int ares_status);
     void recordRetry(const std::string &hostname, uint32_t attempt);
+    // 发出对冲查询 / 对冲查询先于原查询得到应答
+    void recordHedge(const std::string &hostname);
+    void recordHedgeWin(const std::string &hostname);
+    // 启动预热进度：total为预热目标数，completed为已完成数（含failed）
+    void recordWarmupProgress(size_t total, size_t completed, size_t failed);
+    // 服务是否已完成预热、可以对外提供解析
+    void setReady(bool ready);
     void startPrometheusExporter(const std::string &address);
 
     struct Stats {
@@ -29,23 +60,50 @@ public:
         uint64_t failed_queries{};
         uint64_t cache_hits{};
         uint64_t cache_misses{};
+        uint64_t negative_cache_hits{};
+        uint64_t prefetches{};
+        uint64_t coalesced_queries{};
         double cache_hit_rate{};
         double avg_query_time_ms{};
+        double p50_query_time_ms{};
+        double p99_query_time_ms{};
         std::map<std::string, uint64_t> error_counts{};
         std::map<std::string, double> server_latencies{};
+        std::map<std::string, uint64_t> server_successes{};
+        std::map<std::string, uint64_t> server_failures{};
         uint64_t total_retries{};
         std::map<std::string, std::vector<uint32_t>> retry_attempts{};
+        uint64_t hedged_queries{};
+        uint64_t hedge_wins{};
+        double hedge_rate{};    // 对冲量 / 上游查询量
+        double hedge_win_rate{};// 对冲胜出 / 对冲量
+        uint64_t warmup_targets{};
+        uint64_t warmup_completed{};
+        uint64_t warmup_failed{};
+        bool ready{};
     };
 
     Stats getStats() const;
     void resetStats();
 
+    // 全部查询延迟的百分位（q取值0~1）
+    [[nodiscard]] std::chrono::microseconds queryLatencyPercentile(double q) const;
+    // 上游服务器RTT的百分位，基于上次publish()时的快照，没有样本时返回0
+    [[nodiscard]] std::chrono::microseconds serverLatencyPercentile(const std::string &server, double q) const;
+
+    // 立即同步Prometheus并评估告警（后台线程也会按间隔调用）
+    void publish();
+    void setPublishInterval(std::chrono::milliseconds interval);
+
     void setAlertThresholds(double error_rate_threshold, std::chrono::milliseconds latency_threshold);
     void registerAlertCallback(AlertCallback callback);
     void clearAlertCallbacks();
 
     void exportToFile(const std::string &filename) const;
 
+    // c-ares状态码对应的名称（如"ETIMEOUT"），用作指标标签
+    static const char *aresStatusName(int status);
+
 private:
     std::shared_ptr<prometheus::Registry> registry_{};
     prometheus::Counter &total_queries_;
@@ -53,26 +111,129 @@ private:
     prometheus::Counter &failed_queries_;
     prometheus::Counter &cache_hits_;
     prometheus::Counter &cache_misses_;
+    prometheus::Counter &negative_cache_hits_;
+    prometheus::Counter &prefetches_;
+    prometheus::Counter &coalesced_queries_;
     prometheus::Histogram &query_duration_;
     prometheus::Gauge &cache_hit_rate_;
     prometheus::Counter &total_retries_;
+    prometheus::Counter &hedged_queries_;
+    prometheus::Counter &hedge_wins_;
+    prometheus::Gauge &warmup_targets_;
+    prometheus::Gauge &warmup_completed_;
+    prometheus::Gauge &warmup_failed_;
+    prometheus::Gauge &ready_gauge_;
 
     std::unique_ptr<prometheus::Exposer> exposer_{};
 
-    mutable std::mutex error_mutex_;
-    std::map<std::string, uint64_t> error_counts_{};
+    // 热路径计数，由publish()同步到上面的Prometheus指标
+    DNSStripedCounter successful_count_{};
+    DNSStripedCounter failed_count_{};
+    DNSStripedCounter cache_hit_count_{};
+    DNSStripedCounter cache_miss_count_{};
+    DNSStripedCounter negative_hit_count_{};
+    DNSStripedCounter prefetch_count_{};
+    DNSStripedCounter coalesced_count_{};
+    DNSStripedCounter retry_count_{};
+    DNSStripedCounter hedge_count_{};
+    DNSStripedCounter hedge_win_count_{};
+    DNSLatencyHistogram query_latency_{};
+
+    // 预热进度与就绪状态，只在启动时更新，直接写入Prometheus
+    std::atomic<uint64_t> warmup_target_count_{0};
+    std::atomic<uint64_t> warmup_completed_count_{0};
+    std::atomic<uint64_t> warmup_failed_count_{0};
+    std::atomic<bool> ready_{false};
 
-    mutable std::mutex latency_mutex_;
-    std::map<std::string, std::vector<double>> server_latencies_{};
+    // 错误计数：dns_errors_total{type, ares_status}，每种组合的句柄只注册一次
+    struct ErrorCounter {
+        prometheus::Counter *counter{};
+        std::atomic<uint64_t> count{0};
+        uint64_t published{0};// 已同步到Prometheus的值
+        uint64_t reset_base{0};// resetStats()时的值
+    };
+    using ErrorsByStatus = std::map<std::string, std::unique_ptr<ErrorCounter>, std::less<>>;
+    prometheus::Family<prometheus::Counter> &errors_family_;
+    mutable std::shared_mutex error_mutex_;
+    std::map<std::string, ErrorsByStatus, std::less<>> error_counters_{};
+
+    // 上游服务器指标，带server标签；服务器集合很小且几乎不变，记录时只需共享锁
+    struct ServerMetrics {
+        DNSLatencyHistogram latency{};
+        std::atomic<uint64_t> successes{0};
+        std::atomic<uint64_t> failures{0};
+        prometheus::Counter *success_counter{};
+        prometheus::Counter *failure_counter{};
+        prometheus::Histogram *latency_histogram{};
+
+        // 已同步到Prometheus的值
+        uint64_t published_successes{0};
+        uint64_t published_failures{0};
+        uint64_t published_latency_sum_us{0};
+        DNSLatencyHistogram::Buckets published_buckets{};
+
+        // resetStats()时的值
+        uint64_t reset_successes{0};
+        uint64_t reset_failures{0};
+        uint64_t reset_latency_count{0};
+        uint64_t reset_latency_sum_us{0};
+    };
+    prometheus::Family<prometheus::Counter> &server_queries_family_;
+    prometheus::Family<prometheus::Histogram> &server_latency_family_;
+    mutable std::shared_mutex latency_mutex_;
+    std::map<std::string, std::unique_ptr<ServerMetrics>, std::less<>> server_metrics_{};
 
+    // 最近的重试记录，固定容量的环形缓冲区
+    struct RetryEvent {
+        std::string hostname{};
+        uint32_t attempt{};
+    };
+    static constexpr size_t MAX_RETRY_HISTORY = 1024;
     mutable std::mutex retry_mutex_;
-    std::map<std::string, std::vector<uint32_t>> retry_attempts_{};
+    std::vector<RetryEvent> retry_history_{};
+    size_t retry_next_{0};
 
     // 告警相关
+    mutable std::mutex alert_mutex_;
     double error_rate_threshold_{};
     std::chrono::milliseconds latency_threshold_{};
-    mutable std::mutex alert_mutex_;
+    bool thresholds_set_{false};
     std::vector<AlertCallback> alert_callbacks_{};
 
-    void updateCacheHitRate();
-};
\ No newline at end of file
+    // 上次同步时的计数，用于计算增量和告警窗口
+    struct Published {
+        uint64_t successful{};
+        uint64_t failed{};
+        uint64_t cache_hits{};
+        uint64_t cache_misses{};
+        uint64_t negative_hits{};
+        uint64_t prefetches{};
+        uint64_t coalesced{};
+        uint64_t retries{};
+        uint64_t hedges{};
+        uint64_t hedge_wins{};
+        uint64_t latency_sum_us{};
+        DNSLatencyHistogram::Buckets latency_buckets{};
+    };
+    std::mutex publish_mutex_;
+    Published published_{};
+
+    // 后台同步线程
+    std::mutex ticker_mutex_;
+    std::condition_variable ticker_cv_;
+    bool ticker_stop_{false};
+    std::chrono::milliseconds publish_interval_{DEFAULT_PUBLISH_INTERVAL};
+    std::thread ticker_{};
+
+    static constexpr std::chrono::milliseconds DEFAULT_PUBLISH_INTERVAL{1000};
+
+    ServerMetrics &serverMetrics(const std::string &server);
+    ErrorCounter &errorCounter(const std::string &type, const std::string &status);
+
+    void runTicker();
+    void syncPrometheus(const Published &current);
+    void syncServers(bool check_latency, std::chrono::milliseconds latency_threshold, std::vector<std::string> &alerts);
+    void syncErrors();
+    void evaluateAlerts(const Published &current, double error_rate_threshold,
+                        std::chrono::milliseconds latency_threshold, std::vector<std::string> &alerts) const;
+};
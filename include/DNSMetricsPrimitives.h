@@ -0,0 +1,158 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// 热路径上使用的低开销统计原语，全部为relaxed原子操作，不加锁、不分配内存
+
+// 分片计数器
+// 每个线程固定写入其中一个缓存行对齐的分片，避免多个I/O线程争用同一缓存行；读取时对所有分片求和。
+class DNSStripedCounter {
+public:
+    static constexpr size_t STRIPES = 16;
+
+    void add(uint64_t n = 1) {
+        cells_[stripeIndex()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t value() const {
+        uint64_t sum = 0;
+        for (const auto &cell: cells_) {
+            sum += cell.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    // 当前线程对应的分片，首次调用时按线程轮流分配
+    static size_t stripeIndex() {
+        static std::atomic<size_t> next{0};
+        thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed) % STRIPES;
+        return index;
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> value{0};
+    };
+
+    std::array<Cell, STRIPES> cells_{};
+};
+
+// 固定分桶的延迟直方图（HDR风格的对数线性分桶）
+// 以微秒为单位，每个2的幂区间再均分为8个子桶，相对误差不超过12.5%，覆盖1微秒到约19小时。
+// 插入只需一次位运算定位和一次原子加法，桶计数可整体快照后计算任意区间的百分位。
+// 与分片计数器一样，每个线程写入自己的一组桶，读取时按桶求和。
+class DNSLatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKET_BITS = 3;
+    static constexpr size_t SUB_BUCKETS = size_t{1} << SUB_BUCKET_BITS;
+    static constexpr size_t MAX_EXPONENT = 35;
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    using Buckets = std::array<uint64_t, BUCKET_COUNT>;
+
+    void record(std::chrono::microseconds latency) {
+        const uint64_t us = latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0;
+        auto &stripe = stripes_[DNSStripedCounter::stripeIndex()];
+        stripe.buckets[bucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+        stripe.sum_us.fetch_add(us, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t count() const {
+        uint64_t total = 0;
+        for (const auto &stripe: stripes_) {
+            for (const auto &bucket: stripe.buckets) {
+                total += bucket.load(std::memory_order_relaxed);
+            }
+        }
+        return total;
+    }
+
+    [[nodiscard]] uint64_t sumMicros() const {
+        uint64_t sum = 0;
+        for (const auto &stripe: stripes_) {
+            sum += stripe.sum_us.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    void snapshot(Buckets &out) const {
+        out.fill(0);
+        for (const auto &stripe: stripes_) {
+            for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                out[i] += stripe.buckets[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 当前全部样本的百分位（q取值0~1），没有样本时返回0
+    [[nodiscard]] std::chrono::microseconds percentile(double q) const {
+        Buckets buckets{};
+        snapshot(buckets);
+        return percentile(buckets, q);
+    }
+
+    // 按快照（或两次快照之差）计算百分位，返回所在桶的上界
+    static std::chrono::microseconds percentile(const Buckets &buckets, double q) {
+        uint64_t total = 0;
+        for (const auto n: buckets) {
+            total += n;
+        }
+        if (total == 0) {
+            return std::chrono::microseconds{0};
+        }
+        q = q < 0.0 ? 0.0 : (q > 1.0 ? 1.0 : q);
+        const auto rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += buckets[i];
+            if (seen >= rank) {
+                return std::chrono::microseconds{static_cast<int64_t>(bucketUpperBound(i))};
+            }
+        }
+        return std::chrono::microseconds{static_cast<int64_t>(bucketUpperBound(BUCKET_COUNT - 1))};
+    }
+
+    static constexpr size_t bucketIndex(uint64_t us) {
+        if (us < SUB_BUCKETS) {
+            return static_cast<size_t>(us);
+        }
+        size_t exponent = static_cast<size_t>(std::bit_width(us)) - 1;
+        if (exponent > MAX_EXPONENT) {
+            return BUCKET_COUNT - 1;
+        }
+        const size_t shift = exponent - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKETS + static_cast<size_t>((us >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    // 桶覆盖的区间为[lower, upper)，单位微秒
+    static constexpr uint64_t bucketLowerBound(size_t index) {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+        const size_t shift = index / SUB_BUCKETS - 1;
+        const uint64_t sub = index % SUB_BUCKETS;
+        return (SUB_BUCKETS + sub) << shift;
+    }
+
+    static constexpr uint64_t bucketUpperBound(size_t index) {
+        if (index < SUB_BUCKETS) {
+            return index + 1;
+        }
+        const size_t shift = index / SUB_BUCKETS - 1;
+        const uint64_t sub = index % SUB_BUCKETS;
+        return (SUB_BUCKETS + sub + 1) << shift;
+    }
+
+private:
+    struct alignas(64) Stripe {
+        std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets{};
+        std::atomic<uint64_t> sum_us{0};
+    };
+
+    std::array<Stripe, DNSStripedCounter::STRIPES> stripes_{};
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+// 定长对象池
+// 以slab为单位向系统申请内存（每块SLAB_SIZE个对象），释放的对象进入空闲链表供下次复用，稳定状态下不再调用operator new。
+// 内存只在池析构时归还，调用方需保证此时所有对象都已release。
+template<typename T, size_t SLAB_SIZE = 64>
+class DNSObjectPool {
+public:
+    DNSObjectPool() = default;
+    ~DNSObjectPool() = default;
+
+    DNSObjectPool(const DNSObjectPool &) = delete;
+    DNSObjectPool &operator=(const DNSObjectPool &) = delete;
+
+    template<typename... Args>
+    T *acquire(Args &&...args) {
+        Slot *slot;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_list_) {
+                grow();
+            }
+            slot = free_list_;
+            free_list_ = slot->next;
+            ++in_use_;
+        }
+        return ::new (slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    void release(T *object) {
+        if (!object) {
+            return;
+        }
+        object->~T();
+        auto *slot = reinterpret_cast<Slot *>(object);
+        std::lock_guard<std::mutex> lock(mutex_);
+        slot->next = free_list_;
+        free_list_ = slot;
+        --in_use_;
+    }
+
+    [[nodiscard]] size_t inUse() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return in_use_;
+    }
+
+    [[nodiscard]] size_t capacity() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return slabs_.size() * SLAB_SIZE;
+    }
+
+private:
+    // 空闲时复用对象存储保存链表指针
+    union Slot {
+        Slot *next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    void grow() {
+        auto slab = std::make_unique<Slot[]>(SLAB_SIZE);
+        for (size_t i = 0; i < SLAB_SIZE; ++i) {
+            slab[i].next = i + 1 < SLAB_SIZE ? &slab[i + 1] : free_list_;
+        }
+        free_list_ = &slab[0];
+        slabs_.push_back(std::move(slab));
+    }
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Slot[]>> slabs_{};
+    Slot *free_list_{nullptr};
+    size_t in_use_{0};
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "DNSHostname.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// 缓存预取（refresh-ahead）
+// 即将过期的热点记录被DNSCache提交到这里，按命中次数排序、去重，并以限定速率在后台重新解析。
+// 过期前的记录继续直接返回给调用方，因此热点域名不会在TTL边界上出现冷失效。
+class DNSPrefetcher {
+public:
+    using RefreshFn = std::function<void(const std::string &hostname)>;
+
+    DNSPrefetcher(RefreshFn refresh_fn, uint32_t max_per_second, size_t max_pending = DEFAULT_MAX_PENDING);
+    ~DNSPrefetcher();
+
+    DNSPrefetcher(const DNSPrefetcher &) = delete;
+    DNSPrefetcher &operator=(const DNSPrefetcher &) = delete;
+
+    void start();
+    void stop();
+
+    // 提交刷新请求，重复的主机名只更新优先级；队列已满时淘汰命中次数最少的请求
+    bool enqueue(const std::string &hostname, uint32_t hits);
+
+    void setRate(uint32_t max_per_second);
+
+    [[nodiscard]] size_t pending() const;
+    [[nodiscard]] uint64_t dispatched() const;
+    [[nodiscard]] uint64_t dropped() const;
+
+    static constexpr size_t DEFAULT_MAX_PENDING = 4096;
+
+private:
+    // 队列与去重索引共享同一个驻留主机名，索引直接使用其预先计算的哈希
+    using Queue = std::multimap<uint32_t, DNSHostname, std::greater<>>;
+
+    void run();
+
+    RefreshFn refresh_fn_;
+    size_t max_pending_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    Queue queue_{};// 按命中次数从高到低
+    std::unordered_map<DNSHostname, Queue::iterator, DNSHostname::Hash> index_{};
+    bool running_{false};
+    std::thread thread_{};
+
+    // 令牌桶限速
+    double rate_{};
+    double tokens_{};
+    std::chrono::steady_clock::time_point last_refill_{};
+
+    uint64_t dispatched_{0};
+    uint64_t dropped_{0};
+};
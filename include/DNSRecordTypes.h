@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+// 地址以外的记录类型，取值与DNS的TYPE字段相同
+enum class DNSRecordType : uint16_t {
+    CNAME = 5,
+    TXT = 16,
+    SRV = 33,
+};
+
+// 每条记录携带自己的TTL：从缓存取得时为剩余TTL，上游应答时为应答中的TTL
+struct DNSSrvRecord {
+    static constexpr DNSRecordType TYPE = DNSRecordType::SRV;
+
+    uint16_t priority{};
+    uint16_t weight{};
+    uint16_t port{};
+    std::string target{};
+    std::chrono::seconds ttl{};
+
+    bool operator==(const DNSSrvRecord &) const = default;
+};
+
+struct DNSTxtRecord {
+    static constexpr DNSRecordType TYPE = DNSRecordType::TXT;
+
+    std::vector<std::string> strings{};// 记录中的各个character-string，可能包含任意字节
+    std::chrono::seconds ttl{};
+
+    // 按RFC 7208等的约定拼接各段
+    [[nodiscard]] std::string text() const {
+        std::string joined;
+        for (const auto &part: strings) {
+            joined.append(part);
+        }
+        return joined;
+    }
+
+    bool operator==(const DNSTxtRecord &) const = default;
+};
+
+struct DNSCnameRecord {
+    static constexpr DNSRecordType TYPE = DNSRecordType::CNAME;
+
+    std::string name{};  // 记录的所有者
+    std::string target{};// 别名指向的名字
+    std::chrono::seconds ttl{};
+
+    bool operator==(const DNSCnameRecord &) const = default;
+};
+
+template<typename T>
+concept DNSTypedRecord = requires {
+    { T::TYPE } -> std::convertible_to<DNSRecordType>;
+    { T::ttl };
+};
+
+// 一次类型化查询的应答，写入缓存后不再修改
+struct DNSRecordSet {
+    DNSRecordType type{};
+    // 查询名经CNAME到达记录所有者的别名链，按解析顺序排列；CNAME查询本身不填充
+    std::vector<DNSCnameRecord> cname_chain{};
+    std::variant<std::vector<DNSSrvRecord>, std::vector<DNSTxtRecord>, std::vector<DNSCnameRecord>> records{};
+    std::chrono::system_clock::time_point received{};// 收到应答的时间，用于计算各记录的剩余TTL
+
+    template<DNSTypedRecord Record>
+    [[nodiscard]] const std::vector<Record> *get() const {
+        return std::get_if<std::vector<Record>>(&records);
+    }
+
+    // 应答中ttl的记录在now时的剩余TTL
+    [[nodiscard]] std::chrono::seconds remaining(std::chrono::seconds ttl,
+                                                 std::chrono::system_clock::time_point now) const {
+        const auto age = std::chrono::duration_cast<std::chrono::seconds>(now - received);
+        return std::max(ttl - age, std::chrono::seconds(0));
+    }
+};
+
+inline const char *recordTypeName(DNSRecordType type) {
+    switch (type) {
+        case DNSRecordType::CNAME:
+            return "CNAME";
+        case DNSRecordType::TXT:
+            return "TXT";
+        case DNSRecordType::SRV:
+            return "SRV";
+    }
+    return "UNKNOWN";
+}
+
+inline std::optional<DNSRecordType> parseRecordType(std::string_view name) {
+    for (const auto type: {DNSRecordType::CNAME, DNSRecordType::TXT, DNSRecordType::SRV}) {
+        if (name == recordTypeName(type)) {
+            return type;
+        }
+    }
+    return std::nullopt;
+}
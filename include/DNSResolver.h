@@ -1,72 +1,415 @@
-#pragma once
-
-#include "DNSCache.h"
-#include "DNSConfig.h"
-#include "DNSMetrics.h"
-#include <ares.h>
-#include <chrono>
-#include <future>
-#include <memory>
-#include <string>
-#include <vector>
-
-class DNSResolver : public std::enable_shared_from_this<DNSResolver> {
-public:
-    struct ResolveResult {
-        int status;
-        std::string hostname;
-        std::vector<std::string> ip_addresses;
-        std::chrono::milliseconds resolution_time;
-    };
-
-    DNSResolver();
-    virtual ~DNSResolver();
-
-    // 初始化
-    bool init(const std::vector<std::string> &dns_servers, std::chrono::seconds cache_ttl = std::chrono::seconds(300));
-
-    // 配置相关
-    bool loadConfig(const std::string &config_file);
-    bool loadConfig(const DNSResolverConfig &config);
-    bool reloadConfig();
-
-    // DNS解析
-    std::future<ResolveResult> resolve(const std::string &hostname);
-    std::vector<std::future<ResolveResult>> resolve_batch(const std::vector<std::string> &hostnames);
-    std::future<ResolveResult> refresh(const std::string &hostname);
-
-    // 缓存操作
-    void clear_cache();
-    [[nodiscard]] bool save_cache(const std::string &filename) const;
-    bool load_cache(const std::string &filename);
-    [[nodiscard]] std::shared_ptr<DNSCache> getCache() const;
-    [[nodiscard]] std::shared_ptr<DNSMetrics> getMetrics() const;
-
-    // 获取统计信息
-    DNSMetrics::Stats getStats() const;
-
-private:
-    mutable std::mutex mutex_;
-    struct QueryContext {
-        std::string hostname;
-        std::promise<ResolveResult> promise;
-        std::chrono::steady_clock::time_point start_time;
-        std::vector<char> buffer;
-        std::shared_ptr<DNSResolver> resolver;
-    };
-
-    static void socket_callback(void *data, ares_socket_t socket_fd, int readable, int writable);
-    static void addrinfo_callback(void *arg, int status, int timeouts, struct ares_addrinfo *result);
-    void process_result(QueryContext *context, int status, const struct ares_addrinfo *result);
-    void notifyAddressChange(const std::string &hostname, const std::vector<std::string> &old_addresses,
-                             const std::vector<std::string> &new_addresses, const std::string &source);
-    void wait_for_completion();
-
-    ares_channel channel_{};
-    bool initialized_{};
-    std::shared_ptr<DNSCache> cache_{};
-    std::shared_ptr<DNSMetrics> metrics_{};
-    std::shared_ptr<DNSResolverConfig> config_{};
-    std::vector<std::string> dns_server_list_{};
-    using QueryContextPtr = std::shared_ptr<QueryContext>;
+#pragma once
+
+#include "DNSCache.h"
+#include "DNSCacheJournal.h"
+#include "DNSConfig.h"
+#include "DNSEventLoop.h"
+#include "DNSMetrics.h"
+#include "DNSObjectPool.h"
+#include "DNSPrefetcher.h"
+#include "DNSRecordTypes.h"
+#include "DNSRetryPolicy.h"
+#include "DNSTrace.h"
+#include "DNSUpstreamSelector.h"
+#include <ares.h>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class DNSResolver : public std::enable_shared_from_this<DNSResolver> {
+public:
+    struct ResolveResult {
+        int status;
+        std::string hostname;
+        DNSAddressList ip_addresses;// 需要文本形式时调用toStrings()或DNSAddress::toString()
+        std::chrono::milliseconds resolution_time;
+        std::chrono::seconds ttl{};// 缓存命中时为记录的剩余TTL，上游应答时为应答中的最小TTL
+        std::shared_ptr<const DNSRecordSet> records{};// 类型化查询的应答（与缓存共享），地址查询时为空
+    };
+
+    // 类型化查询的记录类型
+    using SRV = DNSSrvRecord;
+    using TXT = DNSTxtRecord;
+    using CNAME = DNSCnameRecord;
+
+    // 类型化查询的结果：records与cname_chain中每条记录的ttl为各自的剩余TTL，ttl为整个应答在缓存中的剩余TTL
+    template<DNSTypedRecord Record>
+    struct RecordResult {
+        int status;
+        std::string hostname;
+        std::vector<Record> records;
+        std::vector<DNSCnameRecord> cname_chain;
+        std::chrono::milliseconds resolution_time;
+        std::chrono::seconds ttl{};
+    };
+
+    // 结果回调：缓存命中时在调用线程内联执行，否则在I/O线程执行
+    using ResolveCallback = std::function<void(const ResolveResult &)>;
+    // 分地址族解析的回调：final为false表示另一地址族仍在查询，其结果到达后会再回调一次
+    using DualStackCallback = std::function<void(const ResolveResult &result, bool final)>;
+    // 流式批量解析的输入：每次调用写入下一个主机名，输入耗尽时返回false
+    using HostnameSource = std::function<bool(std::string &hostname)>;
+    template<DNSTypedRecord Record>
+    using RecordCallback = std::function<void(const RecordResult<Record> &)>;
+
+    // co_await resolver.resolve_co(host)：命中缓存时不挂起，未命中时在I/O线程恢复协程
+    class ResolveAwaitable {
+    public:
+        ResolveAwaitable(DNSResolver &resolver, std::string hostname)
+            : resolver_(resolver), hostname_(std::move(hostname)) {}
+
+        bool await_ready() { return resolver_.try_resolve_cached(hostname_, result_); }
+        void await_suspend(std::coroutine_handle<> handle) {
+            resolver_.start_query(hostname_, [this, handle](const ResolveResult &result) {
+                result_ = result;
+                handle.resume();
+            });
+        }
+        ResolveResult await_resume() { return std::move(result_); }
+
+    private:
+        DNSResolver &resolver_;
+        std::string hostname_;
+        ResolveResult result_{};
+    };
+
+    DNSResolver();
+    virtual ~DNSResolver();
+
+    // 初始化
+    bool init(const std::vector<std::string> &dns_servers, std::chrono::seconds cache_ttl = std::chrono::seconds(300));
+    bool init(const std::vector<std::string> &dns_servers, const CacheConfig &cache_config);
+    // 使用外部共享的缓存与指标初始化（如DNSResolverPool），此时缓存的预取、过期清理与持久化由外部负责
+    bool init(const std::vector<std::string> &dns_servers, std::shared_ptr<DNSCache> cache,
+              std::shared_ptr<DNSMetrics> metrics);
+    // 使用完整的服务器配置（端口、权重、超时）初始化，每个上游一个channel，由DNSUpstreamSelector选择
+    bool init(const std::vector<DNSServerConfig> &servers, const CacheConfig &cache_config);
+    bool init(const std::vector<DNSServerConfig> &servers, std::shared_ptr<DNSCache> cache,
+              std::shared_ptr<DNSMetrics> metrics);
+
+    // 停止预取与I/O线程并结束所有查询（如DNSResolverPool在停止共享的缓存日志前调用），之后需重新初始化
+    void shutdown();
+
+    // "addr"或"addr:port"形式的服务器列表转换为服务器配置（权重1、默认超时）
+    static std::vector<DNSServerConfig> toServerConfigs(const std::vector<std::string> &dns_servers);
+    // 缓存键：分地址族查询时AAAA记录以"主机名/AAAA"单独缓存，其余以主机名缓存
+    static std::string cache_key(const std::string &hostname, int family);
+    static constexpr std::string_view AAAA_KEY_SUFFIX = "/AAAA";
+
+    // 配置相关
+    bool loadConfig(const std::string &config_file);
+    bool loadConfig(const DNSResolverConfig &config);
+    // 重新读取loadConfig()加载过的配置文件并热更新
+    bool reloadConfig();
+    // 热更新：与当前配置比较后只应用变化的部分，保留缓存、Prometheus exporter与在途查询。
+    // 上游地址、端口与权重原地更新；上游数量或超时变化时需要重建channel，此时在途查询转到新channel重新发送。
+    // differences非空时填入变化的配置项
+    bool reloadConfig(const DNSResolverConfig &config, std::vector<std::string> *differences = nullptr);
+    // 只应用解析行为相关的配置（重试、IPv6等），不重建channel
+    void applyConfig(const DNSResolverConfig &config);
+    // 当前生效的配置快照，未加载配置时为空
+    [[nodiscard]] std::shared_ptr<const DNSResolverConfig> getConfig() const;
+
+    // DNS解析
+    // 主机名按DNSHostname规范化（小写、去掉末尾的'.'）后再查缓存与上游，结果中的hostname为规范形式
+    std::future<ResolveResult> resolve(const std::string &hostname);
+    void resolve_async(const std::string &hostname, ResolveCallback callback);
+    [[nodiscard]] ResolveAwaitable resolve_co(const std::string &hostname);
+    // A与AAAA分别查询（需启用split_family_queries）：先到的地址族等待宽限期后即交付，另一地址族到达时再交付合并结果。
+    // 未启用时等同于resolve_async，只回调一次且final为true
+    void resolve_dual_stack(const std::string &hostname, DualStackCallback callback);
+    // 滑动窗口批量解析：保持max_in_flight个查询在途（0表示使用max_concurrent_queries），立即返回
+    std::vector<std::future<ResolveResult>> resolve_batch(const std::vector<std::string> &hostnames,
+                                                          size_t max_in_flight = 0);
+    // 流式批量解析：按需读取输入，结果按完成顺序串行回调，全部完成后返回
+    void resolve_stream(const HostnameSource &source, const ResolveCallback &on_result, size_t max_in_flight = 0);
+    template<std::ranges::input_range Range>
+        requires std::constructible_from<std::string, std::ranges::range_reference_t<Range>>
+    void resolve_stream(Range &&hostnames, const ResolveCallback &on_result, size_t max_in_flight = 0) {
+        auto it = std::ranges::begin(hostnames);
+        const auto end = std::ranges::end(hostnames);
+        resolve_stream(HostnameSource([&](std::string &hostname) {
+                           if (it == end) {
+                               return false;
+                           }
+                           hostname = std::string(*it);
+                           ++it;
+                           return true;
+                       }),
+                       on_result, max_in_flight);
+    }
+    std::future<ResolveResult> refresh(const std::string &hostname);
+    // 只查缓存（含否定记录），命中时填充result并返回true，未命中时不发起查询（供DNSStubServer等前端使用）
+    bool resolve_cached(const std::string &hostname, ResolveResult &result);
+    // 只查一个地址族：分地址族查询时只看该地址族的缓存键，另一地址族有记录不算命中；未启用时同上
+    bool resolve_cached(const std::string &hostname, int family, ResolveResult &result);
+    // resolve_cached未命中后向上游发起查询，不再重复检查缓存；同名的在途查询仍会合并
+    void resolve_miss_async(const std::string &hostname, ResolveCallback callback);
+    // 分地址族查询时只查询family（不等待另一地址族、不交付合并结果），未启用时同上
+    void resolve_miss_async(const std::string &hostname, int family, ResolveCallback callback);
+    // 绕过缓存直接向上游发起查询，结果写回缓存（用于预取，不移除现有记录）
+    void prefetch(const std::string &hostname);
+
+    // 类型化查询（resolve<DNSResolver::SRV>(name)等）：与地址查询共用channel、I/O线程、在途查询合并、重试与指标。
+    // 应答以"名字/类型"为键（如"_http._tcp.example.com/SRV"）写入同一个缓存，缓存时长取CNAME链与记录中的最小TTL；
+    // 空应答与NXDOMAIN按SOA给出的否定TTL缓存
+    template<DNSTypedRecord Record>
+    std::future<RecordResult<Record>> resolve(const std::string &name) {
+        auto promise = std::make_shared<std::promise<RecordResult<Record>>>();
+        auto future = promise->get_future();
+        resolve_async<Record>(name, [promise](const RecordResult<Record> &result) {
+            promise->set_value(result);
+        });
+        return future;
+    }
+    template<DNSTypedRecord Record>
+    void resolve_async(const std::string &name, RecordCallback<Record> callback) {
+        resolve_records_async(name, Record::TYPE, [callback = std::move(callback)](const ResolveResult &result) {
+            callback(to_record_result<Record>(result));
+        });
+    }
+    // 非模板版本：应答在result.records中，可用to_record_result转换
+    void resolve_records_async(const std::string &name, DNSRecordType type, ResolveCallback callback);
+    template<DNSTypedRecord Record>
+    static RecordResult<Record> to_record_result(const ResolveResult &result) {
+        RecordResult<Record> typed{result.status, result.hostname, {}, {}, result.resolution_time, result.ttl};
+        if (!result.records) {
+            return typed;
+        }
+        const auto now = std::chrono::system_clock::now();
+        if (const auto *records = result.records->get<Record>()) {
+            typed.records = *records;
+            for (auto &record: typed.records) {
+                record.ttl = result.records->remaining(record.ttl, now);
+            }
+        }
+        typed.cname_chain = result.records->cname_chain;
+        for (auto &cname: typed.cname_chain) {
+            cname.ttl = result.records->remaining(cname.ttl, now);
+        }
+        return typed;
+    }
+
+    // 缓存操作
+    void clear_cache();
+    [[nodiscard]] bool save_cache(const std::string &filename) const;
+    bool load_cache(const std::string &filename);
+    [[nodiscard]] std::shared_ptr<DNSCache> getCache() const;
+    [[nodiscard]] std::shared_ptr<DNSMetrics> getMetrics() const;
+
+    // 启动预热（见DNSCacheWarmer）：hosts条目批量写入缓存，其余主机名以有限并发解析，期间is_ready()为false。
+    // 并发、时限与静态TTL取自cache_config的warmup_*，loadConfig在配置了warmup_file时自动调用。文件无法读取时返回false
+    bool warmup(const std::string &filename, const CacheConfig &cache_config);
+    // 已初始化且不在预热中，可用作服务的就绪检查
+    [[nodiscard]] bool is_ready() const;
+
+    // 获取统计信息
+    DNSMetrics::Stats getStats() const;
+    [[nodiscard]] std::vector<DNSUpstreamSelector::UpstreamStats> getUpstreamStats() const;
+
+    // 逐查询追踪：设置后每次解析结束时导出一个DNSQuerySpan，以nullptr关闭。
+    // 关闭时热路径只多一次relaxed原子读；编译时定义DNS_TRACING_ENABLED=0则完全消除
+    void setTraceExporter(DNSTraceExporter exporter);
+
+private:
+    mutable std::mutex mutex_;
+    // 在途查询上下文，由每个channel的对象池分配
+    // 主机名与在途查询表的键内联存放：name中依次为主机名、'\0'、地址族，整体即为键，主机名部分可直接作为C字符串使用
+    struct QueryContext {
+        static constexpr size_t MAX_HOSTNAME_LENGTH = 255;
+
+        DNSResolver *resolver{};// 解析器在析构前会完成或取消所有查询
+        int family{};
+        uint32_t attempt{0};// 已进行的重试次数
+        uint32_t tried{0};  // 本轮已尝试的上游（位掩码），重试时清空
+        uint16_t upstream{0};// 当前发送到的上游
+        uint16_t record_type{0};// 类型化查询的DNSRecordType，地址查询为0
+        bool hedge{false};   // 由对冲定时器发出的查询
+        bool cancelled{false};// 另一方已给出结果，本查询的应答只计入上游统计
+        QueryContext *peer{};// 对冲查询的另一方，均在途时非空（仅在I/O线程访问）
+        std::chrono::steady_clock::time_point start_time{};
+        std::chrono::steady_clock::time_point sent_time{};// 本次发送到上游的时间
+        DNSQuerySpan *span{};// 启用追踪时的时间线，对冲的双方只有一方持有，查询结束时导出并释放
+        uint16_t hostname_length{};
+        uint16_t key_length{};
+        char name[MAX_HOSTNAME_LENGTH + 8]{};
+
+        [[nodiscard]] const char *hostname() const { return name; }
+        [[nodiscard]] std::string_view key() const { return {name, key_length}; }
+    };
+
+    // 在途查询表的散列，支持以string_view查找
+    struct KeyHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+    };
+
+    // 分地址族查询的汇合状态，results[0]为AAAA，results[1]为A
+    struct FamilyRace {
+        std::mutex mutex;
+        std::string hostname;
+        DualStackCallback callback;
+        bool updates{};  // 先交付部分结果后，是否在另一地址族到达时再次回调
+        ResolveResult results[2]{};
+        bool done[2]{};
+        bool delivered{};// 已交付过结果
+        DNSEventLoop::TimerId grace_timer{};
+        std::unique_ptr<DNSQuerySpan> lookup_span{};// 缓存查找阶段的span，发起查询时复制给每个地址族
+    };
+
+    // 每个上游一个channel，sock_state_cb的data指向这里
+    struct Upstream {
+        DNSResolver *resolver{};
+        ares_channel channel{};
+    };
+
+    static void socket_callback(void *data, ares_socket_t socket_fd, int readable, int writable);
+    static void addrinfo_callback(void *arg, int status, int timeouts, struct ares_addrinfo *result);
+    static void dnsrec_callback(void *arg, ares_status_t status, size_t timeouts, const ares_dns_record_t *dnsrec);
+    // 返回false表示查询已被重新发起，context仍在使用中。地址查询的应答在result中，类型化查询的在dnsrec中
+    bool process_result(QueryContext *context, int status, const struct ares_addrinfo *result,
+                        const ares_dns_record_t *dnsrec = nullptr);
+    // 解析类型化查询的应答：沿CNAME链收集记录，填充result的records与ttl（否定应答时为SOA给出的否定TTL，没有时为0）。
+    // 有应答但没有所查询类型的记录时返回ARES_ENODATA，否则返回status
+    static int parse_records(DNSRecordType type, const std::string &hostname, int status,
+                             const ares_dns_record_t *dnsrec, ResolveResult &result);
+    // RFC 2308的否定TTL，应答中没有SOA时为0
+    static std::chrono::seconds negative_ttl(const ares_dns_record_t *dnsrec);
+    static std::string canonical_name(const char *name);
+    static void read_rdata(const ares_dns_rr_t *rr, DNSSrvRecord &record);
+    static void read_rdata(const ares_dns_rr_t *rr, DNSTxtRecord &record);
+    static void read_rdata(const ares_dns_rr_t *rr, DNSCnameRecord &record);
+    void complete_query(QueryContext *context, ResolveResult &&result);
+    void notifyAddressChange(const std::string &hostname, int family, const DNSAddressList &old_addresses,
+                             const DNSAddressList &new_addresses, const std::string &source,
+                             std::chrono::seconds ttl);
+    [[nodiscard]] size_t default_window() const;
+    void shutdown_channel();
+    using Upstreams = std::vector<std::unique_ptr<Upstream>>;
+
+    // 停止I/O线程，以replacement替换当前channel并销毁旧channel，在途查询转到新channel；
+    // replacement为空时只关闭，并结束等待重试与对冲的查询（不停止预取）
+    void close_channels(Upstreams replacement = {}, const std::vector<DNSUpstreamSelector::Upstream> &selection = {});
+    // 持有写锁替换channel与上游选择器，返回被替换的channel
+    Upstreams swap_channels(Upstreams upstreams, const std::vector<DNSUpstreamSelector::Upstream> &selection);
+    // 热更新上游：数量与超时不变时原地修改channel的服务器地址，否则先建好新channel再替换。
+    // 原地修改中途失败时恢复已修改的channel，失败后仍使用原来的上游
+    bool apply_servers(const std::vector<DNSServerConfig> &old_servers, const std::vector<DNSServerConfig> &servers);
+    // 配置中启用的服务器
+    static std::vector<DNSServerConfig> active_servers(const DNSResolverConfig &config);
+    // "地址:端口"形式的c-ares服务器串
+    static std::string server_address(const DNSServerConfig &server);
+    // 以c-ares规范化后的"地址:端口"作为上游名称（指标标签），取不到时使用fallback
+    static std::string channel_name(ares_channel channel, const std::string &fallback);
+    // 为每个上游服务器创建channel，并重置上游选择器
+    bool open_channels(const std::vector<DNSServerConfig> &servers);
+    // 创建全部channel及对应的选择器条目，失败时不留下channel
+    bool create_channels(const std::vector<DNSServerConfig> &servers, Upstreams &upstreams,
+                         std::vector<DNSUpstreamSelector::Upstream> &selection);
+    // 创建channel追加到upstreams，server为空时使用系统配置的服务器
+    bool open_channel(const DNSServerConfig *server, size_t server_count, Upstreams &upstreams);
+    // 上游没有给出有效应答（超时、拒绝、SERVFAIL等），应切换到其他上游
+    static bool is_server_failure(int status);
+    // 将channel交给I/O线程驱动
+    bool start_event_loop();
+    // 缓存查找（记录命中/未命中指标），命中时填充result，命中否定记录时status为ARES_ENOTFOUND/ARES_ENODATA
+    bool try_resolve_cached(const std::string &hostname, ResolveResult &result);
+    bool try_resolve_split_cached(const std::string &hostname, ResolveResult &result);
+    // 查找一个缓存键的正向或否定记录（填充剩余TTL），不记录指标
+    bool lookup_cached(std::string_view key, ResolveResult &result);
+    // 未命中路径：向上游发起查询（或加入已有的在途查询），分地址族时同时发起A与AAAA查询。
+    // span为缓存查找阶段已开始的追踪，启用追踪而span为空时从登记在途查询开始
+    void start_query(const std::string &hostname, ResolveCallback callback,
+                     std::unique_ptr<DNSQuerySpan> span = nullptr);
+    void start_family_query(const std::string &hostname, int family, ResolveCallback callback,
+                            std::unique_ptr<DNSQuerySpan> span = nullptr) {
+        start_upstream_query(hostname, family, 0, std::move(callback), std::move(span));
+    }
+    void start_record_query(const std::string &hostname, DNSRecordType type, ResolveCallback callback,
+                            std::unique_ptr<DNSQuerySpan> span = nullptr) {
+        start_upstream_query(hostname, AF_UNSPEC, static_cast<uint16_t>(type), std::move(callback), std::move(span));
+    }
+    // 登记在途查询并发送，record_type为0时按地址族查询地址
+    void start_upstream_query(const std::string &hostname, int family, uint16_t record_type, ResolveCallback callback,
+                              std::unique_ptr<DNSQuerySpan> span);
+    [[nodiscard]] bool split_families() const;
+    // 分地址族查询：发起尚未得到结果的地址族，并在两者都结束或宽限期到期时交付
+    void start_split_query(const std::shared_ptr<FamilyRace> &race);
+    void on_family_result(const std::shared_ptr<FamilyRace> &race, size_t slot, const ResolveResult &result);
+    void on_family_grace_expired(const std::shared_ptr<FamilyRace> &race);
+    static ResolveResult merge_families(const FamilyRace &race);
+    static void deliver(const FamilyRace &race, const ResolveResult &result, bool final);
+    // 缓存命中了一个地址族时，在后台补齐另一个
+    void fill_family(const std::string &hostname, int family);
+    // 选择上游并按context中的地址族或记录类型发送查询（首次查询、切换与重试共用）
+    void issue_query(QueryContext *context);
+    void send_query(QueryContext *context, size_t upstream);
+    // 首选上游超过其RTT分位仍未应答时，向另一个上游发出对冲查询
+    // 发送前登记对冲并返回等待时间，发送后再调度定时器
+    std::optional<std::chrono::milliseconds> prepare_hedge(QueryContext *context);
+    void schedule_hedge(QueryContext *context, std::chrono::milliseconds delay);
+    void hedge_query(QueryContext *context);
+    void cancel_hedge(QueryContext *context);
+    // 重试定时器到期
+    void retry_query(QueryContext *context);
+    // 在途查询表的键：主机名 + '\0' + 地址族，类型化查询为主机名 + '\0' + '#' + 记录类型
+    static std::string make_key(const std::string &hostname, int family, uint16_t record_type = 0);
+    // 类型化记录的缓存键："主机名/类型"
+    static std::string record_key(const std::string &hostname, DNSRecordType type);
+
+    // 追踪
+    [[nodiscard]] bool tracing() const {
+        return DNS_TRACING_ENABLED && tracing_.load(std::memory_order_relaxed);
+    }
+    // 查询的span：对冲查询在途时记录到持有span的一方
+    static DNSQuerySpan *span_of(const QueryContext *context) {
+        if constexpr (!DNS_TRACING_ENABLED) {
+            return nullptr;
+        }
+        return context->span ? context->span : (context->peer ? context->peer->span : nullptr);
+    }
+    static void trace_event(const QueryContext *context, DNSTraceEvent::Kind kind, int status = 0);
+    // 缓存查找阶段的span：命中时立即导出，未命中时交给在途查询继续记录
+    std::unique_ptr<DNSQuerySpan> trace_lookup(const std::string &hostname, uint16_t record_type,
+                                               std::chrono::steady_clock::time_point start,
+                                               const ResolveResult *hit) const;
+    void export_span(const DNSQuerySpan &span) const;
+
+    // 发送查询时持读锁，替换channel时持写锁；c-ares在发送调用内同步回调时，回调中的发送不再重复加锁
+    mutable std::shared_mutex channels_mutex_;
+    Upstreams upstreams_{};
+    DNSUpstreamSelector selector_{};
+    std::unique_ptr<DNSEventLoop> event_loop_{};
+    std::shared_ptr<DNSPrefetcher> prefetcher_{};
+    DNSRetryPolicy retry_policy_{};
+    std::atomic<bool> initialized_{false};
+    std::atomic<bool> warming_{false};// 预热中，loadConfig在初始化前置位，避免预热开始前短暂报告就绪
+    bool owns_cache_{true};// 缓存是否由本解析器创建（共享缓存时不在析构时保存）
+    std::shared_ptr<DNSCache> cache_{};
+    std::unique_ptr<DNSCacheJournal> journal_{};// 启用缓存日志时代替析构时的整体保存
+    std::shared_ptr<DNSMetrics> metrics_{};
+    // 不可变的配置快照，热更新时整体替换，读取方无需加锁
+    std::atomic<std::shared_ptr<const DNSResolverConfig>> config_{};
+    std::mutex reload_mutex_;// 串行化热更新，并保护config_file_
+    std::string config_file_{};
+    // 在途查询表：同一主机名与地址族的并发未命中共享一次上游查询，受mutex_保护
+    std::unordered_map<std::string, std::vector<ResolveCallback>, KeyHash, std::equal_to<>> pending_queries_{};
+    // 等待重试定时器的查询，关闭channel时需取消定时器并结束这些查询，受mutex_保护
+    std::unordered_map<QueryContext *, DNSEventLoop::TimerId> retrying_queries_{};
+    // 等待对冲定时器的查询，受mutex_保护
+    std::unordered_map<QueryContext *, DNSEventLoop::TimerId> hedge_timers_{};
+    DNSObjectPool<QueryContext> context_pool_{};
+    std::atomic<bool> tracing_{false};
+    std::atomic<bool> migrating_{false};// 正在销毁被替换的channel，其ARES_EDESTRUCTION按切换处理
+    std::atomic<std::shared_ptr<const DNSTraceExporter>> trace_exporter_{};
 };
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "DNSCache.h"
+#include "DNSCacheJournal.h"
+#include "DNSConfig.h"
+#include "DNSMetrics.h"
+#include "DNSPrefetcher.h"
+#include "DNSResolver.h"
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <string>
+#include <vector>
+
+// 多channel解析器池
+// 每个成员DNSResolver拥有独立的ares_channel与I/O线程，上游处理可以利用多个核心；
+// 所有成员共用同一个分片缓存和指标。主机名按散列固定路由到某个成员，同名的并发查询仍能合并为一次上游查询。
+class DNSResolverPool {
+public:
+    using ResolveResult = DNSResolver::ResolveResult;
+    using ResolveCallback = DNSResolver::ResolveCallback;
+    using HostnameSource = DNSResolver::HostnameSource;
+
+    // size为0时使用硬件线程数
+    explicit DNSResolverPool(size_t size = 0);
+    ~DNSResolverPool();
+
+    DNSResolverPool(const DNSResolverPool &) = delete;
+    DNSResolverPool &operator=(const DNSResolverPool &) = delete;
+
+    // 初始化
+    bool init(const std::vector<std::string> &dns_servers, const CacheConfig &cache_config);
+    bool loadConfig(const std::string &config_file);
+    bool loadConfig(const DNSResolverConfig &config);
+    // 热更新，语义同DNSResolver::reloadConfig，共享缓存的容量与TTL在池中统一调整
+    bool reloadConfig();
+    bool reloadConfig(const DNSResolverConfig &config, std::vector<std::string> *differences = nullptr);
+
+    // DNS解析
+    std::future<ResolveResult> resolve(const std::string &hostname);
+    void resolve_async(const std::string &hostname, ResolveCallback callback);
+    [[nodiscard]] DNSResolver::ResolveAwaitable resolve_co(const std::string &hostname);
+    void resolve_dual_stack(const std::string &hostname, DNSResolver::DualStackCallback callback);
+    std::future<ResolveResult> refresh(const std::string &hostname);
+    // 类型化查询（SRV、TXT、CNAME），与地址查询按同样的主机名路由，应答写入共享缓存
+    template<DNSTypedRecord Record>
+    std::future<DNSResolver::RecordResult<Record>> resolve(const std::string &name) {
+        return resolverFor(name).resolve<Record>(name);
+    }
+    template<DNSTypedRecord Record>
+    void resolve_async(const std::string &name, DNSResolver::RecordCallback<Record> callback) {
+        resolverFor(name).resolve_async<Record>(name, std::move(callback));
+    }
+    void resolve_records_async(const std::string &name, DNSRecordType type, ResolveCallback callback);
+    // 窗口在整个池范围内计数，0表示使用max_concurrent_queries
+    std::vector<std::future<ResolveResult>> resolve_batch(const std::vector<std::string> &hostnames,
+                                                          size_t max_in_flight = 0);
+    void resolve_stream(const HostnameSource &source, const ResolveCallback &on_result, size_t max_in_flight = 0);
+    template<std::ranges::input_range Range>
+        requires std::constructible_from<std::string, std::ranges::range_reference_t<Range>>
+    void resolve_stream(Range &&hostnames, const ResolveCallback &on_result, size_t max_in_flight = 0) {
+        auto it = std::ranges::begin(hostnames);
+        const auto end = std::ranges::end(hostnames);
+        resolve_stream(HostnameSource([&](std::string &hostname) {
+                           if (it == end) {
+                               return false;
+                           }
+                           hostname = std::string(*it);
+                           ++it;
+                           return true;
+                       }),
+                       on_result, max_in_flight);
+    }
+
+    // 主机名所属的成员解析器
+    [[nodiscard]] DNSResolver &resolverFor(const std::string &hostname) const;
+    [[nodiscard]] size_t size() const;
+
+    // 缓存操作
+    void clear_cache();
+    [[nodiscard]] bool save_cache(const std::string &filename) const;
+    bool load_cache(const std::string &filename);
+    [[nodiscard]] std::shared_ptr<DNSCache> getCache() const;
+    [[nodiscard]] std::shared_ptr<DNSMetrics> getMetrics() const;
+
+    // 启动预热，语义同DNSResolver::warmup，主机名按路由分配到各成员解析
+    bool warmup(const std::string &filename, const CacheConfig &cache_config);
+    // 所有成员已初始化且不在预热中
+    [[nodiscard]] bool is_ready() const;
+
+    // 获取统计信息
+    DNSMetrics::Stats getStats() const;
+
+    // 逐查询追踪，设置到所有成员，span的upstream为成员内的上游名称
+    void setTraceExporter(const DNSTraceExporter &exporter);
+
+private:
+    void shutdown();
+    [[nodiscard]] size_t default_window() const;
+    // 主机名到成员下标的映射
+    [[nodiscard]] static size_t indexFor(const std::string &hostname, size_t count);
+    // 创建共享缓存及预取器，并初始化各成员
+    bool init_members(const std::vector<DNSServerConfig> &servers, const CacheConfig &cache_config);
+
+    std::vector<std::shared_ptr<DNSResolver>> resolvers_{};
+    std::shared_ptr<DNSCache> cache_{};
+    std::unique_ptr<DNSCacheJournal> journal_{};// 启用缓存日志时代替析构时的整体保存
+    std::shared_ptr<DNSMetrics> metrics_{};
+    std::shared_ptr<DNSPrefetcher> prefetcher_{};
+    std::atomic<std::shared_ptr<const DNSResolverConfig>> config_{};
+    std::mutex reload_mutex_;// 串行化热更新，并保护config_file_
+    std::string config_file_{};
+    std::atomic<bool> warming_{false};
+};
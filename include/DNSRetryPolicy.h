@@ -0,0 +1,55 @@
+#pragma once
+
+#include "DNSConfig.h"
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+
+// 重试策略
+// 退避时间按RetryConfig指数增长并加入随机抖动，避免大量失败查询同时重试；
+// 重试预算限制重试量不超过查询量的固定比例（另有每秒保底额度），上游故障时不会被重试放大流量。
+// 对冲查询使用独立的预算，只按查询量累积，没有保底额度。
+class DNSRetryPolicy {
+public:
+    DNSRetryPolicy();
+
+    // 应用新的重试配置，未调用前不进行重试
+    void configure(const RetryConfig &config);
+
+    // 每个新发起的上游查询调用一次，为预算存入令牌
+    void recordQuery();
+
+    // 判断是否对第attempt次重试（从1开始）放行，放行时返回退避时间
+    bool shouldRetry(int status, uint32_t attempt, std::chrono::milliseconds &delay);
+
+    // 因预算耗尽而放弃的重试次数
+    [[nodiscard]] uint64_t budgetExhausted() const;
+
+    // 该主机名是否启用对冲，以及对冲所用的RTT分位
+    [[nodiscard]] bool hedgeEnabled(std::string_view hostname) const;
+    [[nodiscard]] double hedgePercentile() const;
+    // 由上游RTT分位得出对冲等待时间（限制在配置的上下限内，没有样本时取上限）
+    [[nodiscard]] std::chrono::milliseconds hedgeDelay(std::chrono::microseconds rtt_percentile) const;
+    // 消耗一个对冲预算，预算不足时返回false
+    bool tryHedge();
+
+    // 应答明确（或查询被取消）时重试没有意义
+    [[nodiscard]] static bool isRetryable(int status);
+
+private:
+    void refill(std::chrono::steady_clock::time_point now);
+    [[nodiscard]] std::chrono::milliseconds backoff(uint32_t attempt) const;
+
+    mutable std::mutex mutex_;
+    RetryConfig config_{};
+    bool enabled_{false};
+
+    double tokens_{0.0};
+    double max_tokens_{0.0};
+    std::chrono::steady_clock::time_point last_refill_{};
+    uint64_t exhausted_{0};
+
+    double hedge_tokens_{0.0};
+    double max_hedge_tokens_{0.0};
+};
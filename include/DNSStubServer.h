@@ -0,0 +1,119 @@
+#pragma once
+
+#include "DNSResolver.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 本地存根DNS服务器
+// 在UDP/TCP上接收标准DNS查询（A/AAAA），缓存命中时在接收线程内直接用预分配的缓冲区构造应答，
+// 未命中时交给DNSResolver向上游查询（同名查询合并），结果在I/O线程中发回。
+// Linux上每个UDP线程使用独立的SO_REUSEPORT socket，并以recvmmsg/sendmmsg批量收发；其他平台所有线程共用一个socket。
+class DNSStubServer {
+public:
+    struct Options {
+        std::string address{"127.0.0.1"};
+        uint16_t port{53};             // 为0时由系统分配，启动后通过port()获取
+        size_t udp_threads{1};         // 为0时使用硬件线程数
+        bool tcp_enabled{true};
+        size_t batch_size{32};         // 每次recvmmsg/sendmmsg的最大报文数
+        uint16_t max_udp_payload{1232};// 支持EDNS时的UDP应答上限
+        size_t max_pending{10000};     // 等待上游应答的查询上限，超出时应答SERVFAIL
+        size_t max_tcp_connections{256};
+        std::chrono::milliseconds tcp_idle_timeout{10000};
+    };
+
+    struct Stats {
+        uint64_t queries{};
+        uint64_t cache_hits{}; // 在接收线程内直接应答（含否定记录）
+        uint64_t forwarded{};  // 交给解析器向上游查询
+        uint64_t malformed{};  // 无法解析的报文（应答FORMERR或丢弃）
+        uint64_t unsupported{};// 非A/AAAA查询，应答NOTIMP/REFUSED
+        uint64_t truncated{};  // UDP应答超过上限，已置TC位
+        uint64_t overloaded{}; // 在途查询超过max_pending
+        uint64_t tcp_connections{};
+    };
+
+    DNSStubServer(std::shared_ptr<DNSResolver> resolver, Options options);
+    explicit DNSStubServer(std::shared_ptr<DNSResolver> resolver);
+    ~DNSStubServer();
+
+    DNSStubServer(const DNSStubServer &) = delete;
+    DNSStubServer &operator=(const DNSStubServer &) = delete;
+
+    bool start();
+    // 停止接收新查询，并等待已转发查询的回调结束后关闭socket
+    void stop();
+    [[nodiscard]] bool running() const;
+    // 实际监听的端口
+    [[nodiscard]] uint16_t port() const;
+    [[nodiscard]] Stats getStats() const;
+
+    // DNS报文的最大长度（TCP）
+    static constexpr size_t MAX_MESSAGE_SIZE = 65535;
+    // 接收缓冲区大小，更长的UDP查询按格式错误处理
+    static constexpr size_t MAX_QUERY_SIZE = 512;
+
+private:
+    struct UdpWorker;
+    struct TcpConnection;
+    struct Query;
+
+    enum class Disposition {
+        Reply,  // 应答已写入输出缓冲区
+        Forward,// 缓存未命中，需要转发给解析器
+        Drop,   // 不应答（如收到的是应答报文）
+    };
+
+    // 发送转发查询的应答，在解析器的I/O线程中调用
+    using ReplySender = std::function<void(const uint8_t *data, size_t size)>;
+
+    bool openUdpSockets(const sockaddr_storage &address, socklen_t address_len);
+    bool openTcpSocket(const sockaddr_storage &address, socklen_t address_len);
+    void closeSockets();
+    void runUdp(UdpWorker &worker);
+    void runTcp();
+    // 解析查询并尝试从缓存应答，out的容量不小于query.limit
+    Disposition process(const uint8_t *data, size_t size, bool tcp, Query &query, std::string &hostname,
+                        DNSResolver::ResolveResult &scratch, uint8_t *out, size_t &out_size);
+    // 把未命中的查询交给解析器，在途查询过多时直接应答SERVFAIL
+    void forward(const Query &query, const std::string &hostname, ReplySender sender);
+    void finishPending();
+
+    // 解析查询报文：返回-1表示丢弃，否则为应答的RCODE，为0时hostname是小写的查询名
+    static int parseQuery(const uint8_t *data, size_t size, Query &query, std::string &hostname);
+    // 构造应答并返回其长度；result为空或rcode非0时不含应答记录，超过query.limit时只保留问题段并置TC位
+    size_t buildResponse(const Query &query, int rcode, const DNSResolver::ResolveResult *result,
+                         uint8_t *out, bool &truncated) const;
+    // 解析结果对应的RCODE
+    static int responseCode(const DNSResolver::ResolveResult &result);
+
+    std::shared_ptr<DNSResolver> resolver_;
+    Options options_;
+
+    std::vector<std::unique_ptr<UdpWorker>> udp_workers_{};
+    int tcp_fd_{-1};
+    std::thread tcp_thread_{};
+    std::atomic<bool> running_{false};
+    uint16_t port_{};
+
+    // 已转发、尚未回调的查询数，stop()等待其归零后再关闭socket
+    std::mutex pending_mutex_;
+    std::condition_variable pending_cv_;
+    size_t pending_{0};
+
+    std::atomic<uint64_t> queries_{0};
+    std::atomic<uint64_t> cache_hits_{0};
+    std::atomic<uint64_t> forwarded_{0};
+    std::atomic<uint64_t> malformed_{0};
+    std::atomic<uint64_t> unsupported_{0};
+    std::atomic<uint64_t> truncated_{0};
+    std::atomic<uint64_t> overloaded_{0};
+    std::atomic<uint64_t> tcp_connections_{0};
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 编译期开关：定义为0时追踪代码被完全消除（CMake选项ENABLE_TRACING=OFF）
+#ifndef DNS_TRACING_ENABLED
+#define DNS_TRACING_ENABLED 1
+#endif
+
+// 查询时间线上的一个事件，时间为steady_clock时间点（纳秒精度）
+struct DNSTraceEvent {
+    enum class Kind : uint8_t {
+        CacheLookup,// 缓存查找结束
+        Enqueue,    // 登记为在途查询
+        Send,       // 发送到上游（首次发送、切换上游与重试后的发送）
+        Retry,      // 重试定时器到期
+        Hedge,      // 发出对冲查询
+        Answer,     // 收到上游应答（包括失败应答）
+    };
+
+    Kind kind{};
+    std::chrono::steady_clock::time_point time{};
+    uint16_t upstream{};// Send/Hedge/Answer：上游下标
+    int status{};       // Answer：c-ares状态码
+
+    static const char *kindName(Kind kind);
+};
+
+// 一次解析的span（OpenTelemetry风格）：起止时间、属性与按时间排列的事件。
+// 缓存命中只有CacheLookup事件；合并到在途查询的请求不单独产生span
+struct DNSQuerySpan {
+    std::string hostname{};
+    int family{};
+    uint16_t record_type{};// 类型化查询的DNSRecordType，地址查询为0
+    int status{};
+    bool cache_hit{};
+    uint32_t attempts{};   // 重试次数
+    std::string upstream{};// 给出最终应答的上游，缓存命中时为空
+    std::chrono::steady_clock::time_point start{};
+    std::chrono::steady_clock::time_point end{};
+    std::vector<DNSTraceEvent> events{};
+
+    [[nodiscard]] std::chrono::nanoseconds duration() const { return end - start; }
+    // 相对start的偏移
+    [[nodiscard]] std::chrono::nanoseconds offset(const DNSTraceEvent &event) const { return event.time - start; }
+};
+
+// 在结束查询的线程（缓存命中时为调用线程，否则为I/O线程）中调用，须保持轻量
+using DNSTraceExporter = std::function<void(const DNSQuerySpan &span)>;
+
+inline const char *DNSTraceEvent::kindName(Kind kind) {
+    switch (kind) {
+        case Kind::CacheLookup:
+            return "cache_lookup";
+        case Kind::Enqueue:
+            return "enqueue";
+        case Kind::Send:
+            return "send";
+        case Kind::Retry:
+            return "retry";
+        case Kind::Hedge:
+            return "hedge";
+        case Kind::Answer:
+            return "answer";
+    }
+    return "unknown";
+}
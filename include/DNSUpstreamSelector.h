@@ -0,0 +1,103 @@
+#pragma once
+
+#include "DNSConfig.h"
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 上游服务器选择
+// 每个上游服务器独立统计RTT与错误率（EWMA），按权重做二选一（P2C）或加权随机选择。
+// 连续失败或RTT明显高于其他服务器的上游会被暂时摘除，到期后放行一个真实查询作为探测，成功即恢复，失败则加倍摘除时长。
+class DNSUpstreamSelector {
+public:
+    static constexpr size_t MAX_UPSTREAMS = 32;// tried掩码的位数
+
+    struct Upstream {
+        std::string name;
+        uint32_t weight{1};
+    };
+
+    struct UpstreamStats {
+        std::string name;
+        uint32_t weight{};
+        double rtt_ms{};    // EWMA，没有样本时为0
+        double error_rate{};// EWMA
+        uint32_t in_flight{};
+        bool ejected{};
+        uint64_t selected{};
+        uint64_t failures{};
+        uint64_t ejections{};
+    };
+
+    DNSUpstreamSelector();
+
+    // 替换上游列表并清空统计
+    void reset(const std::vector<Upstream> &upstreams);
+    // 上游数量不变时原地更新名称与权重：名称未变的上游保留统计，名称改变的上游重新统计。数量不同时返回false
+    bool update(const std::vector<Upstream> &upstreams);
+    void configure(const UpstreamConfig &config);
+
+    // 选择一个上游并计入在途查询，tried中置位的上游不参与选择（全部已尝试时忽略该掩码）
+    size_t select(uint32_t tried = 0);
+    // 查询结束：server_ok表示上游给出了有效应答（包括NXDOMAIN），rtt仅在server_ok时计入
+    void onResult(size_t index, bool server_ok, std::chrono::microseconds rtt);
+    // 查询被放弃（如关闭channel），只减少在途计数
+    void onAbandon(size_t index);
+
+    // 除tried之外是否还有未摘除的上游，用于决定是否立即切换
+    [[nodiscard]] bool hasAlternative(uint32_t tried) const;
+    // 上游的平滑RTT，没有样本时返回0
+    [[nodiscard]] std::chrono::microseconds smoothedRtt(size_t index) const;
+    // 返回副本：热更新可能同时替换上游列表，下标越界时返回空串
+    [[nodiscard]] std::string name(size_t index) const;
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] std::vector<UpstreamStats> stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State {
+        Healthy,
+        Ejected,
+        Probing,// 摘除到期，已放行一个探测查询
+    };
+
+    struct Server {
+        std::string name;
+        uint32_t weight{1};
+        double rtt_us{0};
+        bool has_rtt{false};
+        uint64_t samples{0};
+        double error_rate{0};
+        uint32_t in_flight{0};
+        uint32_t consecutive_failures{0};
+        State state{State::Healthy};
+        Clock::time_point ejected_until{};
+        std::chrono::milliseconds ejection_time{};
+        uint64_t selected{0};
+        uint64_t failures{0};
+        uint64_t ejections{0};
+    };
+
+    [[nodiscard]] double cost(const Server &server) const;
+    size_t pickWeighted(const std::vector<size_t> &candidates, uint64_t total_weight);
+    void eject(Server &server, Clock::time_point now);
+    [[nodiscard]] bool canEject() const;
+    [[nodiscard]] bool isLatencyOutlier(size_t index) const;
+    uint64_t nextRandom();
+
+    mutable std::mutex mutex_;
+    std::vector<Server> servers_{};
+    UpstreamConfig config_{};
+    uint64_t rng_state_;
+    std::vector<size_t> candidates_{};// select()的临时数组，避免每次分配
+
+    // 按延迟摘除的最低绝对差距，避免亚毫秒级RTT的抖动触发摘除
+    static constexpr double MIN_OUTLIER_GAP_US = 10000.0;
+    // 判断延迟离群前要求的最少样本数
+    static constexpr uint64_t MIN_OUTLIER_SAMPLES = 20;
+    // 错误率在代价中的放大系数
+    static constexpr double ERROR_PENALTY = 4.0;
+};
@@ -1,7 +1,24 @@
 #pragma once
+#include <array>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
 
 class DNSUtils {
+    // CRC-32查表，须在使用它的常量表达式之前定义
+    static constexpr std::array<uint32_t, 256> makeCrc32Table() {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return table;
+    }
+
 public:
     static int64_t getTime() {
         // 获取当前时间点
@@ -12,4 +29,40 @@ public:
         auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
         return millis;
     }
-};
\ No newline at end of file
+
+    // 以小端序追加整数，用于二进制快照与缓存日志
+    template<typename T>
+    static void putLE(std::string &out, T value) {
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            out.push_back(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF));
+        }
+    }
+
+    // 以小端序写入已预留的位置
+    template<typename T>
+    static void putLE(char *dst, T value) {
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            dst[i] = static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF);
+        }
+    }
+
+    template<typename T>
+    static T getLE(const unsigned char *src) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            value |= static_cast<uint64_t>(src[i]) << (8 * i);
+        }
+        return static_cast<T>(value);
+    }
+
+    // CRC-32（IEEE 802.3），可分段累加
+    static uint32_t crc32Update(uint32_t crc, const void *data, size_t size) {
+        static constexpr auto TABLE = makeCrc32Table();
+        const auto *bytes = static_cast<const unsigned char *>(data);
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i) {
+            crc = TABLE[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+};
@@ -0,0 +1,180 @@
+#include "DNSAddress.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#endif
+
+DNSAddress::DNSAddress(const in_addr &addr) : family_(AF_INET) {
+    addr_.v4 = addr;
+}
+
+DNSAddress::DNSAddress(const in6_addr &addr) : family_(AF_INET6) {
+    addr_.v6 = addr;
+}
+
+std::optional<DNSAddress> DNSAddress::parse(std::string_view text) {
+    // inet_pton需要以'\0'结尾的字符串
+    char buf[INET6_ADDRSTRLEN];
+    if (text.empty() || text.size() >= sizeof(buf)) {
+        return std::nullopt;
+    }
+    std::memcpy(buf, text.data(), text.size());
+    buf[text.size()] = '\0';
+
+    in_addr v4{};
+    if (inet_pton(AF_INET, buf, &v4) == 1) {
+        return DNSAddress(v4);
+    }
+    in6_addr v6{};
+    if (inet_pton(AF_INET6, buf, &v6) == 1) {
+        return DNSAddress(v6);
+    }
+    return std::nullopt;
+}
+
+std::optional<DNSAddress> DNSAddress::fromSockaddr(const sockaddr *addr) {
+    if (!addr) {
+        return std::nullopt;
+    }
+    if (addr->sa_family == AF_INET) {
+        return DNSAddress(reinterpret_cast<const sockaddr_in *>(addr)->sin_addr);
+    }
+    if (addr->sa_family == AF_INET6) {
+        return DNSAddress(reinterpret_cast<const sockaddr_in6 *>(addr)->sin6_addr);
+    }
+    return std::nullopt;
+}
+
+size_t DNSAddress::size() const {
+    switch (family_) {
+        case AF_INET:
+            return sizeof(in_addr);
+        case AF_INET6:
+            return sizeof(in6_addr);
+        default:
+            return 0;
+    }
+}
+
+std::string DNSAddress::toString() const {
+    char buf[INET6_ADDRSTRLEN];
+    if (family_ == AF_UNSPEC || !inet_ntop(family_, &addr_, buf, sizeof(buf))) {
+        return {};
+    }
+    return buf;
+}
+
+socklen_t DNSAddress::toSockaddr(sockaddr_storage &out, uint16_t port) const {
+    std::memset(&out, 0, sizeof(out));
+    if (family_ == AF_INET) {
+        auto *sin = reinterpret_cast<sockaddr_in *>(&out);
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons(port);
+        sin->sin_addr = addr_.v4;
+        return sizeof(sockaddr_in);
+    }
+    if (family_ == AF_INET6) {
+        auto *sin6 = reinterpret_cast<sockaddr_in6 *>(&out);
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons(port);
+        sin6->sin6_addr = addr_.v6;
+        return sizeof(sockaddr_in6);
+    }
+    return 0;
+}
+
+bool DNSAddress::operator==(const DNSAddress &other) const {
+    return family_ == other.family_ && std::memcmp(&addr_, &other.addr_, size()) == 0;
+}
+
+std::ostream &operator<<(std::ostream &os, const DNSAddress &address) {
+    return os << address.toString();
+}
+
+DNSAddressList::DNSAddressList(std::initializer_list<DNSAddress> addresses) {
+    reserve(addresses.size());
+    for (const auto &address: addresses) {
+        push_back(address);
+    }
+}
+
+DNSAddressList::DNSAddressList(const DNSAddressList &other) {
+    *this = other;
+}
+
+DNSAddressList::DNSAddressList(DNSAddressList &&other) noexcept {
+    *this = std::move(other);
+}
+
+DNSAddressList &DNSAddressList::operator=(const DNSAddressList &other) {
+    if (this != &other) {
+        // 容量足够时复用已有存储，缓存命中路径上的复制不产生分配
+        size_ = 0;
+        reserve(other.size_);
+        std::copy(other.begin(), other.end(), mutableData());
+        size_ = other.size_;
+    }
+    return *this;
+}
+
+DNSAddressList &DNSAddressList::operator=(DNSAddressList &&other) noexcept {
+    if (this != &other) {
+        if (other.heap_) {
+            heap_ = std::move(other.heap_);
+            capacity_ = other.capacity_;
+        } else {
+            heap_.reset();
+            capacity_ = INLINE_CAPACITY;
+            std::copy(other.inline_, other.inline_ + other.size_, inline_);
+        }
+        size_ = other.size_;
+        other.size_ = 0;
+        other.capacity_ = INLINE_CAPACITY;
+    }
+    return *this;
+}
+
+DNSAddressList DNSAddressList::fromStrings(const std::vector<std::string> &addresses) {
+    DNSAddressList list;
+    list.reserve(addresses.size());
+    for (const auto &text: addresses) {
+        if (const auto address = DNSAddress::parse(text)) {
+            list.push_back(*address);
+        }
+    }
+    return list;
+}
+
+std::vector<std::string> DNSAddressList::toStrings() const {
+    std::vector<std::string> strings;
+    strings.reserve(size_);
+    for (const auto &address: *this) {
+        strings.push_back(address.toString());
+    }
+    return strings;
+}
+
+void DNSAddressList::push_back(const DNSAddress &address) {
+    if (size_ == capacity_) {
+        reserve(static_cast<size_t>(capacity_) * 2);
+    }
+    mutableData()[size_++] = address;
+}
+
+void DNSAddressList::reserve(size_t capacity) {
+    if (capacity <= capacity_) {
+        return;
+    }
+    auto storage = std::make_unique<DNSAddress[]>(capacity);
+    std::copy(begin(), end(), storage.get());
+    heap_ = std::move(storage);
+    capacity_ = static_cast<uint32_t>(capacity);
+}
+
+bool DNSAddressList::operator==(const DNSAddressList &other) const {
+    return size_ == other.size_ && std::equal(begin(), end(), other.begin());
+}
@@ -0,0 +1,105 @@
+#include "DNSBatchWindow.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+namespace {
+    struct BatchState : std::enable_shared_from_this<BatchState> {
+        DNSBatchWindow::ResolveFn resolve_fn;
+        std::vector<std::string> hostnames;
+        std::vector<std::promise<DNSBatchWindow::ResolveResult>> promises;
+        size_t limit{};
+
+        std::mutex mutex;
+        size_t next{0};
+        size_t in_flight{0};
+        bool pumping{false};
+
+        // 在窗口未满时继续发出查询。同一时刻只有一个线程在补充窗口：
+        // 缓存命中会在resolve_fn内同步完成，此时只减少计数，由外层循环继续补充，避免递归。
+        void pump() {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (pumping) {
+                return;
+            }
+            pumping = true;
+            while (in_flight < limit && next < hostnames.size()) {
+                const size_t index = next++;
+                ++in_flight;
+                lock.unlock();
+                resolve_fn(hostnames[index], [self = shared_from_this(), index](const DNSBatchWindow::ResolveResult &result) {
+                    self->complete(index, result);
+                });
+                lock.lock();
+            }
+            pumping = false;
+        }
+
+        void complete(size_t index, const DNSBatchWindow::ResolveResult &result) {
+            promises[index].set_value(result);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --in_flight;
+            }
+            pump();
+        }
+    };
+}// namespace
+
+std::vector<std::future<DNSBatchWindow::ResolveResult>> DNSBatchWindow::batch(const ResolveFn &resolve_fn,
+                                                                              const std::vector<std::string> &hostnames,
+                                                                              size_t limit) {
+    auto state = std::make_shared<BatchState>();
+    state->resolve_fn = resolve_fn;
+    state->hostnames = hostnames;
+    state->promises.resize(hostnames.size());
+    state->limit = std::max<size_t>(1, limit);
+
+    std::vector<std::future<ResolveResult>> futures;
+    futures.reserve(hostnames.size());
+    for (auto &promise: state->promises) {
+        futures.push_back(promise.get_future());
+    }
+    state->pump();
+    return futures;
+}
+
+void DNSBatchWindow::stream(const ResolveFn &resolve_fn, const HostnameSource &source,
+                            const ResolveCallback &on_result, size_t limit) {
+    limit = std::max<size_t>(1, limit);
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t in_flight = 0;
+    std::mutex callback_mutex;
+
+    // 状态都在栈上：返回前会等待所有回调结束
+    std::string hostname;
+    while (source(hostname)) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return in_flight < limit; });
+            ++in_flight;
+        }
+        resolve_fn(hostname, [&](const ResolveResult &result) {
+            {
+                std::lock_guard<std::mutex> callback_lock(callback_mutex);
+                try {
+                    on_result(result);
+                } catch (const std::exception &e) {
+                    std::cerr << "Error executing stream callback for " << result.hostname
+                              << ": " << e.what() << std::endl;
+                }
+            }
+            // 在锁内通知，防止调用线程返回后条件变量已销毁
+            std::lock_guard<std::mutex> lock(mutex);
+            --in_flight;
+            cv.notify_one();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return in_flight == 0; });
+}
@@ -1,129 +1,690 @@
 #include "DNSCache.h"
 
 #include <algorithm>
+#include <bit>
 
-DNSCache::DNSCache(std::chrono::seconds ttl)
-    : ttl_(ttl), max_size_(10000) {
-    cleanup();
+DNSCache::DNSCache(const CacheConfig &config)
+    : DNSCache(config.ttl, config.shard_count, config.max_size) {
+    min_ttl_ = config.min_ttl;
+    max_ttl_ = std::max(config.min_ttl, config.max_ttl);
+    negative_ttl_ = std::max(config.negative_ttl, std::chrono::seconds(1));
+    negative_max_size_ = config.negative_enabled ? config.negative_max_size : 0;
+    const size_t shard_count = shards_.size();
+    for (const auto &shard: shards_) {
+        shard->negative.max_size = (negative_max_size_ + shard_count - 1) / shard_count;
+    }
+}
+
+void DNSCache::reconfigure(const CacheConfig &config) {
+    ttl_ = config.ttl;
+    min_ttl_ = config.min_ttl;
+    max_ttl_ = std::max(config.min_ttl, config.max_ttl);
+    negative_ttl_ = std::max(config.negative_ttl, std::chrono::seconds(1));
+    max_size_ = std::max<size_t>(1, config.max_size);
+    negative_max_size_ = config.negative_enabled ? config.negative_max_size : 0;
+    refresh_threshold_ = std::clamp(config.prefetch_threshold, 0.0, 1.0);
+
+    // 已缓存记录的TTL不变，只按新容量淘汰
+    const size_t shard_count = shards_.size();
+    const size_t positive_max = std::max<size_t>(1, (max_size_ + shard_count - 1) / shard_count);
+    const size_t negative_max = (negative_max_size_ + shard_count - 1) / shard_count;
+    for (const auto &shard: shards_) {
+        std::unique_lock<std::shared_mutex> lock(shard->mutex);
+        shard->positive.max_size = positive_max;
+        while (shard->positive.size() > positive_max) {
+            shard->positive.evictOne();
+        }
+        shard->negative.max_size = negative_max;
+        while (shard->negative.size() > negative_max) {
+            shard->negative.evictOne();
+        }
+    }
+}
+
+DNSCache::DNSCache(std::chrono::seconds ttl, size_t shard_count, size_t max_size)
+    : ttl_(ttl), min_ttl_(std::min(DEFAULT_MIN_TTL, ttl)), max_ttl_(std::max(DEFAULT_MAX_TTL, ttl)),
+      max_size_(std::max<size_t>(1, max_size)) {
+    shard_count = std::bit_ceil(std::clamp<size_t>(shard_count, 1, MAX_SHARD_COUNT));
+    shard_mask_ = shard_count - 1;
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        auto shard = std::make_unique<Shard>();
+        // 容量平均分配到各分片
+        shard->positive.max_size = std::max<size_t>(1, (max_size_ + shard_count - 1) / shard_count);
+        shard->negative.max_size = (negative_max_size_ + shard_count - 1) / shard_count;
+        shards_.push_back(std::move(shard));
+    }
+}
+
+size_t DNSCache::shardIndex(size_t hash) const {
+    // 斐波那契散列取高位，避免与分片内索引取哈希低位的探测位置相关
+    return static_cast<size_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull) >> 32) & shard_mask_;
+}
+
+size_t DNSCache::shard_of(std::string_view hostname) const {
+    return shardIndex(DNSHostname::hashOf(hostname));
+}
+
+DNSCache::~DNSCache() {
+    stopExpiryThread();
 }
 
 void DNSCache::update(const std::string &hostname,
                       const std::vector<std::string> &ips) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    cleanup();
-    if (cache_.size() >= max_size_) {
-        // 如果缓存已满，移除最早过期的记录
-        auto oldest = std::ranges::min_element(cache_,
-                                               [](const auto &a, const auto &b) {
-                                                   return a.second.expire_time < b.second.expire_time;
-                                               });
-        if (oldest != cache_.end()) {
-            cache_.erase(oldest);
-        } else {
-            // 如果找不到最早过期的记录，移除第一个记录
-            if (!cache_.empty()) {
-                cache_.erase(cache_.begin());
-            }
-        }
+    update(hostname, DNSAddressList::fromStrings(ips), ttl_.load(std::memory_order_relaxed));
+}
+
+void DNSCache::update(const std::string &hostname,
+                      const std::vector<std::string> &ips,
+                      std::chrono::seconds ttl) {
+    update(hostname, DNSAddressList::fromStrings(ips), ttl);
+}
+
+void DNSCache::update(const std::string &hostname,
+                      const DNSAddressList &ips) {
+    update(hostname, ips, ttl_.load(std::memory_order_relaxed));
+}
+
+void DNSCache::update(const std::string &hostname,
+                      const DNSAddressList &ips,
+                      std::chrono::seconds ttl) {
+    ttl = std::clamp(ttl, min_ttl_.load(std::memory_order_relaxed), max_ttl_.load(std::memory_order_relaxed));
+    // 新记录在锁外构造，持锁期间只交换指针
+    auto record = std::make_shared<DNSRecord>();
+    record->hostname = hostname;
+    record->ip_addresses = ips;
+    record->expire_time = std::chrono::system_clock::now() + ttl;
+    record->ttl = ttl;
+    record->is_valid = true;
+    publish(std::move(record));
+}
+
+void DNSCache::update(const std::string &key,
+                      std::shared_ptr<const DNSRecordSet> records,
+                      std::chrono::seconds ttl) {
+    ttl = std::clamp(ttl, min_ttl_.load(std::memory_order_relaxed), max_ttl_.load(std::memory_order_relaxed));
+    auto record = std::make_shared<DNSRecord>();
+    record->hostname = key;
+    record->records = std::move(records);
+    record->expire_time = std::chrono::system_clock::now() + ttl;
+    record->ttl = ttl;
+    record->is_valid = true;
+    publish(std::move(record));
+}
+
+void DNSCache::publish(std::shared_ptr<DNSRecord> record) {
+    const HashedKey key{record->hostname, DNSHostname::hashOf(record->hostname)};
+    auto &shard = *shards_[shardIndex(key.hash)];
+    const auto now = std::chrono::system_clock::now();
+
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    // 顺带清理少量过期记录，剩余的交给后台线程
+    shard.positive.purgeExpired(now, EXPIRE_BATCH_INLINE);
+    if (const auto observer = write_observer_.load(std::memory_order_acquire)) {
+        (*observer)(record->hostname, record);
     }
-    DNSRecord record;
-    record.ip_addresses = ips;
-    record.expire_time = std::chrono::system_clock::now() + ttl_;
-    record.is_valid = true;
-    cache_[hostname] = std::move(record);
+    shard.positive.insert(key, std::move(record));
+    shard.negative.erase(key);
 }
 
-bool DNSCache::get(const std::string &hostname, std::vector<std::string> &ips) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    const auto it = cache_.find(hostname);
-    if (it == cache_.end()) {
-        ++misses_;
-        return false;
+void DNSCache::updateNegative(const std::string &hostname, DNSNegativeKind kind) {
+    updateNegative(hostname, kind, negative_ttl_.load(std::memory_order_relaxed));
+}
+
+void DNSCache::updateNegative(const std::string &hostname, DNSNegativeKind kind, std::chrono::seconds ttl) {
+    if (negative_max_size_.load(std::memory_order_relaxed) == 0 || kind == DNSNegativeKind::None) {
+        return;
+    }
+    const auto negative_ttl = negative_ttl_.load(std::memory_order_relaxed);
+    ttl = std::clamp(ttl, std::min(min_ttl_.load(std::memory_order_relaxed), negative_ttl), negative_ttl);
+    const HashedKey key{hostname, DNSHostname::hashOf(hostname)};
+    auto &shard = *shards_[shardIndex(key.hash)];
+    const auto now = std::chrono::system_clock::now();
+    auto record = std::make_shared<DNSRecord>();
+    record->hostname = hostname;
+    record->expire_time = now + ttl;
+    record->ttl = ttl;
+    record->is_valid = true;
+    record->negative = kind;
+
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.negative.purgeExpired(now, EXPIRE_BATCH_INLINE);
+    if (const auto observer = write_observer_.load(std::memory_order_acquire)) {
+        (*observer)(hostname, record);
+    }
+    shard.negative.insert(key, std::move(record));
+    shard.positive.erase(key);
+}
+
+DNSNegativeKind DNSCache::getNegative(std::string_view hostname) {
+    std::chrono::seconds remaining_ttl{};
+    return getNegative(hostname, remaining_ttl);
+}
+
+DNSNegativeKind DNSCache::getNegative(std::string_view hostname, std::chrono::seconds &remaining_ttl) {
+    return getNegative(HashedKey{hostname, DNSHostname::hashOf(hostname)}, remaining_ttl);
+}
+
+DNSNegativeKind DNSCache::getNegative(const HashedKey &key, std::chrono::seconds &remaining_ttl) {
+    if (negative_max_size_.load(std::memory_order_relaxed) == 0) {
+        return DNSNegativeKind::None;
     }
-    auto &record = it->second;
+    auto &shard = *shards_[shardIndex(key.hash)];
     const auto now = std::chrono::system_clock::now();
-    if (now >= record.expire_time || !record.is_valid) {
-        cache_.erase(it);
-        ++misses_;
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    const auto *found = shard.negative.find(key);
+    // 过期的否定记录留给清理线程删除
+    if (!found || now >= found->expire_time || !found->record->is_valid) {
+        return DNSNegativeKind::None;
+    }
+    const auto &entry = *found;
+    if (!entry.referenced.load(std::memory_order_relaxed)) {
+        entry.referenced.store(true, std::memory_order_relaxed);
+    }
+    shard.negative_hits.fetch_add(1, std::memory_order_relaxed);
+    remaining_ttl = std::chrono::duration_cast<std::chrono::seconds>(entry.expire_time - now);
+    return entry.record->negative;
+}
+
+bool DNSCache::get(std::string_view hostname, std::vector<std::string> &ips) {
+    const auto record = find(hostname);
+    if (!record) {
         return false;
     }
+    ips = record->ip_addresses.toStrings();
+    return true;
+}
 
-    ips = record.ip_addresses;
-    ++hits_;
+bool DNSCache::get(std::string_view hostname, DNSAddressList &ips) {
+    const auto record = find(hostname);
+    if (!record) {
+        return false;
+    }
+    ips = record->ip_addresses;
+    return true;
+}
 
-    // 如果记录即将过期（TTL的20%以内），异步刷新
-    const auto remaining = std::chrono::duration_cast<std::chrono::seconds>(
-                                   record.expire_time - now)
-                                   .count();
-    if (remaining < static_cast<int64_t>(ttl_.count() * 0.2)) {
-        record.is_valid = false;// 标记为需要刷新
+bool DNSCache::get(std::string_view hostname, DNSAddressList &ips, std::chrono::seconds &remaining_ttl) {
+    const auto record = find(hostname, remaining_ttl);
+    if (!record) {
+        return false;
     }
+    ips = record->ip_addresses;
     return true;
 }
 
-void DNSCache::remove(const std::string &hostname) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    cache_.erase(hostname);
+DNSCache::RecordPtr DNSCache::find(std::string_view hostname) {
+    std::chrono::seconds remaining_ttl{};
+    return find(hostname, remaining_ttl);
+}
+
+DNSCache::RecordPtr DNSCache::find(std::string_view hostname, std::chrono::seconds &remaining_ttl) {
+    return find(HashedKey{hostname, DNSHostname::hashOf(hostname)}, remaining_ttl);
+}
+
+DNSCache::RecordPtr DNSCache::peek(std::string_view hostname) const {
+    const HashedKey key{hostname, DNSHostname::hashOf(hostname)};
+    const auto &shard = *shards_[shardIndex(key.hash)];
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    const auto *found = shard.positive.find(key);
+    if (!found || std::chrono::system_clock::now() >= found->expire_time || !found->record->is_valid) {
+        return nullptr;
+    }
+    return found->record;
+}
+
+DNSCache::RecordPtr DNSCache::find(const DNSHostname &hostname) {
+    std::chrono::seconds remaining_ttl{};
+    return find(hostname, remaining_ttl);
+}
+
+DNSCache::RecordPtr DNSCache::find(const DNSHostname &hostname, std::chrono::seconds &remaining_ttl) {
+    return find(HashedKey{hostname.view(), hostname.hash()}, remaining_ttl);
+}
+
+DNSCache::RecordPtr DNSCache::find(const HashedKey &key, std::chrono::seconds &remaining_ttl) {
+    auto &shard = *shards_[shardIndex(key.hash)];
+    const auto now = std::chrono::system_clock::now();
+    RecordPtr record;
+    uint32_t refresh_hits = 0;
+    {
+        // 命中路径只持有读锁，只修改记录上的原子标志
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        const auto *found = shard.positive.find(key);
+        if (!found) {
+            shard.misses.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        const auto &entry = *found;
+        if (now >= entry.expire_time || !entry.record->is_valid) {
+            lock.unlock();
+            eraseExpired(shard, key, now);
+            return nullptr;
+        }
+        record = entry.record;
+        remaining_ttl = std::chrono::duration_cast<std::chrono::seconds>(entry.expire_time - now);
+        if (!entry.referenced.load(std::memory_order_relaxed)) {
+            entry.referenced.store(true, std::memory_order_relaxed);
+        }
+        shard.hits.fetch_add(1, std::memory_order_relaxed);
+        const auto hits = entry.hits.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        // 记录进入TTL末段时提交一次异步刷新，期间继续返回当前结果
+        const double threshold = refresh_threshold_.load(std::memory_order_relaxed);
+        if (refresh_fn_ && hits >= refresh_min_hits_ &&
+            entry.expire_time - now < std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                              record->ttl * threshold) &&
+            !entry.refresh_pending.exchange(true, std::memory_order_relaxed)) {
+            refresh_hits = hits;
+        }
+    }
+
+    if (refresh_hits > 0) {
+        refresh_fn_(record->hostname, refresh_hits);
+    }
+    return record;
+}
+
+size_t DNSCache::bulkInsert(std::vector<DNSRecord> &&records) {
+    const auto now = std::chrono::system_clock::now();
+    const bool negative_enabled = negative_max_size_.load(std::memory_order_relaxed) > 0;
+    const auto min_ttl = min_ttl_.load(std::memory_order_relaxed);
+    const auto max_ttl = max_ttl_.load(std::memory_order_relaxed);
+    const auto negative_ttl = negative_ttl_.load(std::memory_order_relaxed);
+    // 主机名的哈希只算一次，分片定位与表内查找共用
+    std::vector<std::vector<std::pair<DNSRecord *, size_t>>> by_shard(shards_.size());
+    for (auto &record: records) {
+        if (record.is_valid && record.expire_time > now &&
+            (record.negative == DNSNegativeKind::None || negative_enabled)) {
+            const size_t hash = DNSHostname::hashOf(record.hostname);
+            by_shard[shardIndex(hash)].emplace_back(&record, hash);
+        }
+    }
+
+    const auto observer = write_observer_.load(std::memory_order_acquire);
+    size_t inserted = 0;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (by_shard[i].empty()) {
+            continue;
+        }
+        auto &shard = *shards_[i];
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.positive.reserve(std::min(shard.positive.max_size, shard.positive.size() + by_shard[i].size()));
+        for (const auto &[record, hash]: by_shard[i]) {
+            const bool negative = record->negative != DNSNegativeKind::None;
+            record->ttl = negative ? std::min(record->ttl, negative_ttl) : std::clamp(record->ttl, min_ttl, max_ttl);
+            auto shared = std::make_shared<const DNSRecord>(std::move(*record));
+            // 键引用shared中的主机名，先删除另一张表中的同名记录，插入后shared可能已被释放（容量为0时）
+            const HashedKey key{shared->hostname, hash};
+            if (observer) {
+                (*observer)(shared->hostname, shared);
+            }
+            if (negative) {
+                shard.positive.erase(key);
+                shard.negative.insert(key, std::move(shared));
+            } else {
+                shard.negative.erase(key);
+                shard.positive.insert(key, std::move(shared));
+            }
+            ++inserted;
+        }
+    }
+    return inserted;
+}
+
+bool DNSCache::eraseExpired(Shard &shard, const HashedKey &key, std::chrono::system_clock::time_point now) {
+    // 记录已过期，持有写锁后再次确认并删除
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        const uint32_t slot = shard.positive.lookup(key);
+        if (slot != DNSFlatIndex::NPOS) {
+            const auto &entry = shard.positive.at(slot);
+            if (now >= entry.expire_time || !entry.record->is_valid) {
+                shard.positive.erase(slot);
+            }
+        }
+    }
+    shard.misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void DNSCache::setRefreshCallback(RefreshFn fn, double threshold, uint32_t min_hits) {
+    refresh_fn_ = std::move(fn);
+    refresh_threshold_ = std::clamp(threshold, 0.0, 1.0);
+    refresh_min_hits_ = std::max<uint32_t>(1, min_hits);
+}
+
+void DNSCache::setWriteObserver(WriteFn fn) {
+    write_observer_.store(fn ? std::make_shared<const WriteFn>(std::move(fn)) : nullptr, std::memory_order_release);
+}
+
+void DNSCache::remove(std::string_view hostname) {
+    const HashedKey key{hostname, DNSHostname::hashOf(hostname)};
+    auto &shard = *shards_[shardIndex(key.hash)];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (const auto observer = write_observer_.load(std::memory_order_acquire)) {
+        (*observer)(std::string(hostname), nullptr);
+    }
+    shard.positive.erase(key);
+    shard.negative.erase(key);
 }
 
 void DNSCache::clear() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    cache_.clear();
-    hits_ = 0;
-    misses_ = 0;
+    // 持有全部分片锁后再通知观察者，并发写入要么在清空之前，要么在日志中的清空之后
+    std::vector<std::unique_lock<std::shared_mutex>> locks;
+    locks.reserve(shards_.size());
+    for (const auto &shard: shards_) {
+        locks.emplace_back(shard->mutex);
+    }
+    if (const auto observer = write_observer_.load(std::memory_order_acquire)) {
+        (*observer)({}, nullptr);
+    }
+    for (const auto &shard: shards_) {
+        shard->positive.clear();
+        shard->negative.clear();
+        shard->hits = 0;
+        shard->misses = 0;
+        shard->negative_hits = 0;
+    }
 }
 
 void DNSCache::forEach(const ForEachFn &fn) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (const auto &[hostname, record]: cache_) {
-        fn(hostname, record);
+    for (const auto &shard: shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        for (const auto *table: {&shard->positive, &shard->negative}) {
+            table->forEach([&](const Entry &entry) { fn(entry.record->hostname, *entry.record); });
+        }
+    }
+}
+
+std::vector<DNSCache::RecordPtr> DNSCache::snapshot() const {
+    std::vector<RecordPtr> records;
+    for (const auto &shard: shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        for (const auto *table: {&shard->positive, &shard->negative}) {
+            table->forEach([&](const Entry &entry) { records.push_back(entry.record); });
+        }
     }
+    return records;
 }
 
 size_t DNSCache::size() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return cache_.size();
+    size_t total = 0;
+    for (const auto &shard: shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        total += shard->positive.size();
+    }
+    return total;
 }
 
 size_t DNSCache::capacity() const {
     return max_size_;
 }
 
+size_t DNSCache::shard_count() const {
+    return shards_.size();
+}
+
+size_t DNSCache::negative_size() const {
+    size_t total = 0;
+    for (const auto &shard: shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        total += shard->negative.size();
+    }
+    return total;
+}
+
+size_t DNSCache::negative_capacity() const {
+    return negative_max_size_;
+}
+
+size_t DNSCache::negative_hits() const {
+    size_t hits = 0;
+    for (const auto &shard: shards_) {
+        hits += shard->negative_hits.load(std::memory_order_relaxed);
+    }
+    return hits;
+}
+
 double DNSCache::hit_rate() const {
-    const auto total = hits_.load() + misses_.load();
+    size_t hits = 0;
+    size_t misses = 0;
+    for (const auto &shard: shards_) {
+        hits += shard->hits.load(std::memory_order_relaxed);
+        misses += shard->misses.load(std::memory_order_relaxed);
+    }
+    const auto total = hits + misses;
     if (total == 0) {
         return 0.0;
     }
-    return static_cast<double>(hits_.load()) / total;
+    return static_cast<double>(hits) / total;
+}
+
+size_t DNSCache::purgeExpired(size_t budget_per_shard) {
+    size_t purged = 0;
+    for (const auto &shard: shards_) {
+        const auto now = std::chrono::system_clock::now();
+        std::unique_lock<std::shared_mutex> lock(shard->mutex);
+        purged += shard->positive.purgeExpired(now, budget_per_shard);
+        purged += shard->negative.purgeExpired(now, budget_per_shard);
+    }
+    return purged;
+}
+
+void DNSCache::startExpiryThread(std::chrono::milliseconds interval) {
+    std::lock_guard<std::mutex> lock(expiry_mutex_);
+    if (expiry_running_) {
+        return;
+    }
+    expiry_running_ = true;
+    expiry_thread_ = std::thread([this, interval] {
+        std::unique_lock<std::mutex> lock(expiry_mutex_);
+        while (expiry_running_) {
+            expiry_cv_.wait_for(lock, interval, [this] { return !expiry_running_; });
+            if (!expiry_running_) {
+                break;
+            }
+            lock.unlock();
+            // 每轮每个分片只处理有限数量，清理不完的留到下一轮，避免长时间持有分片锁
+            purgeExpired(EXPIRE_BATCH_BACKGROUND);
+            lock.lock();
+        }
+    });
+}
+
+void DNSCache::stopExpiryThread() {
+    {
+        std::lock_guard<std::mutex> lock(expiry_mutex_);
+        if (!expiry_running_) {
+            return;
+        }
+        expiry_running_ = false;
+    }
+    expiry_cv_.notify_all();
+    if (expiry_thread_.joinable()) {
+        expiry_thread_.join();
+    }
+}
+
+uint32_t DNSCache::Table::lookup(const HashedKey &key) const {
+    return index.find(key.hash, [&](uint32_t slot) {
+        const auto &entry = at(slot);
+        return entry.hash == key.hash && entry.record->hostname == key.name;
+    });
+}
+
+const DNSCache::Entry *DNSCache::Table::find(const HashedKey &key) const {
+    const uint32_t slot = lookup(key);
+    return slot == DNSFlatIndex::NPOS ? nullptr : &at(slot);
+}
+
+void DNSCache::Table::insert(const HashedKey &key, RecordPtr record) {
+    if (const uint32_t slot = lookup(key); slot != DNSFlatIndex::NPOS) {
+        // 替换为新发布的记录并调整堆中位置，旧记录在最后一个读者释放后销毁
+        auto &entry = at(slot);
+        entry.expire_time = record->expire_time;
+        entry.record = std::move(record);
+        entry.hits.store(0, std::memory_order_relaxed);
+        entry.refresh_pending.store(false, std::memory_order_relaxed);
+        heapFix(entry.heap_index);
+        return;
+    }
+
+    if (max_size == 0) {
+        return;
+    }
+    if (size() >= max_size) {
+        evictOne();
+    }
+
+    // 优先复用刚被淘汰的槽位，它位于指针之前，成为本轮扫描中最后被检查的记录
+    const uint32_t slot = allocateSlot();
+    auto &entry = at(slot);
+    entry.used = true;
+    entry.hash = key.hash;
+    entry.expire_time = record->expire_time;
+    entry.record = std::move(record);
+    index.insert(key.hash, slot, [this](uint32_t other) { return at(other).hash; });
+    heapPush(slot);
+}
+
+uint32_t DNSCache::Table::allocateSlot() {
+    if (!free_slots.empty()) {
+        const uint32_t slot = free_slots.back();
+        free_slots.pop_back();
+        return slot;
+    }
+    if (slot_count % ENTRY_CHUNK == 0) {
+        chunks.push_back(std::make_unique<Entry[]>(ENTRY_CHUNK));
+    }
+    return slot_count++;
 }
 
-void DNSCache::cleanup() {
-    auto now = std::chrono::system_clock::now();
-    // 使用删除-擦除习语
-    for (auto it = cache_.begin(); it != cache_.end();) {
-        if (now >= it->second.expire_time || !it->second.is_valid) {
-            it = cache_.erase(it);
-        } else {
-            ++it;
+void DNSCache::Table::erase(uint32_t slot) {
+    auto &entry = at(slot);
+    index.erase(entry.hash, slot);
+    heapRemove(entry.heap_index);
+    entry.record.reset();
+    entry.used = false;
+    entry.referenced.store(false, std::memory_order_relaxed);
+    entry.hits.store(0, std::memory_order_relaxed);
+    entry.refresh_pending.store(false, std::memory_order_relaxed);
+    free_slots.push_back(slot);
+}
+
+void DNSCache::Table::erase(const HashedKey &key) {
+    if (const uint32_t slot = lookup(key); slot != DNSFlatIndex::NPOS) {
+        erase(slot);
+    }
+}
+
+void DNSCache::Table::evictOne() {
+    if (size() == 0) {
+        return;
+    }
+    // 最多扫描两圈：第一圈清除引用位，第二圈必然找到可淘汰的记录
+    for (size_t scanned = 0; scanned <= size_t{slot_count} * 2; ++scanned) {
+        if (hand >= slot_count) {
+            hand = 0;
         }
+        const uint32_t slot = hand++;
+        auto &entry = at(slot);
+        if (!entry.used || entry.referenced.exchange(false, std::memory_order_relaxed)) {
+            continue;
+        }
+        erase(slot);
+        return;
     }
-    // 如果缓存大小超过最大限制的90%，主动清理最早过期的记录
-    if (cache_.size() > max_size_ * 0.9) {
-        std::vector<std::pair<std::string, std::chrono::system_clock::time_point>> expire_times;
-        expire_times.reserve(cache_.size());
-        for (const auto &[hostname, record]: cache_) {
-            expire_times.emplace_back(hostname, record.expire_time);
+}
+
+size_t DNSCache::Table::purgeExpired(std::chrono::system_clock::time_point now, size_t budget) {
+    size_t purged = 0;
+    while (purged < budget && !expiry_heap.empty()) {
+        const uint32_t slot = expiry_heap.front();
+        const auto &entry = at(slot);
+        if (entry.expire_time > now && entry.record->is_valid) {
+            break;
         }
-        // 按过期时间排序
-        std::ranges::sort(expire_times,
-                          [](const auto &a, const auto &b) {
-                              return a.second < b.second;
-                          });
+        erase(slot);
+        ++purged;
+    }
+    return purged;
+}
 
-        // 删除20%的最早过期记录
-        const auto records_to_remove = static_cast<size_t>(cache_.size() * 0.2);
-        for (size_t i = 0; i < records_to_remove && i < expire_times.size(); ++i) {
-            cache_.erase(expire_times[i].first);
+void DNSCache::Table::reserve(size_t count) {
+    index.reserve(count, [this](uint32_t slot) { return at(slot).hash; });
+    chunks.reserve((count + ENTRY_CHUNK - 1) / ENTRY_CHUNK);
+    expiry_heap.reserve(count);
+}
+
+void DNSCache::Table::clear() {
+    expiry_heap.clear();
+    index.clear();
+    chunks.clear();
+    free_slots.clear();
+    slot_count = 0;
+    hand = 0;
+}
+
+void DNSCache::Table::heapPush(uint32_t slot) {
+    at(slot).heap_index = static_cast<uint32_t>(expiry_heap.size());
+    expiry_heap.push_back(slot);
+    heapSiftUp(expiry_heap.size() - 1);
+}
+
+void DNSCache::Table::heapRemove(size_t index) {
+    const size_t last = expiry_heap.size() - 1;
+    if (index != last) {
+        heapSwap(index, last);
+    }
+    expiry_heap.pop_back();
+    if (index < expiry_heap.size()) {
+        heapFix(index);
+    }
+}
+
+void DNSCache::Table::heapFix(size_t index) {
+    if (!heapSiftUp(index)) {
+        heapSiftDown(index);
+    }
+}
+
+void DNSCache::Table::heapSwap(size_t a, size_t b) {
+    std::swap(expiry_heap[a], expiry_heap[b]);
+    at(expiry_heap[a]).heap_index = static_cast<uint32_t>(a);
+    at(expiry_heap[b]).heap_index = static_cast<uint32_t>(b);
+}
+
+bool DNSCache::Table::heapSiftUp(size_t index) {
+    bool moved = false;
+    while (index > 0) {
+        const size_t parent = (index - 1) / 2;
+        if (at(expiry_heap[parent]).expire_time <= at(expiry_heap[index]).expire_time) {
+            break;
         }
+        heapSwap(parent, index);
+        index = parent;
+        moved = true;
     }
-}
\ No newline at end of file
+    return moved;
+}
+
+void DNSCache::Table::heapSiftDown(size_t index) {
+    const size_t count = expiry_heap.size();
+    while (true) {
+        size_t smallest = index;
+        const size_t left = index * 2 + 1;
+        const size_t right = left + 1;
+        if (left < count && at(expiry_heap[left]).expire_time < at(expiry_heap[smallest]).expire_time) {
+            smallest = left;
+        }
+        if (right < count && at(expiry_heap[right]).expire_time < at(expiry_heap[smallest]).expire_time) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            return;
+        }
+        heapSwap(index, smallest);
+        index = smallest;
+    }
+}
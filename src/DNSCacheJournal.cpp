@@ -0,0 +1,554 @@
+#include "DNSCacheJournal.h"
+#include "DNSCachePersistor.h"
+#include "DNSUtils.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+namespace {
+    // 日志格式（整数均为小端）：
+    //   文件头(16字节) | 条目...
+    // 文件头：magic(4) version(2) header_size(2) seq(8)
+    // 条目：length(4) crc32(4) 内容(length)，crc32只覆盖内容
+    // 内容：op(1) negative(1) name_len(2) ttl(4) expire_time(8) v4_count(1) v6_count(1) 主机名 地址
+    // 地址先IPv4(4字节)后IPv6(16字节)；删除与清空没有地址，清空也没有主机名
+    constexpr uint32_t JOURNAL_MAGIC = 0x4A534E44;// "DNSJ"
+    constexpr uint16_t JOURNAL_VERSION = 1;
+    constexpr size_t JOURNAL_HEADER_SIZE = 16;
+    constexpr size_t JOURNAL_ENTRY_HEADER_SIZE = 8;
+    constexpr size_t JOURNAL_PAYLOAD_PREFIX_SIZE = 18;
+    constexpr size_t JOURNAL_MAX_ADDRESSES = 255;// 每种地址族的上限
+    constexpr size_t JOURNAL_REPLAY_CHUNK = 4096;// 每批交给bulkInsert的记录数
+    // 检查点失败后等待一段时间再重试，避免磁盘满时反复写快照
+    constexpr std::chrono::seconds CHECKPOINT_RETRY_DELAY{10};
+
+    enum class JournalOp : uint8_t {
+        Put = 1,
+        Remove = 2,
+        Clear = 3,
+    };
+}// namespace
+
+DNSCacheJournal::DNSCacheJournal(std::shared_ptr<DNSCache> cache, std::string snapshot_file, Options options)
+    : cache_(std::move(cache)), snapshot_file_(std::move(snapshot_file)), options_(options),
+      buffer_(std::make_shared<Buffer>()) {
+    buffer_->wake_size = options_.max_buffer_size;
+    const size_t lanes = cache_->shard_count();
+    buffer_->lanes.reserve(lanes);
+    for (size_t i = 0; i < lanes; ++i) {
+        buffer_->lanes.push_back(std::make_unique<Lane>());
+    }
+    write_buffers_.resize(lanes);
+}
+
+DNSCacheJournal::DNSCacheJournal(std::shared_ptr<DNSCache> cache, std::string snapshot_file)
+    : DNSCacheJournal(std::move(cache), std::move(snapshot_file), Options{}) {}
+
+DNSCacheJournal::DNSCacheJournal(std::shared_ptr<DNSCache> cache, const CacheConfig &config)
+    : DNSCacheJournal(std::move(cache), config.cache_file,
+                      Options{.flush_interval = std::chrono::milliseconds(config.journal_flush_interval_ms),
+                              .checkpoint_interval = config.checkpoint_interval,
+                              .max_log_size = config.journal_max_size}) {}
+
+DNSCacheJournal::~DNSCacheJournal() {
+    stop();
+}
+
+std::string DNSCacheJournal::logFile(uint64_t seq) const {
+    return snapshot_file_ + ".wal." + std::to_string(seq);
+}
+
+bool DNSCacheJournal::running() const {
+    std::lock_guard<std::mutex> lock(buffer_->mutex);
+    return buffer_->running;
+}
+
+bool DNSCacheJournal::recover() {
+    if (running()) {
+        return false;
+    }
+    bool found = false;
+    // 配置校验检查目录可写时可能留下空文件
+    std::error_code ec;
+    if (std::filesystem::file_size(snapshot_file_, ec) > 0 && !ec) {
+        found = DNSCachePersistor::load(*cache_, snapshot_file_);
+    }
+    // 按序号重放：快照之后的写入都在日志中，快照已覆盖的旧日志重放后结果不变
+    for (const auto seq: existingLogs()) {
+        replayed_.fetch_add(replay(logFile(seq)), std::memory_order_relaxed);
+        found = true;
+    }
+    std::lock_guard<std::mutex> guard(checkpoint_mutex_);
+    checkpoint_pending_ = found;
+    return found;
+}
+
+bool DNSCacheJournal::start() {
+    if (snapshot_file_.empty()) {
+        std::cerr << "Cache journal requires a snapshot file" << std::endl;
+        return false;
+    }
+    if (running()) {
+        return true;
+    }
+    const auto logs = existingLogs();
+    {
+        std::lock_guard<std::mutex> lock(file_mutex_);
+        if (!openLog(logs.empty() ? 1 : logs.back() + 1)) {
+            seq_ = 0;
+            return false;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> guard(checkpoint_mutex_);
+        last_checkpoint_ = std::chrono::steady_clock::now();
+        retry_after_ = last_checkpoint_;
+    }
+    {
+        std::lock_guard<std::mutex> lock(buffer_->mutex);
+        buffer_->running = true;
+    }
+    cache_->setWriteObserver(
+            [buffer = buffer_, cache = cache_.get()](const std::string &hostname, const DNSCache::RecordPtr &record) {
+                append(*buffer, hostname.empty() ? 0 : cache->shard_of(hostname), hostname, record);
+            });
+    thread_ = std::thread(&DNSCacheJournal::run, this);
+    return true;
+}
+
+void DNSCacheJournal::stop() {
+    {
+        std::lock_guard<std::mutex> lock(buffer_->mutex);
+        if (!buffer_->running) {
+            return;
+        }
+        buffer_->running = false;
+    }
+    cache_->setWriteObserver(nullptr);
+    buffer_->cv.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    flush();
+    checkpoint();
+
+    // 最后一次检查点之后的日志为空，直接删除
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    if (log_.is_open()) {
+        log_.close();
+        if (log_size_ <= JOURNAL_HEADER_SIZE) {
+            std::error_code ec;
+            std::filesystem::remove(logFile(seq_), ec);
+        }
+    }
+    seq_ = 0;
+    current_log_size_ = 0;
+}
+
+void DNSCacheJournal::append(Buffer &buffer, size_t lane, const std::string &hostname,
+                             const DNSCache::RecordPtr &record) {
+    if (hostname.size() > UINT16_MAX) {
+        return;
+    }
+    // 条目格式只能表示地址：类型化记录（SRV/TXT等）记为删除，重放时不再恢复它替换掉的否定记录
+    if (record && record->records) {
+        append(buffer, lane, hostname, nullptr);
+        return;
+    }
+    JournalOp op = JournalOp::Put;
+    size_t v4_count = 0;
+    size_t v6_count = 0;
+    if (!record) {
+        op = hostname.empty() ? JournalOp::Clear : JournalOp::Remove;
+    } else {
+        for (const auto &address: record->ip_addresses) {
+            v4_count += address.isV4();
+            v6_count += address.isV6();
+        }
+        v4_count = std::min(v4_count, JOURNAL_MAX_ADDRESSES);
+        v6_count = std::min(v6_count, JOURNAL_MAX_ADDRESSES);
+    }
+    const size_t length = JOURNAL_PAYLOAD_PREFIX_SIZE + hostname.size() + v4_count * 4 + v6_count * 16;
+
+    std::vector<std::unique_lock<std::mutex>> locks;
+    if (op == JournalOp::Clear) {
+        locks.reserve(buffer.lanes.size());
+        for (const auto &other: buffer.lanes) {
+            locks.emplace_back(other->mutex);
+        }
+        lane = 0;
+    } else {
+        locks.emplace_back(buffer.lanes[lane]->mutex);
+    }
+    if (!buffer.running.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (op == JournalOp::Clear) {
+        for (const auto &other: buffer.lanes) {
+            other->data.clear();
+            other->entries = 0;
+        }
+        buffer.pending.store(0, std::memory_order_relaxed);
+    }
+
+    // 按条目长度一次扩容，条目头直接写入预留的位置
+    ++buffer.lanes[lane]->entries;
+    auto &out = buffer.lanes[lane]->data;
+    const size_t start = out.size();
+    out.resize(start + JOURNAL_ENTRY_HEADER_SIZE + length);
+    char *entry = out.data() + start + JOURNAL_ENTRY_HEADER_SIZE;
+    char *cursor = entry;
+    *cursor++ = static_cast<char>(op);
+    *cursor++ = static_cast<char>(record ? record->negative : DNSNegativeKind::None);
+    DNSUtils::putLE<uint16_t>(cursor, static_cast<uint16_t>(hostname.size()));
+    cursor += sizeof(uint16_t);
+    DNSUtils::putLE<uint32_t>(cursor, record ? static_cast<uint32_t>(record->ttl.count()) : 0);
+    cursor += sizeof(uint32_t);
+    DNSUtils::putLE<int64_t>(cursor, record ? std::chrono::duration_cast<std::chrono::seconds>(
+                                                      record->expire_time.time_since_epoch())
+                                                      .count()
+                                            : 0);
+    cursor += sizeof(int64_t);
+    *cursor++ = static_cast<char>(v4_count);
+    *cursor++ = static_cast<char>(v6_count);
+    cursor = std::copy(hostname.begin(), hostname.end(), cursor);
+    if (record) {
+        for (const int family: {AF_INET, AF_INET6}) {
+            size_t remaining = family == AF_INET ? v4_count : v6_count;
+            for (const auto &address: record->ip_addresses) {
+                if (remaining > 0 && address.family() == family) {
+                    std::memcpy(cursor, address.data(), address.size());
+                    cursor += address.size();
+                    --remaining;
+                }
+            }
+        }
+    }
+    DNSUtils::putLE<uint32_t>(out.data() + start, static_cast<uint32_t>(length));
+    DNSUtils::putLE<uint32_t>(out.data() + start + 4, DNSUtils::crc32Update(0, entry, length));
+
+    const size_t size = JOURNAL_ENTRY_HEADER_SIZE + length;
+    const size_t pending = buffer.pending.fetch_add(size, std::memory_order_relaxed);
+    locks.clear();
+    buffer.appended.fetch_add(1, std::memory_order_relaxed);
+    // 只在越过阈值时唤醒；经过等待锁再通知，写线程检查条件与进入等待之间不会错过
+    if (pending < buffer.wake_size && pending + size >= buffer.wake_size) {
+        {
+            std::lock_guard<std::mutex> lock(buffer.mutex);
+        }
+        buffer.cv.notify_one();
+    }
+}
+
+void DNSCacheJournal::run() {
+    std::unique_lock<std::mutex> lock(buffer_->mutex);
+    while (buffer_->running) {
+        buffer_->cv.wait_for(lock, options_.flush_interval, [this] {
+            return !buffer_->running || buffer_->pending.load(std::memory_order_relaxed) >= buffer_->wake_size;
+        });
+        if (!buffer_->running) {
+            break;
+        }
+        lock.unlock();
+        flush();
+
+        bool due;
+        {
+            std::lock_guard<std::mutex> guard(checkpoint_mutex_);
+            const auto now = std::chrono::steady_clock::now();
+            due = now >= retry_after_ &&
+                  (checkpoint_pending_ || log_incomplete_.load(std::memory_order_relaxed) ||
+                   current_log_size_.load(std::memory_order_relaxed) >= options_.max_log_size ||
+                   now - last_checkpoint_ >= options_.checkpoint_interval);
+        }
+        if (due) {
+            checkpoint();
+        }
+        lock.lock();
+    }
+}
+
+bool DNSCacheJournal::flush() {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    return writeBuffer();
+}
+
+bool DNSCacheJournal::writeBuffer() {
+    // 同时持有全部缓冲区的锁再逐个取出，与清空互斥
+    size_t entries = 0;
+    {
+        std::vector<std::unique_lock<std::mutex>> locks;
+        locks.reserve(buffer_->lanes.size());
+        for (size_t i = 0; i < buffer_->lanes.size(); ++i) {
+            locks.emplace_back(buffer_->lanes[i]->mutex);
+            write_buffers_[i].swap(buffer_->lanes[i]->data);
+            entries += std::exchange(buffer_->lanes[i]->entries, 0);
+        }
+        buffer_->pending.store(0, std::memory_order_relaxed);
+    }
+    size_t total = 0;
+    for (const auto &data: write_buffers_) {
+        total += data.size();
+    }
+    if (total == 0) {
+        return true;
+    }
+    const auto clearAll = [this] {
+        for (auto &data: write_buffers_) {
+            data.clear();
+        }
+    };
+    const auto drop = [&] {
+        clearAll();
+        dropped_.fetch_add(entries, std::memory_order_relaxed);
+        log_incomplete_.store(true, std::memory_order_relaxed);
+    };
+    if (!log_.is_open()) {
+        drop();
+        return false;
+    }
+    // 整批条目按缓冲区顺序写入后统一刷新
+    for (const auto &data: write_buffers_) {
+        if (!data.empty()) {
+            log_.write(data.data(), static_cast<std::streamsize>(data.size()));
+        }
+    }
+    log_.flush();
+    if (!log_) {
+        // 写入失败时切换到新日志，避免后续条目接在残缺的条目之后；打开失败时由写线程稍后重试
+        std::cerr << "Error writing cache journal: " << logFile(seq_) << std::endl;
+        drop();
+        [[maybe_unused]] const bool reopened = openLog(seq_ + 1);
+        return false;
+    }
+    clearAll();
+    log_size_ += total;
+    current_log_size_.store(log_size_, std::memory_order_relaxed);
+    flushed_bytes_.fetch_add(total, std::memory_order_relaxed);
+    return true;
+}
+
+bool DNSCacheJournal::openLog(uint64_t seq) {
+    if (log_.is_open()) {
+        log_.close();
+    }
+    log_.clear();
+    seq_ = seq;
+    log_size_ = 0;
+    current_log_size_ = 0;
+    log_.open(logFile(seq), std::ios::binary | std::ios::trunc);
+    if (!log_) {
+        std::cerr << "Error opening cache journal: " << logFile(seq) << std::endl;
+        log_.close();
+        log_incomplete_.store(true, std::memory_order_relaxed);
+        return false;
+    }
+    std::string header;
+    DNSUtils::putLE<uint32_t>(header, JOURNAL_MAGIC);
+    DNSUtils::putLE<uint16_t>(header, JOURNAL_VERSION);
+    DNSUtils::putLE<uint16_t>(header, static_cast<uint16_t>(JOURNAL_HEADER_SIZE));
+    DNSUtils::putLE<uint64_t>(header, seq);
+    log_.write(header.data(), static_cast<std::streamsize>(header.size()));
+    if (!log_.flush()) {
+        std::cerr << "Error writing cache journal: " << logFile(seq) << std::endl;
+        log_.close();
+        log_incomplete_.store(true, std::memory_order_relaxed);
+        return false;
+    }
+    log_size_ = header.size();
+    current_log_size_ = log_size_;
+    return true;
+}
+
+bool DNSCacheJournal::checkpoint() {
+    std::lock_guard<std::mutex> guard(checkpoint_mutex_);
+    const auto started = std::chrono::steady_clock::now();
+    uint64_t covered;
+    bool incomplete;
+    {
+        std::lock_guard<std::mutex> lock(file_mutex_);
+        if (seq_ == 0) {
+            return false;// 尚未启动
+        }
+        // 切换前写出缓冲区：此前的写入都在旧日志中并已生效，之后的快照必然包含它们。
+        // 日志未打开时丢弃的条目同样已在缓存中生效，由这次快照补上
+        writeBuffer();
+        covered = seq_;
+        if (!openLog(seq_ + 1)) {
+            failed_checkpoints_.fetch_add(1, std::memory_order_relaxed);
+            retry_after_ = std::chrono::steady_clock::now() + CHECKPOINT_RETRY_DELAY;
+            return false;
+        }
+        incomplete = log_incomplete_.exchange(false, std::memory_order_relaxed);
+    }
+
+    // 快照逐分片复制记录指针，编码与写文件都在分片锁外进行
+    if (!DNSCachePersistor::save(*cache_, snapshot_file_)) {
+        std::cerr << "Cache checkpoint failed: " << snapshot_file_ << std::endl;
+        failed_checkpoints_.fetch_add(1, std::memory_order_relaxed);
+        retry_after_ = std::chrono::steady_clock::now() + CHECKPOINT_RETRY_DELAY;
+        if (incomplete) {
+            log_incomplete_.store(true, std::memory_order_relaxed);
+        }
+        return false;
+    }
+    for (const auto seq: existingLogs()) {
+        if (seq <= covered) {
+            std::error_code ec;
+            std::filesystem::remove(logFile(seq), ec);
+        }
+    }
+
+    const auto finished = std::chrono::steady_clock::now();
+    last_checkpoint_ = finished;
+    retry_after_ = finished;
+    checkpoint_pending_ = false;
+    last_checkpoint_duration_ = std::chrono::duration_cast<std::chrono::milliseconds>(finished - started);
+    checkpoints_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+std::vector<uint64_t> DNSCacheJournal::existingLogs() const {
+    std::vector<uint64_t> seqs;
+    const std::filesystem::path snapshot(snapshot_file_);
+    const auto directory = snapshot.has_parent_path() ? snapshot.parent_path() : std::filesystem::path(".");
+    const std::string prefix = snapshot.filename().string() + ".wal.";
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        const std::string name = it->path().filename().string();
+        if (!name.starts_with(prefix) || name.size() == prefix.size()) {
+            continue;
+        }
+        uint64_t seq = 0;
+        const char *first = name.data() + prefix.size();
+        const char *last = name.data() + name.size();
+        if (const auto [ptr, err] = std::from_chars(first, last, seq); err == std::errc() && ptr == last) {
+            seqs.push_back(seq);
+        }
+    }
+    std::sort(seqs.begin(), seqs.end());
+    return seqs;
+}
+
+size_t DNSCacheJournal::replay(const std::string &filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        return 0;
+    }
+    const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const auto *data = reinterpret_cast<const unsigned char *>(content.data());
+    if (content.size() < JOURNAL_HEADER_SIZE || DNSUtils::getLE<uint32_t>(data) != JOURNAL_MAGIC ||
+        DNSUtils::getLE<uint16_t>(data + 4) != JOURNAL_VERSION) {
+        std::cerr << "Invalid cache journal, ignoring: " << filename << std::endl;
+        return 0;
+    }
+
+    const auto now = std::chrono::system_clock::now();
+    std::vector<DNSRecord> batch;
+    const auto flushBatch = [&] {
+        if (!batch.empty()) {
+            cache_->bulkInsert(std::move(batch));
+            batch.clear();
+        }
+    };
+
+    size_t replayed = 0;
+    size_t offset = DNSUtils::getLE<uint16_t>(data + 6);
+    while (offset < content.size()) {
+        // 最后一批写入可能不完整，重放到第一个残缺或校验失败的条目为止
+        if (content.size() - offset < JOURNAL_ENTRY_HEADER_SIZE) {
+            std::cerr << "Truncated cache journal entry: " << filename << std::endl;
+            break;
+        }
+        const auto length = DNSUtils::getLE<uint32_t>(data + offset);
+        const auto crc = DNSUtils::getLE<uint32_t>(data + offset + 4);
+        const unsigned char *entry = data + offset + JOURNAL_ENTRY_HEADER_SIZE;
+        if (length < JOURNAL_PAYLOAD_PREFIX_SIZE || length > content.size() - offset - JOURNAL_ENTRY_HEADER_SIZE) {
+            std::cerr << "Truncated cache journal entry: " << filename << std::endl;
+            break;
+        }
+        if (DNSUtils::crc32Update(0, entry, length) != crc) {
+            std::cerr << "Cache journal checksum mismatch: " << filename << std::endl;
+            break;
+        }
+
+        const auto op = static_cast<JournalOp>(entry[0]);
+        const uint8_t negative = entry[1];
+        const auto name_len = DNSUtils::getLE<uint16_t>(entry + 2);
+        const auto ttl = DNSUtils::getLE<uint32_t>(entry + 4);
+        const auto expire_time = DNSUtils::getLE<int64_t>(entry + 8);
+        const uint8_t v4_count = entry[16];
+        const uint8_t v6_count = entry[17];
+        if (JOURNAL_PAYLOAD_PREFIX_SIZE + name_len + v4_count * 4ull + v6_count * 16ull != length ||
+            negative > static_cast<uint8_t>(DNSNegativeKind::NoData)) {
+            std::cerr << "Corrupt cache journal entry: " << filename << std::endl;
+            break;
+        }
+        const std::string hostname(reinterpret_cast<const char *>(entry + JOURNAL_PAYLOAD_PREFIX_SIZE), name_len);
+        offset += JOURNAL_ENTRY_HEADER_SIZE + length;
+        ++replayed;
+
+        DNSRecord record;
+        record.expire_time = std::chrono::system_clock::time_point(std::chrono::seconds(expire_time));
+        switch (op) {
+            case JournalOp::Put:
+                // 已过期的写入会覆盖更早的记录，按删除处理
+                if (record.expire_time > now) {
+                    break;
+                }
+                [[fallthrough]];
+            case JournalOp::Remove:
+                flushBatch();
+                cache_->remove(hostname);
+                continue;
+            case JournalOp::Clear:
+                batch.clear();
+                cache_->clear();
+                continue;
+            default:
+                std::cerr << "Unknown cache journal operation: " << filename << std::endl;
+                continue;
+        }
+
+        record.hostname = hostname;
+        record.ttl = std::chrono::seconds(ttl);
+        record.is_valid = true;
+        record.negative = static_cast<DNSNegativeKind>(negative);
+        record.ip_addresses.reserve(v4_count + v6_count);
+        const unsigned char *addr = entry + JOURNAL_PAYLOAD_PREFIX_SIZE + name_len;
+        for (uint8_t k = 0; k < v4_count; ++k, addr += sizeof(in_addr)) {
+            in_addr v4{};
+            std::memcpy(&v4, addr, sizeof(v4));
+            record.ip_addresses.push_back(DNSAddress(v4));
+        }
+        for (uint8_t k = 0; k < v6_count; ++k, addr += sizeof(in6_addr)) {
+            in6_addr v6{};
+            std::memcpy(&v6, addr, sizeof(v6));
+            record.ip_addresses.push_back(DNSAddress(v6));
+        }
+        batch.push_back(std::move(record));
+        if (batch.size() >= JOURNAL_REPLAY_CHUNK) {
+            flushBatch();
+        }
+    }
+    flushBatch();
+    return replayed;
+}
+
+DNSCacheJournal::Stats DNSCacheJournal::getStats() const {
+    Stats stats;
+    stats.appended = buffer_->appended.load(std::memory_order_relaxed);
+    stats.flushed_bytes = flushed_bytes_.load(std::memory_order_relaxed);
+    stats.checkpoints = checkpoints_.load(std::memory_order_relaxed);
+    stats.failed_checkpoints = failed_checkpoints_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    stats.replayed = replayed_.load(std::memory_order_relaxed);
+    stats.log_size = current_log_size_.load(std::memory_order_relaxed);
+    stats.last_checkpoint_duration = last_checkpoint_duration_.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -1,12 +1,21 @@
 #include "DNSCachePersistor.h"
 #include "DNSUtils.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 
-using Milliseconds = std::chrono::milliseconds;
-using TimePoint = std::chrono::system_clock::time_point;
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 constexpr const char *CACHE_FORMAT_VERSION = "1.0";
 constexpr int64_t MAX_CACHE_AGE = 24 * 60 * 60 * 1000;// 1 day in milliseconds
@@ -17,23 +26,195 @@ constexpr const char *CACHE_FIELD_NAME_RECORDS = "records";
 constexpr const char *CACHE_RECORDS_FIELD_NAME_HOSTNAME = "hostname";
 constexpr const char *CACHE_RECORDS_FIELD_NAME_IP = "ip_addresses";
 constexpr const char *CACHE_RECORDS_FIELD_NAME_EXPIRE_TIME = "expire_time";
+constexpr const char *CACHE_RECORDS_FIELD_NAME_TTL = "ttl";
 constexpr const char *CACHE_RECORDS_FIELD_NAME_IS_VALID = "is_valid";
+constexpr const char *CACHE_RECORDS_FIELD_NAME_NEGATIVE = "negative";
 
-bool DNSCachePersistor::save(const DNSCache &cache, const std::string &filename) {
+// 备份文件名：dns_cache_<UTC时间>.bin
+constexpr const char *BACKUP_FILE_PREFIX = "dns_cache_";
+constexpr const char *BACKUP_FILE_SUFFIX = ".bin";
+
+namespace {
+    // 二进制快照格式（整数均为小端）：
+    //   文件头(32字节) | 记录表(每条28字节) | 地址区 | 字符串表
+    // 文件头：magic(4) version(2) header_size(2) timestamp_ms(8) record_count(4) address_bytes(4) string_bytes(4) crc32(4)
+    // 记录：name_offset(4) name_len(2) v4_count(1) v6_count(1) addr_offset(4) ttl(4) expire_time(8) negative(1) reserved(3)
+    // 每条记录的地址在地址区中连续存放，先IPv4(4字节)后IPv6(16字节)；否定记录没有地址，negative为DNSNegativeKind的值。
+    // crc32覆盖文件头之后的全部内容。版本1的记录为24字节，没有negative字段，仍可加载
+    constexpr uint32_t SNAPSHOT_MAGIC = 0x50534E44;// "DNSP"
+    constexpr uint16_t SNAPSHOT_VERSION = 2;
+    constexpr size_t SNAPSHOT_HEADER_SIZE = 32;
+    constexpr size_t SNAPSHOT_RECORD_SIZE = 28;
+    constexpr size_t SNAPSHOT_V1_RECORD_SIZE = 24;
+    constexpr size_t SNAPSHOT_MAX_ADDRESSES = 255;// 每种地址族的上限
+    constexpr size_t SNAPSHOT_LOAD_CHUNK = 4096;  // 每批交给bulkInsert的记录数
+
+    // 只读内存映射，加载时直接在映射区上解析，不复制整个文件
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string &filename) {
+#if defined(_WIN32)
+            file_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file_ == INVALID_HANDLE_VALUE) {
+                return;
+            }
+            LARGE_INTEGER size{};
+            if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) {
+                return;
+            }
+            mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping_) {
+                return;
+            }
+            data_ = static_cast<const unsigned char *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+            if (data_) {
+                size_ = static_cast<size_t>(size.QuadPart);
+            }
+#else
+            fd_ = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd_ < 0) {
+                return;
+            }
+            struct stat st{};
+            if (fstat(fd_, &st) != 0 || st.st_size == 0) {
+                return;
+            }
+            void *addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd_, 0);
+            if (addr == MAP_FAILED) {
+                return;
+            }
+            // 顺序读取整个文件
+            madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            data_ = static_cast<const unsigned char *>(addr);
+            size_ = static_cast<size_t>(st.st_size);
+#endif
+        }
+
+        ~MappedFile() {
+#if defined(_WIN32)
+            if (data_) {
+                UnmapViewOfFile(data_);
+            }
+            if (mapping_) {
+                CloseHandle(mapping_);
+            }
+            if (file_ != INVALID_HANDLE_VALUE) {
+                CloseHandle(file_);
+            }
+#else
+            if (data_) {
+                munmap(const_cast<unsigned char *>(data_), size_);
+            }
+            if (fd_ >= 0) {
+                ::close(fd_);
+            }
+#endif
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        [[nodiscard]] const unsigned char *data() const { return data_; }
+        [[nodiscard]] size_t size() const { return size_; }
+
+    private:
+        const unsigned char *data_{nullptr};
+        size_t size_{0};
+#if defined(_WIN32)
+        HANDLE file_{INVALID_HANDLE_VALUE};
+        HANDLE mapping_{nullptr};
+#else
+        int fd_{-1};
+#endif
+    };
+
+    // 文件头中的各字段
+    struct SnapshotHeader {
+        uint32_t magic{};
+        uint16_t version{};
+        uint16_t header_size{};
+        int64_t timestamp_ms{};
+        uint32_t record_count{};
+        uint32_t address_bytes{};
+        uint32_t string_bytes{};
+        uint32_t crc32{};
+    };
+
+    SnapshotHeader parseHeader(const unsigned char *data) {
+        SnapshotHeader header;
+        header.magic = DNSUtils::getLE<uint32_t>(data);
+        header.version = DNSUtils::getLE<uint16_t>(data + 4);
+        header.header_size = DNSUtils::getLE<uint16_t>(data + 6);
+        header.timestamp_ms = DNSUtils::getLE<int64_t>(data + 8);
+        header.record_count = DNSUtils::getLE<uint32_t>(data + 16);
+        header.address_bytes = DNSUtils::getLE<uint32_t>(data + 20);
+        header.string_bytes = DNSUtils::getLE<uint32_t>(data + 24);
+        header.crc32 = DNSUtils::getLE<uint32_t>(data + 28);
+        return header;
+    }
+
+    bool isTooOld(int64_t timestamp_ms) {
+        return DNSUtils::getTime() - timestamp_ms > MAX_CACHE_AGE;
+    }
+
+    // 各版本的记录长度，不支持的版本返回0
+    size_t recordSize(uint16_t version) {
+        switch (version) {
+            case 1:
+                return SNAPSHOT_V1_RECORD_SIZE;
+            case SNAPSHOT_VERSION:
+                return SNAPSHOT_RECORD_SIZE;
+            default:
+                return 0;
+        }
+    }
+
+    const char *negativeName(DNSNegativeKind kind) {
+        switch (kind) {
+            case DNSNegativeKind::NXDomain:
+                return "nxdomain";
+            case DNSNegativeKind::NoData:
+                return "nodata";
+            default:
+                return "";
+        }
+    }
+
+    DNSNegativeKind parseNegative(const std::string &name) {
+        if (name == "nxdomain") {
+            return DNSNegativeKind::NXDomain;
+        }
+        if (name == "nodata") {
+            return DNSNegativeKind::NoData;
+        }
+        return DNSNegativeKind::None;
+    }
+}// namespace
+
+bool DNSCachePersistor::save(const DNSCache &cache, const std::string &filename, Format format) {
+    return format == Format::Json ? saveJson(cache, filename) : saveBinary(cache, filename);
+}
+
+bool DNSCachePersistor::load(DNSCache &cache, const std::string &filename) {
+    return isBinarySnapshot(filename) ? loadBinary(cache, filename) : loadJson(cache, filename);
+}
+
+bool DNSCachePersistor::saveJson(const DNSCache &cache, const std::string &filename) {
     try {
         nlohmann::json j;
         j[CACHE_FIELD_NAME_VERSION] = CACHE_FORMAT_VERSION;
         j[CACHE_FIELD_NAME_TIMESTAMP] = DNSUtils::getTime();
 
         nlohmann::json records = nlohmann::json::array();
-        cache.forEach([&records](const std::string &hostname,
-                                 const DNSRecord &record) {
-            if (record.is_valid) {
-                nlohmann::json recordJson = serializeRecord(record);
-                recordJson[CACHE_RECORDS_FIELD_NAME_HOSTNAME] = hostname;
+        // 序列化在分片锁外进行；快照格式只保存地址，类型化记录不持久化
+        for (const auto &record: cache.snapshot()) {
+            if (record->is_valid && !record->records) {
+                nlohmann::json recordJson = serializeRecord(*record);
+                recordJson[CACHE_RECORDS_FIELD_NAME_HOSTNAME] = record->hostname;
                 records.push_back(recordJson);
             }
-        });
+        }
 
         j[CACHE_FIELD_NAME_RECORDS] = records;
 
@@ -49,7 +230,7 @@ bool DNSCachePersistor::save(const DNSCache &cache, const std::string &filename)
     }
 }
 
-bool DNSCachePersistor::load(DNSCache &cache, const std::string &filename) {
+bool DNSCachePersistor::loadJson(DNSCache &cache, const std::string &filename) {
     try {
         std::ifstream file(filename);
         if (!file) {
@@ -71,9 +252,8 @@ bool DNSCachePersistor::load(DNSCache &cache, const std::string &filename) {
         }
 
         // 检查缓存是否过期
-        const auto cache_time = TimePoint(Milliseconds(cache_data[CACHE_FIELD_NAME_TIMESTAMP]));
         const auto now = std::chrono::system_clock::now();
-        if ((now - cache_time).count() > MAX_CACHE_AGE) {
+        if (isTooOld(cache_data[CACHE_FIELD_NAME_TIMESTAMP].get<int64_t>())) {
             std::cerr << "Cache file is too old, ignoring" << std::endl;
             return false;
         }
@@ -85,9 +265,14 @@ bool DNSCachePersistor::load(DNSCache &cache, const std::string &filename) {
 
         for (const auto &recordJson: cache_data[CACHE_FIELD_NAME_RECORDS]) {
             auto record = deserializeRecord(recordJson);
-            // 只加载未过期的记录
+            // 只加载未过期的记录，并保留其剩余TTL
             if (record.is_valid && record.expire_time > now) {
-                cache.update(record.hostname, record.ip_addresses);
+                const auto remaining = std::chrono::duration_cast<std::chrono::seconds>(record.expire_time - now);
+                if (record.negative != DNSNegativeKind::None) {
+                    cache.updateNegative(record.hostname, record.negative, remaining);
+                } else {
+                    cache.update(record.hostname, record.ip_addresses, remaining);
+                }
             }
         }
         return true;
@@ -100,10 +285,14 @@ bool DNSCachePersistor::load(DNSCache &cache, const std::string &filename) {
 nlohmann::json DNSCachePersistor::serializeRecord(const DNSRecord &record) {
     nlohmann::json j;
     j[CACHE_RECORDS_FIELD_NAME_HOSTNAME] = record.hostname;
-    j[CACHE_RECORDS_FIELD_NAME_IP] = record.ip_addresses;
+    j[CACHE_RECORDS_FIELD_NAME_IP] = record.ip_addresses.toStrings();
     j[CACHE_RECORDS_FIELD_NAME_EXPIRE_TIME] =
             std::chrono::duration_cast<std::chrono::seconds>(record.expire_time.time_since_epoch()).count();
+    j[CACHE_RECORDS_FIELD_NAME_TTL] = record.ttl.count();
     j[CACHE_RECORDS_FIELD_NAME_IS_VALID] = record.is_valid;
+    if (record.negative != DNSNegativeKind::None) {
+        j[CACHE_RECORDS_FIELD_NAME_NEGATIVE] = negativeName(record.negative);
+    }
     return j;
 }
 
@@ -119,9 +308,12 @@ DNSRecord DNSCachePersistor::deserializeRecord(const nlohmann::json &j) {
 
     DNSRecord record;
     record.hostname = j[CACHE_RECORDS_FIELD_NAME_HOSTNAME];
-    record.ip_addresses = j[CACHE_RECORDS_FIELD_NAME_IP].get<std::vector<std::string>>();
+    record.ip_addresses = DNSAddressList::fromStrings(j[CACHE_RECORDS_FIELD_NAME_IP].get<std::vector<std::string>>());
     record.expire_time = std::chrono::system_clock::from_time_t(j[CACHE_RECORDS_FIELD_NAME_EXPIRE_TIME].get<int64_t>());
     record.is_valid = j[CACHE_RECORDS_FIELD_NAME_IS_VALID].get<bool>();
+    // 旧版本文件没有ttl字段
+    record.ttl = std::chrono::seconds(j.value(CACHE_RECORDS_FIELD_NAME_TTL, int64_t{0}));
+    record.negative = parseNegative(j.value(CACHE_RECORDS_FIELD_NAME_NEGATIVE, std::string{}));
     return record;
 }
 
@@ -134,6 +326,19 @@ std::string DNSCachePersistor::getCurrentTimestamp() {
 }
 
 bool DNSCachePersistor::isValidCache(const std::string &filename) {
+    if (isBinarySnapshot(filename)) {
+        MappedFile file(filename);
+        if (!file.data() || file.size() < SNAPSHOT_HEADER_SIZE) {
+            return false;
+        }
+        const auto header = parseHeader(file.data());
+        const size_t record_size = recordSize(header.version);
+        const uint64_t expected = header.header_size + uint64_t{header.record_count} * record_size +
+                                  header.address_bytes + header.string_bytes;
+        return record_size != 0 && header.header_size >= SNAPSHOT_HEADER_SIZE &&
+               expected == file.size() && !isTooOld(header.timestamp_ms) &&
+               DNSUtils::crc32Update(0, file.data() + header.header_size, file.size() - header.header_size) == header.crc32;
+    }
     try {
         std::ifstream file(filename, std::ios::binary);
         if (!file) {
@@ -153,9 +358,7 @@ bool DNSCachePersistor::isValidCache(const std::string &filename) {
         }
 
         // 检查时间戳
-        const auto cache_time = TimePoint(Milliseconds(cache_data[CACHE_FIELD_NAME_TIMESTAMP]));
-        const auto now = std::chrono::system_clock::now();
-        if ((now - cache_time).count() > MAX_CACHE_AGE) {
+        if (isTooOld(cache_data[CACHE_FIELD_NAME_TIMESTAMP].get<int64_t>())) {
             return false;
         }
 
@@ -163,4 +366,314 @@ bool DNSCachePersistor::isValidCache(const std::string &filename) {
     } catch (const std::exception &) {
         return false;
     }
-}
\ No newline at end of file
+}
+
+bool DNSCachePersistor::isBinarySnapshot(const std::string &filename) {
+    std::ifstream file(filename, std::ios::binary);
+    unsigned char magic[4]{};
+    if (!file.read(reinterpret_cast<char *>(magic), sizeof(magic))) {
+        return false;
+    }
+    return DNSUtils::getLE<uint32_t>(magic) == SNAPSHOT_MAGIC;
+}
+
+bool DNSCachePersistor::saveBinary(const DNSCache &cache, const std::string &filename) {
+    try {
+        std::string records;
+        std::string addresses;
+        std::string strings;
+        uint32_t record_count = 0;
+        const auto now = std::chrono::system_clock::now();
+
+        const auto append = [&](const std::string &hostname, const DNSRecord &record) {
+            if (!record.is_valid || record.records || record.expire_time <= now || hostname.size() > UINT16_MAX) {
+                return;
+            }
+            // 地址按族分开打包
+            size_t v4_count = 0;
+            size_t v6_count = 0;
+            for (const auto &address: record.ip_addresses) {
+                v4_count += address.isV4();
+                v6_count += address.isV6();
+            }
+            v4_count = std::min(v4_count, SNAPSHOT_MAX_ADDRESSES);
+            v6_count = std::min(v6_count, SNAPSHOT_MAX_ADDRESSES);
+            if (v4_count == 0 && v6_count == 0 && record.negative == DNSNegativeKind::None) {
+                return;
+            }
+
+            DNSUtils::putLE<uint32_t>(records, static_cast<uint32_t>(strings.size()));
+            DNSUtils::putLE<uint16_t>(records, static_cast<uint16_t>(hostname.size()));
+            records.push_back(static_cast<char>(v4_count));
+            records.push_back(static_cast<char>(v6_count));
+            DNSUtils::putLE<uint32_t>(records, static_cast<uint32_t>(addresses.size()));
+            DNSUtils::putLE<uint32_t>(records, static_cast<uint32_t>(record.ttl.count()));
+            DNSUtils::putLE<int64_t>(records, std::chrono::duration_cast<std::chrono::seconds>(
+                                            record.expire_time.time_since_epoch())
+                                            .count());
+            records.push_back(static_cast<char>(record.negative));
+            records.append(3, '\0');
+            for (const int family: {AF_INET, AF_INET6}) {
+                size_t remaining = family == AF_INET ? v4_count : v6_count;
+                for (const auto &address: record.ip_addresses) {
+                    if (remaining > 0 && address.family() == family) {
+                        addresses.append(reinterpret_cast<const char *>(address.data()), address.size());
+                        --remaining;
+                    }
+                }
+            }
+            strings.append(hostname);
+            ++record_count;
+        };
+        // 编码在分片锁外进行
+        for (const auto &record: cache.snapshot()) {
+            append(record->hostname, *record);
+        }
+
+        if (addresses.size() > UINT32_MAX || strings.size() > UINT32_MAX) {
+            throw std::runtime_error("Cache snapshot too large");
+        }
+
+        uint32_t crc = DNSUtils::crc32Update(0, records.data(), records.size());
+        crc = DNSUtils::crc32Update(crc, addresses.data(), addresses.size());
+        crc = DNSUtils::crc32Update(crc, strings.data(), strings.size());
+
+        std::string header;
+        header.reserve(SNAPSHOT_HEADER_SIZE);
+        DNSUtils::putLE<uint32_t>(header, SNAPSHOT_MAGIC);
+        DNSUtils::putLE<uint16_t>(header, SNAPSHOT_VERSION);
+        DNSUtils::putLE<uint16_t>(header, static_cast<uint16_t>(SNAPSHOT_HEADER_SIZE));
+        DNSUtils::putLE<int64_t>(header, DNSUtils::getTime());
+        DNSUtils::putLE<uint32_t>(header, record_count);
+        DNSUtils::putLE<uint32_t>(header, static_cast<uint32_t>(addresses.size()));
+        DNSUtils::putLE<uint32_t>(header, static_cast<uint32_t>(strings.size()));
+        DNSUtils::putLE<uint32_t>(header, crc);
+
+        // 先写临时文件再改名，中途失败不会破坏已有快照
+        const std::string tmp_file = filename + ".tmp";
+        {
+            std::ofstream file(tmp_file, std::ios::binary | std::ios::trunc);
+            if (!file) {
+                return false;
+            }
+            file.write(header.data(), static_cast<std::streamsize>(header.size()));
+            file.write(records.data(), static_cast<std::streamsize>(records.size()));
+            file.write(addresses.data(), static_cast<std::streamsize>(addresses.size()));
+            file.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+            if (!file.flush()) {
+                return false;
+            }
+        }
+        std::filesystem::rename(tmp_file, filename);
+        return true;
+    } catch (const std::exception &e) {
+        std::cerr << "Error saving cache snapshot: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DNSCachePersistor::loadBinary(DNSCache &cache, const std::string &filename) {
+    try {
+        MappedFile file(filename);
+        if (!file.data() || file.size() < SNAPSHOT_HEADER_SIZE) {
+            return false;
+        }
+
+        // 验证文件头、长度与校验和
+        const auto header = parseHeader(file.data());
+        const size_t record_size = recordSize(header.version);
+        if (record_size == 0) {
+            throw std::runtime_error("Unsupported cache snapshot version");
+        }
+        const uint64_t records_offset = header.header_size;
+        const uint64_t addresses_offset = records_offset + uint64_t{header.record_count} * record_size;
+        const uint64_t strings_offset = addresses_offset + header.address_bytes;
+        if (header.header_size < SNAPSHOT_HEADER_SIZE || strings_offset + header.string_bytes != file.size()) {
+            throw std::runtime_error("Truncated cache snapshot");
+        }
+        if (DNSUtils::crc32Update(0, file.data() + records_offset, file.size() - records_offset) != header.crc32) {
+            throw std::runtime_error("Cache snapshot checksum mismatch");
+        }
+        if (isTooOld(header.timestamp_ms)) {
+            std::cerr << "Cache file is too old, ignoring" << std::endl;
+            return false;
+        }
+
+        const unsigned char *addresses = file.data() + addresses_offset;
+        const char *strings = reinterpret_cast<const char *>(file.data() + strings_offset);
+        const auto now = std::chrono::system_clock::now();
+
+        std::vector<DNSRecord> batch;
+        batch.reserve(std::min<size_t>(header.record_count, SNAPSHOT_LOAD_CHUNK));
+        for (uint32_t i = 0; i < header.record_count; ++i) {
+            const unsigned char *entry = file.data() + records_offset + uint64_t{i} * record_size;
+            const auto name_offset = DNSUtils::getLE<uint32_t>(entry);
+            const auto name_len = DNSUtils::getLE<uint16_t>(entry + 4);
+            const uint8_t v4_count = entry[6];
+            const uint8_t v6_count = entry[7];
+            const auto addr_offset = DNSUtils::getLE<uint32_t>(entry + 8);
+            const auto ttl = DNSUtils::getLE<uint32_t>(entry + 12);
+            const auto expire_time = DNSUtils::getLE<int64_t>(entry + 16);
+            const uint8_t negative = record_size > SNAPSHOT_V1_RECORD_SIZE ? entry[24] : 0;
+
+            const uint64_t addr_len = v4_count * 4ull + v6_count * 16ull;
+            if (uint64_t{name_offset} + name_len > header.string_bytes ||
+                uint64_t{addr_offset} + addr_len > header.address_bytes) {
+                throw std::runtime_error("Corrupt cache snapshot record");
+            }
+
+            DNSRecord record;
+            record.expire_time = std::chrono::system_clock::time_point(std::chrono::seconds(expire_time));
+            if (record.expire_time <= now) {
+                continue;
+            }
+            record.hostname.assign(strings + name_offset, name_len);
+            record.ttl = std::chrono::seconds(ttl);
+            record.is_valid = true;
+            if (negative > static_cast<uint8_t>(DNSNegativeKind::NoData)) {
+                throw std::runtime_error("Corrupt cache snapshot record");
+            }
+            record.negative = static_cast<DNSNegativeKind>(negative);
+            // 地址以网络字节序原样存放，直接复制即可
+            record.ip_addresses.reserve(v4_count + v6_count);
+            const unsigned char *addr = addresses + addr_offset;
+            for (uint8_t k = 0; k < v4_count; ++k, addr += sizeof(in_addr)) {
+                in_addr v4{};
+                std::memcpy(&v4, addr, sizeof(v4));
+                record.ip_addresses.push_back(DNSAddress(v4));
+            }
+            for (uint8_t k = 0; k < v6_count; ++k, addr += sizeof(in6_addr)) {
+                in6_addr v6{};
+                std::memcpy(&v6, addr, sizeof(v6));
+                record.ip_addresses.push_back(DNSAddress(v6));
+            }
+
+            batch.push_back(std::move(record));
+            if (batch.size() >= SNAPSHOT_LOAD_CHUNK) {
+                cache.bulkInsert(std::move(batch));
+                batch.clear();
+                batch.reserve(SNAPSHOT_LOAD_CHUNK);
+            }
+        }
+        if (!batch.empty()) {
+            cache.bulkInsert(std::move(batch));
+        }
+        return true;
+    } catch (const std::exception &e) {
+        std::cerr << "Error loading cache snapshot: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DNSCachePersistor::backup(const DNSCache &cache, const std::string &backup_dir) {
+    try {
+        std::filesystem::create_directories(backup_dir);
+        // 文件名中的时间戳精确到毫秒，按字典序即按时间排序
+        const auto now = std::chrono::system_clock::now();
+        const auto tt = std::chrono::system_clock::to_time_t(now);
+        const auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+        std::stringstream name;
+        name << BACKUP_FILE_PREFIX << std::put_time(std::gmtime(&tt), "%Y%m%d_%H%M%S") << '_' << std::setw(3)
+             << std::setfill('0') << millis << BACKUP_FILE_SUFFIX;
+        return saveBinary(cache, (std::filesystem::path(backup_dir) / name.str()).string());
+    } catch (const std::exception &e) {
+        std::cerr << "Error creating cache backup: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DNSCachePersistor::restore(DNSCache &cache, const std::string &backup_file) {
+    // 先校验再清空，损坏的备份不会破坏当前缓存
+    if (!isValidCache(backup_file)) {
+        std::cerr << "Invalid cache backup: " << backup_file << std::endl;
+        return false;
+    }
+    cache.clear();
+    return load(cache, backup_file);
+}
+
+std::vector<std::string> DNSCachePersistor::listBackups(const std::string &backup_dir) {
+    std::vector<std::string> backups;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(backup_dir, ec), end; !ec && it != end; it.increment(ec)) {
+        const std::string name = it->path().filename().string();
+        if (it->is_regular_file(ec) && name.starts_with(BACKUP_FILE_PREFIX) && name.ends_with(BACKUP_FILE_SUFFIX)) {
+            backups.push_back(it->path().string());
+        }
+    }
+    std::sort(backups.begin(), backups.end());
+    return backups;
+}
+
+bool DNSCachePersistor::compactCache(DNSCache &cache) {
+    // 分批清理全部过期记录，每批每个分片只持锁处理有限条数；日志中的历史写入由DNSCacheJournal的检查点合并
+    while (cache.purgeExpired() > 0) {
+    }
+    return true;
+}
+
+DNSCachePersistor::CacheStats DNSCachePersistor::analyzeCache(const std::string &filename) {
+    CacheStats stats{};
+    std::error_code ec;
+    stats.file_size = static_cast<size_t>(std::filesystem::file_size(filename, ec));
+    if (ec) {
+        stats.file_size = 0;
+        return stats;
+    }
+
+    const auto now = std::chrono::system_clock::now();
+    bool first = true;
+    // 记录的写入时间为过期时间减去TTL
+    const auto count = [&](std::chrono::system_clock::time_point expire_time, std::chrono::seconds ttl) {
+        ++stats.total_entries;
+        if (expire_time > now) {
+            ++stats.valid_entries;
+        } else {
+            ++stats.expired_entries;
+        }
+        const auto written = expire_time - ttl;
+        if (first || written < stats.oldest_entry) {
+            stats.oldest_entry = written;
+        }
+        if (first || written > stats.newest_entry) {
+            stats.newest_entry = written;
+        }
+        first = false;
+    };
+
+    try {
+        if (isBinarySnapshot(filename)) {
+            MappedFile file(filename);
+            if (!file.data() || file.size() < SNAPSHOT_HEADER_SIZE) {
+                return stats;
+            }
+            const auto header = parseHeader(file.data());
+            const size_t record_size = recordSize(header.version);
+            if (record_size == 0 || header.header_size < SNAPSHOT_HEADER_SIZE ||
+                header.header_size + uint64_t{header.record_count} * record_size > file.size()) {
+                return stats;
+            }
+            for (uint32_t i = 0; i < header.record_count; ++i) {
+                const unsigned char *entry = file.data() + header.header_size + uint64_t{i} * record_size;
+                count(std::chrono::system_clock::time_point(std::chrono::seconds(DNSUtils::getLE<int64_t>(entry + 16))),
+                      std::chrono::seconds(DNSUtils::getLE<uint32_t>(entry + 12)));
+            }
+            return stats;
+        }
+
+        std::ifstream file(filename);
+        nlohmann::json cache_data;
+        file >> cache_data;
+        if (cache_data.contains(CACHE_FIELD_NAME_RECORDS) && cache_data[CACHE_FIELD_NAME_RECORDS].is_array()) {
+            for (const auto &recordJson: cache_data[CACHE_FIELD_NAME_RECORDS]) {
+                const auto record = deserializeRecord(recordJson);
+                if (record.is_valid) {
+                    count(record.expire_time, record.ttl);
+                }
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error analyzing cache: " << e.what() << std::endl;
+    }
+    return stats;
+}
@@ -0,0 +1,166 @@
+#include "DNSCacheWarmer.h"
+#include "DNSHostname.h"
+#include "DNSResolver.h"
+
+#include <algorithm>
+#include <ares.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+DNSCacheWarmer::Options DNSCacheWarmer::fromConfig(const CacheConfig &config) {
+    Options options;
+    options.max_in_flight = std::max<size_t>(1, config.warmup_max_in_flight);
+    options.timeout = std::chrono::milliseconds(config.warmup_timeout_ms);
+    options.static_ttl = config.warmup_static_ttl;
+    return options;
+}
+
+DNSCacheWarmer::DNSCacheWarmer(ResolveFn resolve_fn, std::shared_ptr<DNSCache> cache,
+                               std::shared_ptr<DNSMetrics> metrics, Options options)
+    : resolve_fn_(std::move(resolve_fn)), cache_(std::move(cache)), metrics_(std::move(metrics)),
+      options_(options) {
+    options_.max_in_flight = std::max<size_t>(1, options_.max_in_flight);
+}
+
+bool DNSCacheWarmer::loadFile(const std::string &filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        std::cerr << "Unable to open warmup file: " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    std::string token;
+    while (std::getline(file, line)) {
+        if (const auto comment = line.find('#'); comment != std::string::npos) {
+            line.resize(comment);
+        }
+        std::istringstream tokens(line);
+        if (!(tokens >> token)) {
+            continue;
+        }
+        // 首列是地址时为hosts条目，其后的主机名与别名都指向该地址
+        if (const auto address = DNSAddress::parse(token)) {
+            while (tokens >> token) {
+                addStatic(token, *address);
+            }
+            continue;
+        }
+        do {
+            addHostname(token);
+        } while (tokens >> token);
+    }
+    return true;
+}
+
+void DNSCacheWarmer::addHostname(const std::string &hostname) {
+    auto canonical = DNSHostname::canonicalize(hostname);
+    if (canonical.empty() || canonical.size() > 255) {
+        return;
+    }
+    if (seen_.insert(canonical).second) {
+        hostnames_.push_back(std::move(canonical));
+    }
+}
+
+void DNSCacheWarmer::addStatic(const std::string &hostname, const DNSAddress &address) {
+    auto canonical = DNSHostname::canonicalize(hostname);
+    if (canonical.empty() || canonical.size() > 255) {
+        return;
+    }
+    auto &addresses = static_entries_[std::move(canonical)];
+    if (std::find(addresses.begin(), addresses.end(), address) == addresses.end()) {
+        addresses.push_back(address);
+    }
+}
+
+size_t DNSCacheWarmer::insertStatic() {
+    if (static_entries_.empty()) {
+        return 0;
+    }
+    const auto now = std::chrono::system_clock::now();
+    std::vector<DNSRecord> records;
+    records.reserve(static_entries_.size() * (options_.split_families ? 2 : 1));
+    const auto add_record = [&](std::string key, DNSAddressList addresses) {
+        auto &record = records.emplace_back();
+        record.hostname = std::move(key);
+        record.ip_addresses = std::move(addresses);
+        if (record.ip_addresses.empty()) {
+            record.negative = DNSNegativeKind::NoData;
+        }
+        // bulkInsert保留各记录的到期时间，NoData同样持续到静态记录到期
+        record.expire_time = now + options_.static_ttl;
+        record.ttl = options_.static_ttl;
+        record.is_valid = true;
+    };
+    for (const auto &[hostname, addresses]: static_entries_) {
+        if (!options_.split_families) {
+            add_record(hostname, addresses);
+            continue;
+        }
+        DNSAddressList v4;
+        DNSAddressList v6;
+        for (const auto &address: addresses) {
+            (address.family() == AF_INET6 ? v6 : v4).push_back(address);
+        }
+        add_record(DNSResolver::cache_key(hostname, AF_INET), std::move(v4));
+        add_record(DNSResolver::cache_key(hostname, AF_INET6), std::move(v6));
+    }
+    const size_t inserted = cache_->bulkInsert(std::move(records));
+    // 分地址族时每个主机名写入两条记录，进度按主机名计数
+    return options_.split_families ? static_entries_.size() : inserted;
+}
+
+DNSCacheWarmer::Report DNSCacheWarmer::run() {
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + options_.timeout;
+    Report report;
+    report.static_entries = insertStatic();
+
+    std::vector<const std::string *> targets;
+    targets.reserve(hostnames_.size());
+    for (const auto &hostname: hostnames_) {
+        if (!static_entries_.contains(hostname)) {
+            targets.push_back(&hostname);
+        }
+    }
+    report.hostnames = targets.size();
+
+    const size_t total = report.static_entries + targets.size();
+    size_t completed = report.static_entries;
+    if (metrics_) {
+        metrics_->recordWarmupProgress(total, completed, 0);
+    }
+
+    // 结果回调由DNSBatchWindow串行执行，计数无需加锁
+    size_t next = 0;
+    DNSBatchWindow::stream(
+            resolve_fn_,
+            [&](std::string &hostname) {
+                if (next >= targets.size() || std::chrono::steady_clock::now() >= deadline) {
+                    return false;
+                }
+                hostname = *targets[next++];
+                return true;
+            },
+            [&](const DNSBatchWindow::ResolveResult &result) {
+                ++completed;
+                if (result.status == ARES_SUCCESS) {
+                    ++report.resolved;
+                } else {
+                    ++report.failed;
+                }
+                if (metrics_) {
+                    metrics_->recordWarmupProgress(total, completed, report.failed);
+                }
+            },
+            options_.max_in_flight);
+
+    report.skipped = targets.size() - next;
+    report.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    if (report.skipped > 0) {
+        std::cerr << "Cache warmup timed out, " << report.skipped << " hostnames were not resolved" << std::endl;
+    }
+    return report;
+}
@@ -53,14 +53,46 @@ DNSResolverConfig::DNSResolverConfig() {
     // 默认缓存配置
     cache_.enabled = true;
     cache_.ttl = std::chrono::seconds(300);
+    cache_.min_ttl = std::chrono::seconds(5);
+    cache_.max_ttl = std::chrono::seconds(86400);
     cache_.max_size = 10000;
     cache_.persistent = false;
     cache_.cache_file = "";
+    cache_.shard_count = 16;
+    cache_.prefetch_enabled = true;
+    cache_.prefetch_threshold = 0.2;
+    cache_.prefetch_max_qps = 100;
+    cache_.negative_enabled = true;
+    cache_.negative_ttl = std::chrono::seconds(30);
+    cache_.negative_max_size = 1000;
+    cache_.journal_enabled = false;
+    cache_.journal_flush_interval_ms = 1000;
+    cache_.checkpoint_interval = std::chrono::seconds(300);
+    cache_.journal_max_size = 64 * 1024 * 1024;
+    cache_.warmup_file = "";
+    cache_.warmup_max_in_flight = 64;
+    cache_.warmup_timeout_ms = 10000;
+    cache_.warmup_static_ttl = std::chrono::seconds(86400);
 
     // 默认重试配置
     retry_.max_attempts = 3;
     retry_.base_delay_ms = 100;
     retry_.max_delay_ms = 1000;
+    retry_.budget_ratio = 0.2;
+    retry_.budget_min_per_sec = 10;
+    retry_.hedge_enabled = false;
+    retry_.hedge_percentile = 0.95;
+    retry_.hedge_min_delay_ms = 5;
+    retry_.hedge_max_delay_ms = 500;
+    retry_.hedge_budget_ratio = 0.1;
+
+    // 默认上游选择配置
+    upstream_.selection = "p2c";
+    upstream_.rtt_ewma_alpha = 0.3;
+    upstream_.failure_threshold = 5;
+    upstream_.latency_outlier_factor = 3.0;
+    upstream_.ejection_time_ms = 1000;
+    upstream_.max_ejection_time_ms = 30000;
 
     // 默认监控配置
     metrics_.enabled = true;
@@ -92,9 +124,26 @@ bool DNSResolverConfig::loadFromFile(const std::string &filename) {
             auto cache = config["cache"];
             cache_.enabled = cache["enabled"].as<bool>(true);
             cache_.ttl = std::chrono::seconds(cache["ttl_seconds"].as<uint32_t>(300));
+            cache_.min_ttl = std::chrono::seconds(cache["min_ttl_seconds"].as<uint32_t>(5));
+            cache_.max_ttl = std::chrono::seconds(cache["max_ttl_seconds"].as<uint32_t>(86400));
             cache_.max_size = cache["max_size"].as<size_t>(10000);
             cache_.persistent = cache["persistent"].as<bool>(false);
             cache_.cache_file = cache["cache_file"].as<std::string>("");
+            cache_.shard_count = cache["shard_count"].as<size_t>(16);
+            cache_.prefetch_enabled = cache["prefetch_enabled"].as<bool>(true);
+            cache_.prefetch_threshold = cache["prefetch_threshold"].as<double>(0.2);
+            cache_.prefetch_max_qps = cache["prefetch_max_qps"].as<uint32_t>(100);
+            cache_.negative_enabled = cache["negative_enabled"].as<bool>(true);
+            cache_.negative_ttl = std::chrono::seconds(cache["negative_ttl_seconds"].as<uint32_t>(30));
+            cache_.negative_max_size = cache["negative_max_size"].as<size_t>(1000);
+            cache_.journal_enabled = cache["journal_enabled"].as<bool>(false);
+            cache_.journal_flush_interval_ms = cache["journal_flush_interval_ms"].as<uint32_t>(1000);
+            cache_.checkpoint_interval = std::chrono::seconds(cache["checkpoint_interval_seconds"].as<uint32_t>(300));
+            cache_.journal_max_size = cache["journal_max_size"].as<size_t>(64 * 1024 * 1024);
+            cache_.warmup_file = cache["warmup_file"].as<std::string>("");
+            cache_.warmup_max_in_flight = cache["warmup_max_in_flight"].as<uint32_t>(64);
+            cache_.warmup_timeout_ms = cache["warmup_timeout_ms"].as<uint32_t>(10000);
+            cache_.warmup_static_ttl = std::chrono::seconds(cache["warmup_static_ttl_seconds"].as<uint32_t>(86400));
         }
 
         // 加载重试配置
@@ -103,6 +152,30 @@ bool DNSResolverConfig::loadFromFile(const std::string &filename) {
             retry_.max_attempts = retry["max_attempts"].as<uint32_t>(3);
             retry_.base_delay_ms = retry["base_delay_ms"].as<uint32_t>(100);
             retry_.max_delay_ms = retry["max_delay_ms"].as<uint32_t>(1000);
+            retry_.budget_ratio = retry["budget_ratio"].as<double>(0.2);
+            retry_.budget_min_per_sec = retry["budget_min_per_sec"].as<uint32_t>(10);
+            retry_.hedge_enabled = retry["hedge_enabled"].as<bool>(false);
+            retry_.hedge_percentile = retry["hedge_percentile"].as<double>(0.95);
+            retry_.hedge_min_delay_ms = retry["hedge_min_delay_ms"].as<uint32_t>(5);
+            retry_.hedge_max_delay_ms = retry["hedge_max_delay_ms"].as<uint32_t>(500);
+            retry_.hedge_budget_ratio = retry["hedge_budget_ratio"].as<double>(0.1);
+            retry_.hedge_domains.clear();
+            if (retry["hedge_domains"]) {
+                for (const auto &domain: retry["hedge_domains"]) {
+                    retry_.hedge_domains.push_back(domain.as<std::string>());
+                }
+            }
+        }
+
+        // 加载上游选择配置
+        if (config["upstream"]) {
+            auto upstream = config["upstream"];
+            upstream_.selection = upstream["selection"].as<std::string>("p2c");
+            upstream_.rtt_ewma_alpha = upstream["rtt_ewma_alpha"].as<double>(0.3);
+            upstream_.failure_threshold = upstream["failure_threshold"].as<uint32_t>(5);
+            upstream_.latency_outlier_factor = upstream["latency_outlier_factor"].as<double>(3.0);
+            upstream_.ejection_time_ms = upstream["ejection_time_ms"].as<uint32_t>(1000);
+            upstream_.max_ejection_time_ms = upstream["max_ejection_time_ms"].as<uint32_t>(30000);
         }
 
         // 加载监控配置
@@ -120,6 +193,8 @@ bool DNSResolverConfig::loadFromFile(const std::string &filename) {
             query_timeout_ms_ = global["query_timeout_ms"].as<uint32_t>(5000);
             max_concurrent_queries_ = global["max_concurrent_queries"].as<uint32_t>(100);
             ipv6_enabled_ = global["ipv6_enabled"].as<bool>(true);
+            split_family_queries_ = global["split_family_queries"].as<bool>(false);
+            family_grace_ms_ = global["family_grace_ms"].as<uint32_t>(50);
         }
 
         // 验证配置
@@ -159,9 +234,26 @@ bool DNSResolverConfig::saveToFile(const std::string &filename) const {
         YAML::Node cache;
         cache["enabled"] = cache_.enabled;
         cache["ttl_seconds"] = cache_.ttl.count();
+        cache["min_ttl_seconds"] = cache_.min_ttl.count();
+        cache["max_ttl_seconds"] = cache_.max_ttl.count();
         cache["max_size"] = cache_.max_size;
         cache["persistent"] = cache_.persistent;
         cache["cache_file"] = cache_.cache_file;
+        cache["shard_count"] = cache_.shard_count;
+        cache["prefetch_enabled"] = cache_.prefetch_enabled;
+        cache["prefetch_threshold"] = cache_.prefetch_threshold;
+        cache["prefetch_max_qps"] = cache_.prefetch_max_qps;
+        cache["negative_enabled"] = cache_.negative_enabled;
+        cache["negative_ttl_seconds"] = cache_.negative_ttl.count();
+        cache["negative_max_size"] = cache_.negative_max_size;
+        cache["journal_enabled"] = cache_.journal_enabled;
+        cache["journal_flush_interval_ms"] = cache_.journal_flush_interval_ms;
+        cache["checkpoint_interval_seconds"] = cache_.checkpoint_interval.count();
+        cache["journal_max_size"] = cache_.journal_max_size;
+        cache["warmup_file"] = cache_.warmup_file;
+        cache["warmup_max_in_flight"] = cache_.warmup_max_in_flight;
+        cache["warmup_timeout_ms"] = cache_.warmup_timeout_ms;
+        cache["warmup_static_ttl_seconds"] = cache_.warmup_static_ttl.count();
         config["cache"] = cache;
 
         // 保存重试配置
@@ -169,8 +261,28 @@ bool DNSResolverConfig::saveToFile(const std::string &filename) const {
         retry["max_attempts"] = retry_.max_attempts;
         retry["base_delay_ms"] = retry_.base_delay_ms;
         retry["max_delay_ms"] = retry_.max_delay_ms;
+        retry["budget_ratio"] = retry_.budget_ratio;
+        retry["budget_min_per_sec"] = retry_.budget_min_per_sec;
+        retry["hedge_enabled"] = retry_.hedge_enabled;
+        retry["hedge_percentile"] = retry_.hedge_percentile;
+        retry["hedge_min_delay_ms"] = retry_.hedge_min_delay_ms;
+        retry["hedge_max_delay_ms"] = retry_.hedge_max_delay_ms;
+        retry["hedge_budget_ratio"] = retry_.hedge_budget_ratio;
+        for (const auto &domain: retry_.hedge_domains) {
+            retry["hedge_domains"].push_back(domain);
+        }
         config["retry"] = retry;
 
+        // 保存上游选择配置
+        YAML::Node upstream;
+        upstream["selection"] = upstream_.selection;
+        upstream["rtt_ewma_alpha"] = upstream_.rtt_ewma_alpha;
+        upstream["failure_threshold"] = upstream_.failure_threshold;
+        upstream["latency_outlier_factor"] = upstream_.latency_outlier_factor;
+        upstream["ejection_time_ms"] = upstream_.ejection_time_ms;
+        upstream["max_ejection_time_ms"] = upstream_.max_ejection_time_ms;
+        config["upstream"] = upstream;
+
         // 保存监控配置
         YAML::Node metrics;
         metrics["enabled"] = metrics_.enabled;
@@ -184,6 +296,8 @@ bool DNSResolverConfig::saveToFile(const std::string &filename) const {
         global["query_timeout_ms"] = query_timeout_ms_;
         global["max_concurrent_queries"] = max_concurrent_queries_;
         global["ipv6_enabled"] = ipv6_enabled_;
+        global["split_family_queries"] = split_family_queries_;
+        global["family_grace_ms"] = family_grace_ms_;
         config["global"] = global;
 
         // 添加元数据
@@ -198,6 +312,74 @@ bool DNSResolverConfig::saveToFile(const std::string &filename) const {
     }
 }
 
+nlohmann::json DNSResolverConfig::toJson() const {
+    nlohmann::json config;
+
+    config["servers"] = nlohmann::json::array();
+    for (const auto &srv: servers_) {
+        config["servers"].push_back({{"address", srv.address},
+                                     {"port", srv.port},
+                                     {"weight", srv.weight},
+                                     {"timeout_ms", srv.timeout_ms},
+                                     {"enabled", srv.enabled}});
+    }
+
+    config["cache"] = {{"enabled", cache_.enabled},
+                       {"ttl_seconds", cache_.ttl.count()},
+                       {"min_ttl_seconds", cache_.min_ttl.count()},
+                       {"max_ttl_seconds", cache_.max_ttl.count()},
+                       {"max_size", cache_.max_size},
+                       {"persistent", cache_.persistent},
+                       {"cache_file", cache_.cache_file},
+                       {"shard_count", cache_.shard_count},
+                       {"prefetch_enabled", cache_.prefetch_enabled},
+                       {"prefetch_threshold", cache_.prefetch_threshold},
+                       {"prefetch_max_qps", cache_.prefetch_max_qps},
+                       {"negative_enabled", cache_.negative_enabled},
+                       {"negative_ttl_seconds", cache_.negative_ttl.count()},
+                       {"negative_max_size", cache_.negative_max_size},
+                       {"journal_enabled", cache_.journal_enabled},
+                       {"journal_flush_interval_ms", cache_.journal_flush_interval_ms},
+                       {"checkpoint_interval_seconds", cache_.checkpoint_interval.count()},
+                       {"journal_max_size", cache_.journal_max_size},
+                       {"warmup_file", cache_.warmup_file},
+                       {"warmup_max_in_flight", cache_.warmup_max_in_flight},
+                       {"warmup_timeout_ms", cache_.warmup_timeout_ms},
+                       {"warmup_static_ttl_seconds", cache_.warmup_static_ttl.count()}};
+
+    config["retry"] = {{"max_attempts", retry_.max_attempts},
+                       {"base_delay_ms", retry_.base_delay_ms},
+                       {"max_delay_ms", retry_.max_delay_ms},
+                       {"budget_ratio", retry_.budget_ratio},
+                       {"budget_min_per_sec", retry_.budget_min_per_sec},
+                       {"hedge_enabled", retry_.hedge_enabled},
+                       {"hedge_percentile", retry_.hedge_percentile},
+                       {"hedge_min_delay_ms", retry_.hedge_min_delay_ms},
+                       {"hedge_max_delay_ms", retry_.hedge_max_delay_ms},
+                       {"hedge_budget_ratio", retry_.hedge_budget_ratio},
+                       {"hedge_domains", retry_.hedge_domains}};
+
+    config["upstream"] = {{"selection", upstream_.selection},
+                          {"rtt_ewma_alpha", upstream_.rtt_ewma_alpha},
+                          {"failure_threshold", upstream_.failure_threshold},
+                          {"latency_outlier_factor", upstream_.latency_outlier_factor},
+                          {"ejection_time_ms", upstream_.ejection_time_ms},
+                          {"max_ejection_time_ms", upstream_.max_ejection_time_ms}};
+
+    config["metrics"] = {{"enabled", metrics_.enabled},
+                         {"file", metrics_.metrics_file},
+                         {"report_interval_sec", metrics_.report_interval_sec},
+                         {"prometheus_address", metrics_.prometheus_address}};
+
+    config["global"] = {{"query_timeout_ms", query_timeout_ms_},
+                        {"max_concurrent_queries", max_concurrent_queries_},
+                        {"ipv6_enabled", ipv6_enabled_},
+                        {"split_family_queries", split_family_queries_},
+                        {"family_grace_ms", family_grace_ms_}};
+
+    return config;
+}
+
 void DNSResolverConfig::addServer(const DNSServerConfig &server) {
     // 检查是否存在重复地址
     for (const auto &existing: servers_) {
@@ -267,10 +449,60 @@ void DNSResolverConfig::setCacheConfig(const CacheConfig &cache) {
         throw ConfigValidationError("Cache TTL must be between 1 and 86400 seconds");
     }
 
+    if (cache.min_ttl.count() < 1 || cache.min_ttl > cache.max_ttl || cache.max_ttl.count() > 86400) {
+        throw ConfigValidationError("Cache TTL bounds must satisfy 1 <= min_ttl <= max_ttl <= 86400 seconds");
+    }
+
     if (cache.max_size < 100 || cache.max_size > 1000000) {
         throw ConfigValidationError("Cache max size must be between 100 and 1000000 entries");
     }
 
+    if (cache.shard_count < 1 || cache.shard_count > 1024 || (cache.shard_count & (cache.shard_count - 1)) != 0) {
+        throw ConfigValidationError("Cache shard count must be a power of two between 1 and 1024");
+    }
+
+    if (cache.prefetch_enabled) {
+        if (cache.prefetch_threshold <= 0.0 || cache.prefetch_threshold >= 1.0) {
+            throw ConfigValidationError("Cache prefetch threshold must be between 0 and 1");
+        }
+        if (cache.prefetch_max_qps < 1 || cache.prefetch_max_qps > 100000) {
+            throw ConfigValidationError("Cache prefetch rate must be between 1 and 100000 queries per second");
+        }
+    }
+
+    if (cache.negative_enabled) {
+        if (cache.negative_ttl.count() < 1 || cache.negative_ttl.count() > 86400) {
+            throw ConfigValidationError("Negative cache TTL must be between 1 and 86400 seconds");
+        }
+        if (cache.negative_max_size < 1 || cache.negative_max_size > 1000000) {
+            throw ConfigValidationError("Negative cache max size must be between 1 and 1000000 entries");
+        }
+    }
+
+    if (cache.journal_enabled) {
+        if (cache.journal_flush_interval_ms < 10 || cache.journal_flush_interval_ms > 60000) {
+            throw ConfigValidationError("Cache journal flush interval must be between 10 and 60000 ms");
+        }
+        if (cache.checkpoint_interval.count() < 10 || cache.checkpoint_interval.count() > 86400) {
+            throw ConfigValidationError("Cache checkpoint interval must be between 10 and 86400 seconds");
+        }
+        if (cache.journal_max_size < 1024 * 1024 || cache.journal_max_size > 4ull * 1024 * 1024 * 1024) {
+            throw ConfigValidationError("Cache journal max size must be between 1 MB and 4 GB");
+        }
+    }
+
+    if (!cache.warmup_file.empty()) {
+        if (cache.warmup_max_in_flight < 1 || cache.warmup_max_in_flight > 10000) {
+            throw ConfigValidationError("Cache warmup concurrency must be between 1 and 10000 queries");
+        }
+        if (cache.warmup_timeout_ms < 100 || cache.warmup_timeout_ms > 600000) {
+            throw ConfigValidationError("Cache warmup timeout must be between 100 and 600000 ms");
+        }
+        if (cache.warmup_static_ttl.count() < 1 || cache.warmup_static_ttl.count() > 604800) {
+            throw ConfigValidationError("Cache warmup static TTL must be between 1 and 604800 seconds");
+        }
+    }
+
     cache_ = cache;
 }
 
@@ -288,9 +520,51 @@ void DNSResolverConfig::setRetryConfig(const RetryConfig &retry) {
         throw ConfigValidationError("Max retry delay must be between base delay and 10000ms");
     }
 
+    if (retry.budget_ratio < 0.0 || retry.budget_ratio > 1.0) {
+        throw ConfigValidationError("Retry budget ratio must be between 0 and 1");
+    }
+
+    if (retry.hedge_enabled) {
+        if (retry.hedge_percentile <= 0.0 || retry.hedge_percentile >= 1.0) {
+            throw ConfigValidationError("Hedge percentile must be between 0 and 1");
+        }
+        if (retry.hedge_min_delay_ms < 1 || retry.hedge_max_delay_ms < retry.hedge_min_delay_ms ||
+            retry.hedge_max_delay_ms > 10000) {
+            throw ConfigValidationError("Hedge delay bounds must satisfy 1ms <= min_delay <= max_delay <= 10000ms");
+        }
+        if (retry.hedge_budget_ratio < 0.0 || retry.hedge_budget_ratio > 1.0) {
+            throw ConfigValidationError("Hedge budget ratio must be between 0 and 1");
+        }
+    }
+
     retry_ = retry;
 }
 
+void DNSResolverConfig::setUpstreamConfig(const UpstreamConfig &upstream) {
+    if (upstream.selection != "p2c" && upstream.selection != "weighted") {
+        throw ConfigValidationError("Upstream selection must be \"p2c\" or \"weighted\": " + upstream.selection);
+    }
+
+    if (upstream.rtt_ewma_alpha <= 0.0 || upstream.rtt_ewma_alpha > 1.0) {
+        throw ConfigValidationError("Upstream RTT EWMA alpha must be in (0, 1]");
+    }
+
+    if (upstream.failure_threshold < 1 || upstream.failure_threshold > 100) {
+        throw ConfigValidationError("Upstream failure threshold must be between 1 and 100");
+    }
+
+    if (upstream.latency_outlier_factor != 0.0 && upstream.latency_outlier_factor < 1.5) {
+        throw ConfigValidationError("Upstream latency outlier factor must be 0 (disabled) or at least 1.5");
+    }
+
+    if (upstream.ejection_time_ms < 100 || upstream.max_ejection_time_ms < upstream.ejection_time_ms ||
+        upstream.max_ejection_time_ms > 600000) {
+        throw ConfigValidationError("Upstream ejection time must satisfy 100ms <= ejection_time <= max_ejection_time <= 600000ms");
+    }
+
+    upstream_ = upstream;
+}
+
 void DNSResolverConfig::setMetricsConfig(const MetricsConfig &metrics) {
     if (metrics.enabled && metrics.report_interval_sec < 1) {
         throw ConfigValidationError("Metrics report interval must be at least 1 second");
@@ -317,14 +591,25 @@ void DNSResolverConfig::setIPv6Enabled(const bool enabled) {
     ipv6_enabled_ = enabled;
 }
 
+void DNSResolverConfig::setSplitFamilyQueries(const bool enabled, const uint32_t grace_ms) {
+    if (grace_ms > 1000) {
+        throw ConfigValidationError("Address family grace period must not exceed 1000ms");
+    }
+    split_family_queries_ = enabled;
+    family_grace_ms_ = grace_ms;
+}
+
 void DNSResolverConfig::update(const DNSResolverConfig &other) {
     servers_ = other.servers_;
     cache_ = other.cache_;
     retry_ = other.retry_;
+    upstream_ = other.upstream_;
     metrics_ = other.metrics_;
     query_timeout_ms_ = other.query_timeout_ms_;
     max_concurrent_queries_ = other.max_concurrent_queries_;
     ipv6_enabled_ = other.ipv6_enabled_;
+    split_family_queries_ = other.split_family_queries_;
+    family_grace_ms_ = other.family_grace_ms_;
 }
 
 DNSResolverConfig DNSResolverConfig::clone() const {
@@ -334,18 +619,51 @@ DNSResolverConfig DNSResolverConfig::clone() const {
 }
 
 DNSResolverConfigBuilder::DNSResolverConfigBuilder()
-    : query_timeout_ms_(5000), max_concurrent_queries_(100), ipv6_enabled_(true) {
+    : query_timeout_ms_(5000), max_concurrent_queries_(100), ipv6_enabled_(true), split_family_queries_(false),
+      family_grace_ms_(50) {
     // 设置默认缓存配置
     cache_.enabled = true;
     cache_.ttl = std::chrono::seconds(300);
+    cache_.min_ttl = std::chrono::seconds(5);
+    cache_.max_ttl = std::chrono::seconds(86400);
     cache_.max_size = 10000;
     cache_.persistent = false;
     cache_.cache_file = "";
+    cache_.shard_count = 16;
+    cache_.prefetch_enabled = true;
+    cache_.prefetch_threshold = 0.2;
+    cache_.prefetch_max_qps = 100;
+    cache_.negative_enabled = true;
+    cache_.negative_ttl = std::chrono::seconds(30);
+    cache_.negative_max_size = 1000;
+    cache_.journal_enabled = false;
+    cache_.journal_flush_interval_ms = 1000;
+    cache_.checkpoint_interval = std::chrono::seconds(300);
+    cache_.journal_max_size = 64 * 1024 * 1024;
+    cache_.warmup_file = "";
+    cache_.warmup_max_in_flight = 64;
+    cache_.warmup_timeout_ms = 10000;
+    cache_.warmup_static_ttl = std::chrono::seconds(86400);
 
     // 设置默认重试配置
     retry_.max_attempts = 3;
     retry_.base_delay_ms = 100;
     retry_.max_delay_ms = 1000;
+    retry_.budget_ratio = 0.2;
+    retry_.budget_min_per_sec = 10;
+    retry_.hedge_enabled = false;
+    retry_.hedge_percentile = 0.95;
+    retry_.hedge_min_delay_ms = 5;
+    retry_.hedge_max_delay_ms = 500;
+    retry_.hedge_budget_ratio = 0.1;
+
+    // 设置默认上游选择配置
+    upstream_.selection = "p2c";
+    upstream_.rtt_ewma_alpha = 0.3;
+    upstream_.failure_threshold = 5;
+    upstream_.latency_outlier_factor = 3.0;
+    upstream_.ejection_time_ms = 1000;
+    upstream_.max_ejection_time_ms = 30000;
 
     // 设置默认监控配置
     metrics_.enabled = true;
@@ -374,6 +692,13 @@ DNSResolverConfigBuilder &DNSResolverConfigBuilder::setCacheTTL(const std::chron
     return *this;
 }
 
+DNSResolverConfigBuilder &DNSResolverConfigBuilder::setCacheTTLBounds(const std::chrono::seconds min_ttl,
+                                                                      const std::chrono::seconds max_ttl) {
+    cache_.min_ttl = min_ttl;
+    cache_.max_ttl = max_ttl;
+    return *this;
+}
+
 DNSResolverConfigBuilder &DNSResolverConfigBuilder::setCacheMaxSize(const size_t max_size) {
     cache_.max_size = max_size;
     return *this;
@@ -389,6 +714,49 @@ DNSResolverConfigBuilder &DNSResolverConfigBuilder::setCacheFile(const std::stri
     return *this;
 }
 
+DNSResolverConfigBuilder &DNSResolverConfigBuilder::setCacheShardCount(const size_t shard_count) {
+    cache_.shard_count = shard_count;
+    return *this;
+}
+
+DNSResolverConfigBuilder &DNSResolverConfigBuilder::setCachePrefetch(const bool enabled, const double threshold,
+                                                                     const uint32_t max_qps) {
+    cache_.prefetch_enabled = enabled;
+    cache_.prefetch_threshold = threshold;
+    cache_.prefetch_max_qps = max_qps;
+    return *this;
+}
+
+DNSResolverConfigBuilder &DNSResolverConfigBuilder::setCacheNegative(const bool enabled, const std::chrono::seconds ttl,
+                                                                     const size_t max_size) {
+    cache_.negative_enabled = enabled;
+    cache_.negative_ttl = ttl;
+    cache_.negative_max_size = max_size;
+    return *this;
+}
+
+DNSResolverConfigBuilder &DNSResolverConfigBuilder::setCacheJournal(const bool enabled,
+                                                                    const std::chrono::seconds checkpoint_interval,
+                                                                    const uint32_t flush_interval_ms,
+                                                                    const size_t max_size) {
+    cache_.journal_enabled = enabled;
+    cache_.checkpoint_interval = checkpoint_interval;
+    cache_.journal_flush_interval_ms = flush_interval_ms;
+    cache_.journal_max_size = max_size;
+    return *this;
+}
+
+DNSResolverConfigBuilder &DNSResolverConfigBuilder::setCacheWarmup(const std::string &file,
+                                                                   const uint32_t max_in_flight,
+                                                                   const uint32_t timeout_ms,
+                                                                   const std::chrono::seconds static_ttl) {
+    cache_.warmup_file = file;
+    cache_.warmup_max_in_flight = max_in_flight;
+    cache_.warmup_timeout_ms = timeout_ms;
+    cache_.warmup_static_ttl = static_ttl;
+    return *this;
+}
+
 DNSResolverConfigBuilder &DNSResolverConfigBuilder::setRetryAttempts(const uint32_t attempts) {
     retry_.max_attempts = attempts;
     return *this;
@@ -404,6 +772,51 @@ DNSResolverConfigBuilder &DNSResolverConfigBuilder::setRetryMaxDelay(const uint3
     return *this;
 }
 
+DNSResolverConfigBuilder &DNSResolverConfigBuilder::setRetryBudget(const double ratio, const uint32_t min_per_sec) {
+    retry_.budget_ratio = ratio;
+    retry_.budget_min_per_sec = min_per_sec;
+    return *this;
+}
+
+DNSResolverConfigBuilder &DNSResolverConfigBuilder::setHedging(const bool enabled, const double percentile,
+                                                              const uint32_t min_delay_ms,
+                                                              const uint32_t max_delay_ms) {
+    retry_.hedge_enabled = enabled;
+    retry_.hedge_percentile = percentile;
+    retry_.hedge_min_delay_ms = min_delay_ms;
+    retry_.hedge_max_delay_ms = max_delay_ms;
+    return *this;
+}
+
+DNSResolverConfigBuilder &DNSResolverConfigBuilder::setHedgeBudget(const double ratio) {
+    retry_.hedge_budget_ratio = ratio;
+    return *this;
+}
+
+DNSResolverConfigBuilder &DNSResolverConfigBuilder::addHedgeDomain(const std::string &domain) {
+    retry_.hedge_domains.push_back(domain);
+    return *this;
+}
+
+DNSResolverConfigBuilder &DNSResolverConfigBuilder::setUpstreamSelection(const std::string &selection) {
+    upstream_.selection = selection;
+    return *this;
+}
+
+DNSResolverConfigBuilder &DNSResolverConfigBuilder::setUpstreamEjection(const uint32_t failure_threshold,
+                                                                        const uint32_t ejection_time_ms,
+                                                                        const uint32_t max_ejection_time_ms) {
+    upstream_.failure_threshold = failure_threshold;
+    upstream_.ejection_time_ms = ejection_time_ms;
+    upstream_.max_ejection_time_ms = max_ejection_time_ms;
+    return *this;
+}
+
+DNSResolverConfigBuilder &DNSResolverConfigBuilder::setUpstreamLatencyOutlier(const double factor) {
+    upstream_.latency_outlier_factor = factor;
+    return *this;
+}
+
 DNSResolverConfigBuilder &DNSResolverConfigBuilder::setMetricsEnabled(const bool enabled) {
     metrics_.enabled = enabled;
     return *this;
@@ -439,6 +852,12 @@ DNSResolverConfigBuilder &DNSResolverConfigBuilder::setIPv6Enabled(const bool en
     return *this;
 }
 
+DNSResolverConfigBuilder &DNSResolverConfigBuilder::setSplitFamilyQueries(const bool enabled, const uint32_t grace_ms) {
+    split_family_queries_ = enabled;
+    family_grace_ms_ = grace_ms;
+    return *this;
+}
+
 DNSResolverConfig DNSResolverConfigBuilder::build() const {
     DNSResolverConfig config;
 
@@ -447,10 +866,12 @@ DNSResolverConfig DNSResolverConfigBuilder::build() const {
         config.setServers(servers_);
         config.setCacheConfig(cache_);
         config.setRetryConfig(retry_);
+        config.setUpstreamConfig(upstream_);
         config.setMetricsConfig(metrics_);
         config.setQueryTimeout(query_timeout_ms_);
         config.setMaxConcurrentQueries(max_concurrent_queries_);
         config.setIPv6Enabled(ipv6_enabled_);
+        config.setSplitFamilyQueries(split_family_queries_, family_grace_ms_);
     } catch (const ConfigValidationError &e) {
         throw ConfigValidationError(std::string("Configuration validation failed during build: ") + e.what());
     }
@@ -11,6 +11,7 @@ void DNSConfigValidator::validate(const DNSResolverConfig &config) {
     validateServers(config.servers());
     validateCache(config.cache());
     validateRetry(config.retry());
+    validateUpstream(config.upstream());
     validateMetrics(config.metrics());
 
     if (config.query_timeout_ms() < 100 ||
@@ -23,6 +24,10 @@ void DNSConfigValidator::validate(const DNSResolverConfig &config) {
         throw ConfigValidationError("Max concurrent queries must be between 1 and 10000");
     }
 
+    if (config.family_grace_ms() > 1000) {
+        throw ConfigValidationError("Address family grace period must not exceed 1000ms");
+    }
+
     // 检查服务器优先级和权重分布
     double total_weight = 0;
     for (const auto &server: config.servers()) {
@@ -88,10 +93,63 @@ void DNSConfigValidator::validateCache(const CacheConfig &cache) {
             throw ConfigValidationError("Cache TTL must be between 1 and 86400 seconds");
         }
 
+        if (cache.min_ttl.count() < 1 || cache.min_ttl > cache.max_ttl || cache.max_ttl.count() > 86400) {
+            throw ConfigValidationError("Cache TTL bounds must satisfy 1 <= min_ttl <= max_ttl <= 86400 seconds");
+        }
+
         if (cache.max_size < 100 || cache.max_size > 1000000) {
             throw ConfigValidationError("Cache max size must be between 100 and 1000000 entries");
         }
 
+        if (cache.shard_count < 1 || cache.shard_count > 1024 || (cache.shard_count & (cache.shard_count - 1)) != 0) {
+            throw ConfigValidationError("Cache shard count must be a power of two between 1 and 1024");
+        }
+
+        if (cache.prefetch_enabled) {
+            if (cache.prefetch_threshold <= 0.0 || cache.prefetch_threshold >= 1.0) {
+                throw ConfigValidationError("Cache prefetch threshold must be between 0 and 1");
+            }
+            if (cache.prefetch_max_qps < 1 || cache.prefetch_max_qps > 100000) {
+                throw ConfigValidationError("Cache prefetch rate must be between 1 and 100000 queries per second");
+            }
+        }
+
+        if (cache.negative_enabled) {
+            if (cache.negative_ttl.count() < 1 || cache.negative_ttl.count() > 86400) {
+                throw ConfigValidationError("Negative cache TTL must be between 1 and 86400 seconds");
+            }
+            if (cache.negative_max_size < 1 || cache.negative_max_size > 1000000) {
+                throw ConfigValidationError("Negative cache max size must be between 1 and 1000000 entries");
+            }
+        }
+
+        if (cache.journal_enabled) {
+            if (cache.journal_flush_interval_ms < 10 || cache.journal_flush_interval_ms > 60000) {
+                throw ConfigValidationError("Cache journal flush interval must be between 10 and 60000 ms");
+            }
+            if (cache.checkpoint_interval.count() < 10 || cache.checkpoint_interval.count() > 86400) {
+                throw ConfigValidationError("Cache checkpoint interval must be between 10 and 86400 seconds");
+            }
+            if (cache.journal_max_size < 1024 * 1024 || cache.journal_max_size > 4ull * 1024 * 1024 * 1024) {
+                throw ConfigValidationError("Cache journal max size must be between 1 MB and 4 GB");
+            }
+        }
+
+        if (!cache.warmup_file.empty()) {
+            if (cache.warmup_max_in_flight < 1 || cache.warmup_max_in_flight > 10000) {
+                throw ConfigValidationError("Cache warmup concurrency must be between 1 and 10000 queries");
+            }
+            if (cache.warmup_timeout_ms < 100 || cache.warmup_timeout_ms > 600000) {
+                throw ConfigValidationError("Cache warmup timeout must be between 100 and 600000 ms");
+            }
+            if (cache.warmup_static_ttl.count() < 1 || cache.warmup_static_ttl.count() > 604800) {
+                throw ConfigValidationError("Cache warmup static TTL must be between 1 and 604800 seconds");
+            }
+            if (!isValidPath(cache.warmup_file)) {
+                throw ConfigValidationError("Invalid cache warmup file path: " + cache.warmup_file);
+            }
+        }
+
         if (cache.persistent && !cache.cache_file.empty()) {
             if (!isValidPath(cache.cache_file)) {
                 throw ConfigValidationError("Invalid cache file path: " + cache.cache_file);
@@ -136,6 +194,23 @@ void DNSConfigValidator::validateRetry(const RetryConfig &retry) {
         throw ConfigValidationError("Max retry delay must be between base delay and 10000ms");
     }
 
+    if (retry.budget_ratio < 0.0 || retry.budget_ratio > 1.0) {
+        throw ConfigValidationError("Retry budget ratio must be between 0 and 1");
+    }
+
+    if (retry.hedge_enabled) {
+        if (retry.hedge_percentile <= 0.0 || retry.hedge_percentile >= 1.0) {
+            throw ConfigValidationError("Hedge percentile must be between 0 and 1");
+        }
+        if (retry.hedge_min_delay_ms < 1 || retry.hedge_max_delay_ms < retry.hedge_min_delay_ms ||
+            retry.hedge_max_delay_ms > 10000) {
+            throw ConfigValidationError("Hedge delay bounds must satisfy 1ms <= min_delay <= max_delay <= 10000ms");
+        }
+        if (retry.hedge_budget_ratio < 0.0 || retry.hedge_budget_ratio > 1.0) {
+            throw ConfigValidationError("Hedge budget ratio must be between 0 and 1");
+        }
+    }
+
     // 验证指数退避策略的合理性
     uint32_t max_possible_delay = retry.base_delay_ms;
     for (uint32_t i = 1; i < retry.max_attempts; ++i) {
@@ -224,4 +299,27 @@ bool DNSConfigValidator::isValidPath(const std::string &path) {
     } catch (const std::exception &) {
         return false;
     }
-}
\ No newline at end of file
+}
+
+void DNSConfigValidator::validateUpstream(const UpstreamConfig &upstream) {
+    if (upstream.selection != "p2c" && upstream.selection != "weighted") {
+        throw ConfigValidationError("Upstream selection must be \"p2c\" or \"weighted\": " + upstream.selection);
+    }
+
+    if (upstream.rtt_ewma_alpha <= 0.0 || upstream.rtt_ewma_alpha > 1.0) {
+        throw ConfigValidationError("Upstream RTT EWMA alpha must be in (0, 1]");
+    }
+
+    if (upstream.failure_threshold < 1 || upstream.failure_threshold > 100) {
+        throw ConfigValidationError("Upstream failure threshold must be between 1 and 100");
+    }
+
+    if (upstream.latency_outlier_factor != 0.0 && upstream.latency_outlier_factor < 1.5) {
+        throw ConfigValidationError("Upstream latency outlier factor must be 0 (disabled) or at least 1.5");
+    }
+
+    if (upstream.ejection_time_ms < 100 || upstream.max_ejection_time_ms < upstream.ejection_time_ms ||
+        upstream.max_ejection_time_ms > 600000) {
+        throw ConfigValidationError("Upstream ejection time must satisfy 100ms <= ejection_time <= max_ejection_time <= 600000ms");
+    }
+}
@@ -147,14 +147,19 @@ bool DNSConfigVersion::compareVersions(const std::string &version1, const std::s
             return false;
         }
 
-        differences.clear();
-        compareJsonObjects(v1.config, v2.config, "", differences);
+        compareConfigs(v1.config, v2.config, differences);
         return true;
     } catch (const std::exception &) {
         return false;
     }
 }
 
+void DNSConfigVersion::compareConfigs(const nlohmann::json &config1, const nlohmann::json &config2,
+                                      std::vector<std::string> &differences) {
+    differences.clear();
+    compareJsonObjects(config1, config2, "", differences);
+}
+
 bool DNSConfigVersion::exportVersion(const std::string &version, const std::string &output_file) const {
 
     try {
@@ -298,7 +303,7 @@ void DNSConfigVersion::maintainVersionHistory(size_t max_versions) {
 }
 
 void DNSConfigVersion::compareJsonObjects(const nlohmann::json &obj1, const nlohmann::json &obj2,
-                                          const std::string &path, std::vector<std::string> &differences) const {
+                                          const std::string &path, std::vector<std::string> &differences) {
 
     if (obj1.type() != obj2.type()) {
         differences.push_back(path + ": Type mismatch");
@@ -6,6 +6,22 @@ DNSEventManager &DNSEventManager::getInstance() {
     return instance;
 }
 
+DNSEventManager::DNSEventManager() {
+    dispatcher_ = std::thread(&DNSEventManager::run, this);
+}
+
+DNSEventManager::~DNSEventManager() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stopping_ = true;
+    }
+    queue_cv_.notify_all();
+    idle_cv_.notify_all();
+    if (dispatcher_.joinable()) {
+        dispatcher_.join();
+    }
+}
+
 void DNSEventManager::registerListener(const std::shared_ptr<DnsEventListener> &listener) {
     std::lock_guard<std::mutex> lock(mutex_);
     listeners_[listener->getName()] = listener;
@@ -27,30 +43,217 @@ void DNSEventManager::removeCallback(const std::string &name) {
 }
 
 void DNSEventManager::notifyAddressChanged(const DNSAddressEvent &event) {
+    if (!shouldProcessEvent(event)) {
+        return;
+    }
+
+    std::string key;
+    key.reserve(event.hostname.size() + event.record_type.size() + 1);
+    key.append(event.hostname);
+    key.push_back('\0');
+    key.append(event.record_type);
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (stopping_) {
+            return;
+        }
+        const auto it = pending_index_.find(key);
+        if (it != pending_index_.end()) {
+            // 尚未分发的同名事件：保留最早的旧地址，其余字段取最新值
+            auto &pending = event_queue_[it->second];
+            pending.new_addresses = event.new_addresses;
+            pending.timestamp = event.timestamp;
+            pending.source = event.source;
+            pending.ttl = event.ttl;
+            pending.is_authoritative = event.is_authoritative;
+            ++coalesced_;
+            ++enqueued_;
+            return;
+        }
+        if (event_queue_.size() >= queue_capacity_) {
+            ++dropped_;
+            return;
+        }
+        pending_index_.emplace(std::move(key), event_queue_.size());
+        event_queue_.push_back(event);
+        ++enqueued_;
+    }
+    queue_cv_.notify_one();
+}
+
+size_t DNSEventManager::getListenerCount() const {
     std::lock_guard<std::mutex> lock(mutex_);
+    return listeners_.size() + callbacks_.size();
+}
 
-    // 通知所有监听器
-    for (const auto &[name, listener]: listeners_) {
+void DNSEventManager::enableListener(const std::string &listener_name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (const auto it = listeners_.find(listener_name); it != listeners_.end()) {
+        it->second->setEnabled(true);
+    }
+}
+
+void DNSEventManager::disableListener(const std::string &listener_name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (const auto it = listeners_.find(listener_name); it != listeners_.end()) {
+        it->second->setEnabled(false);
+    }
+}
+
+void DNSEventManager::pauseEvents() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        paused_ = true;
+    }
+    idle_cv_.notify_all();
+}
+
+void DNSEventManager::resumeEvents() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        paused_ = false;
+    }
+    queue_cv_.notify_all();
+}
+
+void DNSEventManager::clearEventQueue() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        event_queue_.clear();
+        pending_index_.clear();
+        discarded_ = enqueued_;
+        if (!dispatching_) {
+            dispatched_ = enqueued_;
+        }
+    }
+    idle_cv_.notify_all();
+}
+
+void DNSEventManager::flush() {
+    if (std::this_thread::get_id() == dispatcher_.get_id()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    const uint64_t target = enqueued_;
+    idle_cv_.wait(lock, [&] { return dispatched_ >= target || paused_ || stopping_; });
+}
+
+void DNSEventManager::setQueueCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    queue_capacity_ = std::max<size_t>(1, capacity);
+}
+
+size_t DNSEventManager::pendingEvents() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return event_queue_.size();
+}
+
+uint64_t DNSEventManager::droppedEvents() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return dropped_;
+}
+
+uint64_t DNSEventManager::coalescedEvents() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return coalesced_;
+}
+
+void DNSEventManager::addEventFilter(const std::string &filter_name, DNSEventFilter filter) {
+    std::unique_lock<std::shared_mutex> lock(filter_mutex_);
+    filters_[filter_name] = std::move(filter);
+}
+
+void DNSEventManager::removeEventFilter(const std::string &filter_name) {
+    std::unique_lock<std::shared_mutex> lock(filter_mutex_);
+    filters_.erase(filter_name);
+}
+
+bool DNSEventManager::shouldProcessEvent(const DNSAddressEvent &event) const {
+    std::shared_lock<std::shared_mutex> lock(filter_mutex_);
+    for (const auto &[name, filter]: filters_) {
         try {
-            listener->onAddressChanged(event);
+            if (!filter(event)) {
+                return false;
+            }
         } catch (const std::exception &e) {
-            std::cerr << "Error notifying listener " << name
+            std::cerr << "Error executing event filter " << name
                       << ": " << e.what() << std::endl;
         }
     }
+    return true;
+}
 
-    // 执行所有回调
-    for (const auto &[name, callback]: callbacks_) {
+void DNSEventManager::run() {
+    std::vector<DNSAddressEvent> batch;
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    while (true) {
+        queue_cv_.wait(lock, [this] { return stopping_ || (!paused_ && !event_queue_.empty()); });
+        if (stopping_) {
+            break;
+        }
+        // 整个队列一次取走，合并索引随之失效
+        batch.swap(event_queue_);
+        pending_index_.clear();
+        const uint64_t batch_end = enqueued_;
+        dispatching_ = true;
+        lock.unlock();
+
+        processEventQueue(batch);
+        batch.clear();
+
+        lock.lock();
+        dispatching_ = false;
+        dispatched_ = std::max(batch_end, discarded_);
+        idle_cv_.notify_all();
+    }
+}
+
+void DNSEventManager::processEventQueue(const std::vector<DNSAddressEvent> &events) {
+    // 合并后旧地址与新地址相同（地址变化后又变回）的事件不再分发
+    std::vector<DNSAddressEvent> changed;
+    changed.reserve(events.size());
+    for (const auto &event: events) {
+        if (event.old_addresses != event.new_addresses) {
+            changed.push_back(event);
+        }
+    }
+    if (changed.empty()) {
+        return;
+    }
+
+    std::vector<std::shared_ptr<DnsEventListener>> listeners;
+    std::vector<std::pair<std::string, DNSEventCallback>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        listeners.reserve(listeners_.size());
+        for (const auto &[name, listener]: listeners_) {
+            listeners.push_back(listener);
+        }
+        callbacks.assign(callbacks_.begin(), callbacks_.end());
+    }
+
+    // 通知所有监听器
+    for (const auto &listener: listeners) {
+        if (!listener->isEnabled()) {
+            continue;
+        }
         try {
-            callback(event);
+            listener->onAddressesChanged(changed);
         } catch (const std::exception &e) {
-            std::cerr << "Error executing callback " << name
+            std::cerr << "Error notifying listener " << listener->getName()
                       << ": " << e.what() << std::endl;
         }
     }
-}
 
-size_t DNSEventManager::getListenerCount() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return listeners_.size() + callbacks_.size();
-}
\ No newline at end of file
+    // 执行所有回调
+    for (const auto &[name, callback]: callbacks) {
+        for (const auto &event: changed) {
+            try {
+                callback(event);
+            } catch (const std::exception &e) {
+                std::cerr << "Error executing callback " << name
+                          << ": " << e.what() << std::endl;
+            }
+        }
+    }
+}
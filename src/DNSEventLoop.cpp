@@ -0,0 +1,542 @@
+#include "DNSEventLoop.h"
+
+#include <algorithm>
+#include <iostream>
+
+#if defined(__linux__)
+#define DNS_EVENT_LOOP_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__) || defined(__DragonFly__)
+#define DNS_EVENT_LOOP_KQUEUE
+#include <fcntl.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#else
+#define DNS_EVENT_LOOP_POLL
+#if defined(_WIN32)
+#include <winsock2.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace {
+    constexpr int MAX_EVENTS = 256;
+
+#if defined(_WIN32)
+    // Windows下没有可与socket一起等待的唤醒描述符，wakeup()只能依赖较短的等待切片
+    constexpr int WIN32_WAIT_SLICE_MS = 10;
+#endif
+
+#if defined(DNS_EVENT_LOOP_KQUEUE) || (defined(DNS_EVENT_LOOP_POLL) && !defined(_WIN32))
+    bool makePipe(int fds[2]) {
+        if (pipe(fds) != 0) {
+            return false;
+        }
+        for (int i = 0; i < 2; ++i) {
+            fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+            fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+        }
+        return true;
+    }
+#endif
+}// namespace
+
+DNSEventLoop::DNSEventLoop() = default;
+
+DNSEventLoop::~DNSEventLoop() {
+    stop();
+}
+
+bool DNSEventLoop::start() {
+    if (running_) {
+        return true;
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock(wakeup_mutex_);
+        if (!openBackend()) {
+            std::cerr << "Failed to initialize DNS event loop backend" << std::endl;
+            closeBackend();
+            return false;
+        }
+    }
+
+    // 之前已注册的socket需要重新加入新的后端
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &[fd, state]: sockets_) {
+            registerSocket(fd, state, true);
+        }
+    }
+
+    running_ = true;
+    thread_ = std::thread(&DNSEventLoop::run, this);
+    return true;
+}
+
+void DNSEventLoop::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    wakeup();
+    if (thread_.joinable()) {
+        if (thread_.get_id() == std::this_thread::get_id()) {
+            thread_.detach();
+        } else {
+            thread_.join();
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(wakeup_mutex_);
+    closeBackend();
+}
+
+bool DNSEventLoop::running() const {
+    return running_;
+}
+
+bool DNSEventLoop::inLoopThread() const {
+    return thread_.get_id() == std::this_thread::get_id();
+}
+
+void DNSEventLoop::addChannel(ares_channel channel) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (std::ranges::find(channels_, channel) == channels_.end()) {
+            channels_.push_back(channel);
+        }
+    }
+    wakeup();
+}
+
+void DNSEventLoop::removeChannel(ares_channel channel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::erase(channels_, channel);
+    for (auto it = sockets_.begin(); it != sockets_.end();) {
+        if (it->second.channel == channel) {
+            unregisterSocket(it->first);
+            it = sockets_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void DNSEventLoop::updateSocket(ares_channel channel, ares_socket_t socket_fd, bool readable, bool writable) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!readable && !writable) {
+            if (sockets_.erase(socket_fd) > 0) {
+                unregisterSocket(socket_fd);
+            }
+        } else {
+            auto [it, inserted] = sockets_.try_emplace(socket_fd);
+            it->second = {channel, readable, writable};
+            registerSocket(socket_fd, it->second, inserted);
+        }
+    }
+#if defined(DNS_EVENT_LOOP_POLL)
+    // poll后端每轮重建描述符集合，需要唤醒才能生效
+    if (!inLoopThread()) {
+        wakeup();
+    }
+#endif
+}
+
+DNSEventLoop::TimerId DNSEventLoop::schedule(std::chrono::milliseconds delay, TimerFn fn) {
+    TimerId id;
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = next_timer_id_++;
+        auto it = timers_.emplace(Clock::now() + delay, std::make_pair(id, std::move(fn)));
+        timer_index_.emplace(id, it);
+        earliest = it == timers_.begin();
+    }
+    // 新定时器早于当前等待的截止时间时需要唤醒I/O线程
+    if (earliest && !inLoopThread()) {
+        wakeup();
+    }
+    return id;
+}
+
+bool DNSEventLoop::cancel(TimerId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = timer_index_.find(id);
+    if (it == timer_index_.end()) {
+        return false;
+    }
+    timers_.erase(it->second);
+    timer_index_.erase(it);
+    return true;
+}
+
+size_t DNSEventLoop::pendingTimers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return timers_.size();
+}
+
+void DNSEventLoop::runDueTimers() {
+    std::vector<TimerFn> due;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto now = Clock::now();
+        while (!timers_.empty() && timers_.begin()->first <= now) {
+            auto node = timers_.extract(timers_.begin());
+            timer_index_.erase(node.mapped().first);
+            due.push_back(std::move(node.mapped().second));
+        }
+    }
+    // 回调中可能再次调度定时器，因此在锁外执行
+    for (auto &fn: due) {
+        try {
+            fn();
+        } catch (const std::exception &e) {
+            std::cerr << "Error executing timer callback: " << e.what() << std::endl;
+        }
+    }
+}
+
+void DNSEventLoop::run() {
+    std::vector<ReadyEvent> ready;
+    ready.reserve(MAX_EVENTS);
+    std::vector<ares_channel> channels;
+
+    while (running_) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            channels = channels_;
+        }
+
+        ready.clear();
+        waitEvents(nextTimeoutMs(channels), ready);
+        if (!running_) {
+            break;
+        }
+
+        // 处理就绪的socket
+        for (const auto &event: ready) {
+            ares_process_fd(event.channel,
+                            event.readable ? event.socket_fd : ARES_SOCKET_BAD,
+                            event.writable ? event.socket_fd : ARES_SOCKET_BAD);
+        }
+
+        // 处理超时（以及没有I/O事件的channel上的重传）
+        for (auto *channel: channels) {
+            ares_process_fd(channel, ARES_SOCKET_BAD, ARES_SOCKET_BAD);
+        }
+
+        runDueTimers();
+    }
+}
+
+int DNSEventLoop::nextTimeoutMs(const std::vector<ares_channel> &channels) const {
+    timeval max_tv{};
+    max_tv.tv_sec = MAX_WAIT_MS / 1000;
+    max_tv.tv_usec = (MAX_WAIT_MS % 1000) * 1000;
+
+    int timeout_ms = MAX_WAIT_MS;
+    for (auto *channel: channels) {
+        timeval tv{};
+        const timeval *next = ares_timeout(channel, &max_tv, &tv);
+        if (next) {
+            // 向上取整，避免在到期前空转
+            const int ms = static_cast<int>(next->tv_sec * 1000 + (next->tv_usec + 999) / 1000);
+            timeout_ms = std::min(timeout_ms, ms);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!timers_.empty()) {
+            const auto until = std::chrono::ceil<std::chrono::milliseconds>(timers_.begin()->first - Clock::now());
+            timeout_ms = std::min(timeout_ms, static_cast<int>(until.count()));
+        }
+    }
+#if defined(_WIN32)
+    timeout_ms = std::min(timeout_ms, WIN32_WAIT_SLICE_MS);
+#endif
+    return std::max(timeout_ms, 0);
+}
+
+#if defined(DNS_EVENT_LOOP_EPOLL)
+
+bool DNSEventLoop::openBackend() {
+    backend_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (backend_fd_ < 0) {
+        return false;
+    }
+    wakeup_fds_[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fds_[0] < 0) {
+        return false;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wakeup_fds_[0];
+    return epoll_ctl(backend_fd_, EPOLL_CTL_ADD, wakeup_fds_[0], &ev) == 0;
+}
+
+void DNSEventLoop::closeBackend() {
+    if (wakeup_fds_[0] >= 0) {
+        close(wakeup_fds_[0]);
+        wakeup_fds_[0] = -1;
+    }
+    if (backend_fd_ >= 0) {
+        close(backend_fd_);
+        backend_fd_ = -1;
+    }
+}
+
+void DNSEventLoop::registerSocket(ares_socket_t socket_fd, const SocketState &state, bool is_new) {
+    if (backend_fd_ < 0) {
+        return;
+    }
+    epoll_event ev{};
+    ev.events = (state.readable ? EPOLLIN : 0u) | (state.writable ? EPOLLOUT : 0u);
+    ev.data.fd = socket_fd;
+    if (epoll_ctl(backend_fd_, is_new ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, socket_fd, &ev) != 0) {
+        // 描述符号被复用时状态可能不一致，换一种操作重试
+        epoll_ctl(backend_fd_, is_new ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, socket_fd, &ev);
+    }
+}
+
+void DNSEventLoop::unregisterSocket(ares_socket_t socket_fd) {
+    if (backend_fd_ >= 0) {
+        // socket可能已被c-ares关闭，失败可以忽略
+        epoll_ctl(backend_fd_, EPOLL_CTL_DEL, socket_fd, nullptr);
+    }
+}
+
+void DNSEventLoop::waitEvents(int timeout_ms, std::vector<ReadyEvent> &ready) {
+    epoll_event events[MAX_EVENTS];
+    const int n = epoll_wait(backend_fd_, events, MAX_EVENTS, timeout_ms);
+    if (n <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < n; ++i) {
+        const int fd = events[i].data.fd;
+        if (fd == wakeup_fds_[0]) {
+            drainWakeup();
+            continue;
+        }
+        const auto it = sockets_.find(fd);
+        if (it == sockets_.end()) {
+            continue;
+        }
+        // 错误与挂断交给c-ares在读路径上处理
+        const bool readable = events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP);
+        const bool writable = events[i].events & EPOLLOUT;
+        ready.push_back({it->second.channel, fd, readable, writable});
+    }
+}
+
+void DNSEventLoop::wakeup() {
+    std::shared_lock<std::shared_mutex> lock(wakeup_mutex_);
+    if (wakeup_fds_[0] >= 0) {
+        const uint64_t one = 1;
+        [[maybe_unused]] auto ret = write(wakeup_fds_[0], &one, sizeof(one));
+    }
+}
+
+void DNSEventLoop::drainWakeup() {
+    uint64_t value;
+    while (read(wakeup_fds_[0], &value, sizeof(value)) > 0) {
+    }
+}
+
+#elif defined(DNS_EVENT_LOOP_KQUEUE)
+
+bool DNSEventLoop::openBackend() {
+    backend_fd_ = kqueue();
+    if (backend_fd_ < 0) {
+        return false;
+    }
+    fcntl(backend_fd_, F_SETFD, FD_CLOEXEC);
+    if (!makePipe(wakeup_fds_)) {
+        return false;
+    }
+    struct kevent change {};
+    EV_SET(&change, wakeup_fds_[0], EVFILT_READ, EV_ADD, 0, 0, nullptr);
+    return kevent(backend_fd_, &change, 1, nullptr, 0, nullptr) == 0;
+}
+
+void DNSEventLoop::closeBackend() {
+    for (auto &fd: wakeup_fds_) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (backend_fd_ >= 0) {
+        close(backend_fd_);
+        backend_fd_ = -1;
+    }
+}
+
+void DNSEventLoop::registerSocket(ares_socket_t socket_fd, const SocketState &state, bool) {
+    if (backend_fd_ < 0) {
+        return;
+    }
+    struct kevent changes[2];
+    EV_SET(&changes[0], socket_fd, EVFILT_READ, state.readable ? EV_ADD : EV_DELETE, 0, 0, nullptr);
+    EV_SET(&changes[1], socket_fd, EVFILT_WRITE, state.writable ? EV_ADD : EV_DELETE, 0, 0, nullptr);
+    // 删除不存在的过滤器会返回ENOENT，逐个提交以免影响另一个
+    for (auto &change: changes) {
+        kevent(backend_fd_, &change, 1, nullptr, 0, nullptr);
+    }
+}
+
+void DNSEventLoop::unregisterSocket(ares_socket_t socket_fd) {
+    registerSocket(socket_fd, {}, false);
+}
+
+void DNSEventLoop::waitEvents(int timeout_ms, std::vector<ReadyEvent> &ready) {
+    struct kevent events[MAX_EVENTS];
+    timespec ts{};
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000;
+    const int n = kevent(backend_fd_, nullptr, 0, events, MAX_EVENTS, &ts);
+    if (n <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < n; ++i) {
+        const auto fd = static_cast<ares_socket_t>(events[i].ident);
+        if (fd == wakeup_fds_[0]) {
+            drainWakeup();
+            continue;
+        }
+        const auto it = sockets_.find(fd);
+        if (it == sockets_.end()) {
+            continue;
+        }
+        const bool readable = events[i].filter == EVFILT_READ || (events[i].flags & (EV_EOF | EV_ERROR));
+        const bool writable = events[i].filter == EVFILT_WRITE;
+        ready.push_back({it->second.channel, fd, readable, writable});
+    }
+}
+
+void DNSEventLoop::wakeup() {
+    std::shared_lock<std::shared_mutex> lock(wakeup_mutex_);
+    if (wakeup_fds_[1] >= 0) {
+        const char c = 1;
+        [[maybe_unused]] auto ret = write(wakeup_fds_[1], &c, 1);
+    }
+}
+
+void DNSEventLoop::drainWakeup() {
+    char buf[64];
+    while (read(wakeup_fds_[0], buf, sizeof(buf)) > 0) {
+    }
+}
+
+#else// DNS_EVENT_LOOP_POLL
+
+#if defined(_WIN32)
+using PollFd = WSAPOLLFD;
+#define DNS_POLL WSAPoll
+#else
+using PollFd = pollfd;
+#define DNS_POLL poll
+#endif
+
+bool DNSEventLoop::openBackend() {
+#if defined(_WIN32)
+    return true;
+#else
+    return makePipe(wakeup_fds_);
+#endif
+}
+
+void DNSEventLoop::closeBackend() {
+    for (auto &fd: wakeup_fds_) {
+        if (fd >= 0) {
+#if !defined(_WIN32)
+            close(fd);
+#endif
+            fd = -1;
+        }
+    }
+}
+
+void DNSEventLoop::registerSocket(ares_socket_t, const SocketState &, bool) {
+    // poll后端在每轮等待前根据sockets_重建描述符集合
+}
+
+void DNSEventLoop::unregisterSocket(ares_socket_t) {
+}
+
+void DNSEventLoop::waitEvents(int timeout_ms, std::vector<ReadyEvent> &ready) {
+    std::vector<PollFd> fds;
+    std::vector<ares_channel> owners;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fds.reserve(sockets_.size() + 1);
+        owners.reserve(sockets_.size());
+        for (const auto &[fd, state]: sockets_) {
+            PollFd pfd{};
+            pfd.fd = fd;
+            pfd.events = static_cast<short>((state.readable ? POLLIN : 0) | (state.writable ? POLLOUT : 0));
+            fds.push_back(pfd);
+            owners.push_back(state.channel);
+        }
+    }
+#if !defined(_WIN32)
+    PollFd wake{};
+    wake.fd = wakeup_fds_[0];
+    wake.events = POLLIN;
+    fds.push_back(wake);
+#else
+    if (fds.empty()) {
+        // WSAPoll不接受空集合
+        Sleep(static_cast<DWORD>(timeout_ms));
+        return;
+    }
+#endif
+
+    const int n = DNS_POLL(fds.data(), static_cast<unsigned long>(fds.size()), timeout_ms);
+    if (n <= 0) {
+        return;
+    }
+    for (size_t i = 0; i < owners.size(); ++i) {
+        const auto revents = fds[i].revents;
+        if (revents == 0) {
+            continue;
+        }
+        const bool readable = revents & (POLLIN | POLLERR | POLLHUP);
+        const bool writable = revents & POLLOUT;
+        ready.push_back({owners[i], static_cast<ares_socket_t>(fds[i].fd), readable, writable});
+    }
+#if !defined(_WIN32)
+    if (fds.back().revents & POLLIN) {
+        drainWakeup();
+    }
+#endif
+}
+
+void DNSEventLoop::wakeup() {
+    std::shared_lock<std::shared_mutex> lock(wakeup_mutex_);
+#if !defined(_WIN32)
+    if (wakeup_fds_[1] >= 0) {
+        const char c = 1;
+        [[maybe_unused]] auto ret = write(wakeup_fds_[1], &c, 1);
+    }
+#endif
+}
+
+void DNSEventLoop::drainWakeup() {
+#if !defined(_WIN32)
+    char buf[64];
+    while (read(wakeup_fds_[0], buf, sizeof(buf)) > 0) {
+    }
+#endif
+}
+
+#endif
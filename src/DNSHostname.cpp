@@ -0,0 +1,128 @@
+#include "DNSHostname.h"
+
+#include <array>
+#include <mutex>
+#include <unordered_map>
+
+// 驻留表按哈希分片加锁。条目的键指向Data自身的name，Data的删除器在释放内存前先从表中移除自己，
+// 因此表中的键总是有效的；句柄在进程退出时可能仍被静态对象持有，表本身不析构
+class DNSHostname::Table {
+public:
+    static Table &instance() {
+        static auto *table = new Table();
+        return *table;
+    }
+
+    std::shared_ptr<const Data> intern(std::string_view name) {
+        const size_t hash = hashOf(name);
+        auto &shard = shards_[shardIndex(hash)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (const auto it = shard.entries.find(name); it != shard.entries.end()) {
+            if (auto data = it->second.weak.lock()) {
+                return data;
+            }
+            // 最后一个句柄刚释放，删除器正在等待锁；由它之后发现条目已被替换
+            shard.entries.erase(it);
+        }
+        auto *raw = new Data{std::string(name), hash};
+        std::shared_ptr<const Data> data(raw, [this](const Data *d) { release(d); });
+        shard.entries.emplace(std::string_view(raw->name), Entry{raw, data});
+        return data;
+    }
+
+    size_t size() {
+        size_t total = 0;
+        for (auto &shard: shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total += shard.entries.size();
+        }
+        return total;
+    }
+
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    struct Entry {
+        const Data *data;
+        std::weak_ptr<const Data> weak;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string_view, Entry> entries;
+    };
+
+    static size_t shardIndex(size_t hash) {
+        return static_cast<size_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull) >> 32) & (SHARD_COUNT - 1);
+    }
+
+    void release(const Data *data) {
+        {
+            auto &shard = shards_[shardIndex(data->hash)];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            const auto it = shard.entries.find(std::string_view(data->name));
+            if (it != shard.entries.end() && it->second.data == data) {
+                shard.entries.erase(it);
+            }
+        }
+        delete data;
+    }
+
+    std::array<Shard, SHARD_COUNT> shards_{};
+};
+
+DNSHostname::DNSHostname(std::string_view hostname) {
+    data_ = Table::instance().intern(isCanonical(hostname) ? hostname : canonicalize(hostname));
+}
+
+DNSHostname DNSHostname::verbatim(std::string_view name) {
+    DNSHostname hostname;
+    hostname.data_ = Table::instance().intern(name);
+    return hostname;
+}
+
+const std::string &DNSHostname::str() const {
+    static const std::string empty;
+    return data_ ? data_->name : empty;
+}
+
+size_t DNSHostname::hash() const {
+    return data_ ? data_->hash : hashOf({});
+}
+
+std::string DNSHostname::canonicalize(std::string_view hostname) {
+    if (hostname.ends_with('.')) {
+        hostname.remove_suffix(1);
+    }
+    std::string result(hostname);
+    for (auto &c: result) {
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return result;
+}
+
+const std::string &DNSHostname::canonicalize(const std::string &hostname, std::string &scratch) {
+    if (isCanonical(hostname)) {
+        return hostname;
+    }
+    scratch = canonicalize(std::string_view(hostname));
+    return scratch;
+}
+
+bool DNSHostname::isCanonical(std::string_view hostname) {
+    if (hostname.ends_with('.')) {
+        return false;
+    }
+    for (const char c: hostname) {
+        if (c >= 'A' && c <= 'Z') {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t DNSHostname::internedCount() {
+    return Table::instance().size();
+}
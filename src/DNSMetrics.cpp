@@ -1,11 +1,46 @@
 #include "DNSMetrics.h"
+#include <algorithm>
+#include <ares.h>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <nlohmann/json.hpp>
-#include <numeric>
+#include <sstream>
 
-constexpr size_t MAX_SAMPLES = 1000;
+namespace {
+    // Prometheus查询耗时直方图的桶边界，单位秒
+    const std::vector<double> QUERY_DURATION_BUCKETS{0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5};
+
+    std::string formatMs(double ms) {
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(1) << ms << "ms";
+        return oss.str();
+    }
+
+    uint64_t delta(uint64_t current, uint64_t previous) {
+        return current >= previous ? current - previous : current;
+    }
+
+    // 把细粒度分桶的增量折算到Prometheus的桶边界（按桶下界归属），耗时以秒为单位
+    void observeDelta(prometheus::Histogram &histogram, const DNSLatencyHistogram::Buckets &current,
+                      const DNSLatencyHistogram::Buckets &previous, uint64_t sum_delta_us) {
+        std::vector<double> increments(QUERY_DURATION_BUCKETS.size() + 1, 0.0);
+        bool observed = false;
+        for (size_t i = 0; i < DNSLatencyHistogram::BUCKET_COUNT; ++i) {
+            const uint64_t n = delta(current[i], previous[i]);
+            if (n == 0) {
+                continue;
+            }
+            const double lower = static_cast<double>(DNSLatencyHistogram::bucketLowerBound(i)) / 1e6;
+            const auto bound = std::lower_bound(QUERY_DURATION_BUCKETS.begin(), QUERY_DURATION_BUCKETS.end(), lower);
+            increments[static_cast<size_t>(bound - QUERY_DURATION_BUCKETS.begin())] += static_cast<double>(n);
+            observed = true;
+        }
+        if (observed) {
+            histogram.ObserveMultiple(increments, static_cast<double>(sum_delta_us) / 1e6);
+        }
+    }
+}// namespace
 
 DNSMetrics::DNSMetrics()
     : registry_(std::make_shared<prometheus::Registry>()),
@@ -34,11 +69,26 @@ DNSMetrics::DNSMetrics()
                             .Help("Number of cache misses")
                             .Register(*registry_)
                             .Add({})),
+      negative_cache_hits_(prometheus::BuildCounter()
+                                   .Name("dns_negative_cache_hits_total")
+                                   .Help("Number of lookups answered by a cached NXDOMAIN/NODATA response")
+                                   .Register(*registry_)
+                                   .Add({})),
+      prefetches_(prometheus::BuildCounter()
+                          .Name("dns_cache_prefetches")
+                          .Help("Number of background refresh-ahead queries")
+                          .Register(*registry_)
+                          .Add({})),
+      coalesced_queries_(prometheus::BuildCounter()
+                                 .Name("dns_coalesced_queries")
+                                 .Help("Number of cache misses served by an already in-flight query")
+                                 .Register(*registry_)
+                                 .Add({})),
       query_duration_(prometheus::BuildHistogram()
                               .Name("dns_query_duration_seconds")
                               .Help("DNS query duration in seconds")
                               .Register(*registry_)
-                              .Add({}, std::vector<double>{0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5})),
+                              .Add({}, QUERY_DURATION_BUCKETS)),
       cache_hit_rate_(prometheus::BuildGauge()
                               .Name("dns_cache_hit_rate")
                               .Help("Cache hit rate")
@@ -48,7 +98,62 @@ DNSMetrics::DNSMetrics()
                              .Name("dns_total_retries_")
                              .Help("Total number of DNS retries")
                              .Register(*registry_)
-                             .Add({})) {
+                             .Add({})),
+      hedged_queries_(prometheus::BuildCounter()
+                              .Name("dns_hedged_queries_total")
+                              .Help("Number of hedged queries sent to a second upstream")
+                              .Register(*registry_)
+                              .Add({})),
+      hedge_wins_(prometheus::BuildCounter()
+                          .Name("dns_hedge_wins_total")
+                          .Help("Number of hedged queries answered before the original query")
+                          .Register(*registry_)
+                          .Add({})),
+      warmup_targets_(prometheus::BuildGauge()
+                              .Name("dns_warmup_targets")
+                              .Help("Number of hostnames and static entries to load during cache warmup")
+                              .Register(*registry_)
+                              .Add({})),
+      warmup_completed_(prometheus::BuildGauge()
+                                .Name("dns_warmup_completed")
+                                .Help("Number of warmup targets processed, including failures")
+                                .Register(*registry_)
+                                .Add({})),
+      warmup_failed_(prometheus::BuildGauge()
+                             .Name("dns_warmup_failed")
+                             .Help("Number of warmup hostnames that failed to resolve")
+                             .Register(*registry_)
+                             .Add({})),
+      ready_gauge_(prometheus::BuildGauge()
+                           .Name("dns_ready")
+                           .Help("Whether the resolver has finished warmup and is ready to serve (1) or not (0)")
+                           .Register(*registry_)
+                           .Add({})),
+      errors_family_(prometheus::BuildCounter()
+                             .Name("dns_errors_total")
+                             .Help("Number of DNS errors by type and c-ares status")
+                             .Register(*registry_)),
+      server_queries_family_(prometheus::BuildCounter()
+                                     .Name("dns_server_queries_total")
+                                     .Help("Number of answers from each upstream server by result")
+                                     .Register(*registry_)),
+      server_latency_family_(prometheus::BuildHistogram()
+                                     .Name("dns_server_latency_seconds")
+                                     .Help("Upstream server response time in seconds")
+                                     .Register(*registry_)) {
+    retry_history_.reserve(MAX_RETRY_HISTORY);
+    ticker_ = std::thread(&DNSMetrics::runTicker, this);
+}
+
+DNSMetrics::~DNSMetrics() {
+    {
+        std::lock_guard<std::mutex> lock(ticker_mutex_);
+        ticker_stop_ = true;
+    }
+    ticker_cv_.notify_all();
+    if (ticker_.joinable()) {
+        ticker_.join();
+    }
 }
 
 void DNSMetrics::startPrometheusExporter(const std::string &address) {
@@ -61,138 +166,420 @@ void DNSMetrics::startPrometheusExporter(const std::string &address) {
     }
 }
 
-void DNSMetrics::recordQuery(const std::string &hostname, std::chrono::milliseconds duration, bool success) {
-    total_queries_.Increment();
+void DNSMetrics::recordQuery(const std::string &hostname, std::chrono::microseconds duration, bool success) {
     if (success) {
-        successful_queries_.Increment();
+        successful_count_.add();
     } else {
-        failed_queries_.Increment();
-    }
-    query_duration_.Observe(duration.count());
-    // 检查延迟是否超过阈值
-    if (duration > latency_threshold_) {
-        std::string alert = "High latency detected for " + hostname + ": " + std::to_string(duration.count()) + "ms";
-        for (const auto &callback: alert_callbacks_) {
-            callback(alert);
-        }
-    }
-    // 计算错误率并检查阈值
-    auto total = successful_queries_.Value() + failed_queries_.Value();
-    if (total > 0) {
-        double error_rate = failed_queries_.Value() / total;
-        if (error_rate > error_rate_threshold_) {
-            std::string alert = "High error rate detected: " + std::to_string(error_rate * 100) + "%";
-            for (const auto &callback: alert_callbacks_) {
-                callback(alert);
-            }
-        }
+        failed_count_.add();
     }
+    query_latency_.record(duration);
 }
 
 void DNSMetrics::recordCacheHit(const std::string &hostname) {
-    cache_hits_.Increment();
-    updateCacheHitRate();
+    cache_hit_count_.add();
 }
 
 void DNSMetrics::recordCacheMiss(const std::string &hostname) {
-    cache_misses_.Increment();
-    updateCacheHitRate();
+    cache_miss_count_.add();
 }
 
-void DNSMetrics::recordServerLatency(const std::string &server, std::chrono::milliseconds latency) {
-    std::lock_guard<std::mutex> lock(latency_mutex_);
-    server_latencies_[server].push_back(latency.count());
-    // 保持最近1000个样本
-    if (server_latencies_[server].size() > MAX_SAMPLES) {
-        server_latencies_[server].erase(
-                server_latencies_[server].begin(),
-                server_latencies_[server].begin() + (server_latencies_[server].size() - MAX_SAMPLES));
-    }
+void DNSMetrics::recordNegativeCacheHit(const std::string &hostname) {
+    negative_hit_count_.add();
+}
 
-    // 检查延迟阈值
-    if (latency > latency_threshold_) {
-        std::string alert = "High server latency detected for " + server + ": " + std::to_string(latency.count()) + "ms";
-        for (const auto &callback: alert_callbacks_) {
-            callback(alert);
-        }
-    }
+void DNSMetrics::recordPrefetch(const std::string &hostname) {
+    prefetch_count_.add();
+}
+
+void DNSMetrics::recordCoalescedQuery(const std::string &hostname) {
+    coalesced_count_.add();
+}
+
+void DNSMetrics::recordServerLatency(const std::string &server, std::chrono::microseconds latency) {
+    serverMetrics(server).latency.record(latency);
+}
+
+void DNSMetrics::recordServerQuery(const std::string &server, bool success) {
+    auto &metrics = serverMetrics(server);
+    (success ? metrics.successes : metrics.failures).fetch_add(1, std::memory_order_relaxed);
 }
 
 void DNSMetrics::recordError(const std::string &type, const std::string &detail) {
-    std::lock_guard<std::mutex> lock(error_mutex_);
-    error_counts_[type]++;
+    errorCounter(type, detail).count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DNSMetrics::recordError(const std::string &type, int ares_status) {
+    errorCounter(type, aresStatusName(ares_status)).count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DNSMetrics::recordHedge(const std::string &hostname) {
+    hedge_count_.add();
+}
+
+void DNSMetrics::recordHedgeWin(const std::string &hostname) {
+    hedge_win_count_.add();
+}
+
+void DNSMetrics::recordWarmupProgress(size_t total, size_t completed, size_t failed) {
+    warmup_target_count_.store(total, std::memory_order_relaxed);
+    warmup_completed_count_.store(completed, std::memory_order_relaxed);
+    warmup_failed_count_.store(failed, std::memory_order_relaxed);
+    warmup_targets_.Set(static_cast<double>(total));
+    warmup_completed_.Set(static_cast<double>(completed));
+    warmup_failed_.Set(static_cast<double>(failed));
+}
+
+void DNSMetrics::setReady(bool ready) {
+    ready_.store(ready, std::memory_order_relaxed);
+    ready_gauge_.Set(ready ? 1 : 0);
+}
+
+DNSMetrics::ServerMetrics &DNSMetrics::serverMetrics(const std::string &server) {
+    {
+        std::shared_lock<std::shared_mutex> lock(latency_mutex_);
+        if (const auto it = server_metrics_.find(server); it != server_metrics_.end()) {
+            return *it->second;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(latency_mutex_);
+    auto &metrics = server_metrics_[server];
+    if (!metrics) {
+        metrics = std::make_unique<ServerMetrics>();
+        metrics->success_counter = &server_queries_family_.Add({{"server", server}, {"result", "success"}});
+        metrics->failure_counter = &server_queries_family_.Add({{"server", server}, {"result", "failure"}});
+        metrics->latency_histogram = &server_latency_family_.Add({{"server", server}}, QUERY_DURATION_BUCKETS);
+    }
+    return *metrics;
+}
 
-    // 记录详细错误信息到Prometheus
-    prometheus::Counter &error_counter = prometheus::BuildCounter()
-                                                 .Name("dns_error_" + type)
-                                                 .Help("Number of " + type + " errors")
-                                                 .Register(*registry_)
-                                                 .Add({});
-    error_counter.Increment();
+DNSMetrics::ErrorCounter &DNSMetrics::errorCounter(const std::string &type, const std::string &status) {
+    {
+        std::shared_lock<std::shared_mutex> lock(error_mutex_);
+        if (const auto by_type = error_counters_.find(type); by_type != error_counters_.end()) {
+            if (const auto it = by_type->second.find(status); it != by_type->second.end()) {
+                return *it->second;
+            }
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(error_mutex_);
+    auto &counter = error_counters_[type][status];
+    if (!counter) {
+        counter = std::make_unique<ErrorCounter>();
+        counter->counter = &errors_family_.Add({{"type", type}, {"ares_status", status}});
+    }
+    return *counter;
 }
 
 void DNSMetrics::recordRetry(const std::string &hostname, uint32_t attempt) {
-    total_retries_.Increment();
+    retry_count_.add();
     std::lock_guard<std::mutex> lock(retry_mutex_);
-    retry_attempts_[hostname].push_back(attempt);
-
-    // 保持最近100次重试记录
-    constexpr size_t MAX_RETRY_HISTORY = 100;
-    if (retry_attempts_[hostname].size() > MAX_RETRY_HISTORY) {
-        retry_attempts_[hostname].erase(retry_attempts_[hostname].begin(),
-                                        retry_attempts_[hostname].begin() + (retry_attempts_[hostname].size() - MAX_RETRY_HISTORY));
+    if (retry_history_.size() < MAX_RETRY_HISTORY) {
+        retry_history_.push_back({hostname, attempt});
+    } else {
+        auto &slot = retry_history_[retry_next_];
+        slot.hostname.assign(hostname);
+        slot.attempt = attempt;
     }
+    retry_next_ = (retry_next_ + 1) % MAX_RETRY_HISTORY;
 }
 
 DNSMetrics::Stats DNSMetrics::getStats() const {
     Stats stats;
-    stats.total_queries = static_cast<int64_t>(total_queries_.Value());
-    stats.successful_queries = static_cast<int64_t>(successful_queries_.Value());
-    stats.failed_queries = static_cast<int64_t>(failed_queries_.Value());
-    stats.cache_hits = static_cast<int64_t>(cache_hits_.Value());
-    stats.cache_misses = static_cast<int64_t>(cache_misses_.Value());
+    stats.successful_queries = successful_count_.value();
+    stats.failed_queries = failed_count_.value();
+    stats.total_queries = stats.successful_queries + stats.failed_queries;
+    stats.cache_hits = cache_hit_count_.value();
+    stats.cache_misses = cache_miss_count_.value();
+    stats.negative_cache_hits = negative_hit_count_.value();
+    stats.prefetches = prefetch_count_.value();
+    stats.coalesced_queries = coalesced_count_.value();
 
-    const double total = stats.cache_hits + stats.cache_misses;
-    stats.cache_hit_rate = total > 0 ? static_cast<int64_t>(stats.cache_hits / total) : 0;
+    const double total = static_cast<double>(stats.cache_hits + stats.cache_misses);
+    stats.cache_hit_rate = total > 0 ? static_cast<double>(stats.cache_hits) / total : 0;
 
-    // 复制错误计数
+    // 查询耗时
+    DNSLatencyHistogram::Buckets buckets{};
+    query_latency_.snapshot(buckets);
+    uint64_t samples = 0;
+    for (const auto n: buckets) {
+        samples += n;
+    }
+    if (samples > 0) {
+        stats.avg_query_time_ms = static_cast<double>(query_latency_.sumMicros()) / static_cast<double>(samples) / 1000.0;
+        stats.p50_query_time_ms = static_cast<double>(DNSLatencyHistogram::percentile(buckets, 0.5).count()) / 1000.0;
+        stats.p99_query_time_ms = static_cast<double>(DNSLatencyHistogram::percentile(buckets, 0.99).count()) / 1000.0;
+    }
+
+    // 错误计数按类型汇总
     {
-        std::lock_guard<std::mutex> lock(error_mutex_);
-        stats.error_counts = error_counts_;
+        std::shared_lock<std::shared_mutex> lock(error_mutex_);
+        for (const auto &[type, by_status]: error_counters_) {
+            uint64_t total_errors = 0;
+            for (const auto &[status, counter]: by_status) {
+                total_errors += counter->count.load(std::memory_order_relaxed) - counter->reset_base;
+            }
+            if (total_errors > 0) {
+                stats.error_counts[type] = total_errors;
+            }
+        }
     }
-    // 计算服务器延迟
+    // 服务器延迟与应答结果
     {
-        std::lock_guard<std::mutex> lock(latency_mutex_);
-        for (const auto &[server, latencies]: server_latencies_) {
-            if (!latencies.empty()) {
-                double avg_latency = std::accumulate(
-                                             latencies.begin(), latencies.end(), 0.0) /
-                                     latencies.size();
-                stats.server_latencies[server] = avg_latency;
+        std::shared_lock<std::shared_mutex> lock(latency_mutex_);
+        for (const auto &[server, metrics]: server_metrics_) {
+            const uint64_t count = metrics->latency.count() - metrics->reset_latency_count;
+            if (count > 0) {
+                const uint64_t sum_us = metrics->latency.sumMicros() - metrics->reset_latency_sum_us;
+                stats.server_latencies[server] = static_cast<double>(sum_us) / static_cast<double>(count) / 1000.0;
             }
+            stats.server_successes[server] = metrics->successes.load(std::memory_order_relaxed) - metrics->reset_successes;
+            stats.server_failures[server] = metrics->failures.load(std::memory_order_relaxed) - metrics->reset_failures;
         }
     }
 
-    // 统计重试信息
+    // 对冲
+    stats.hedged_queries = hedge_count_.value();
+    stats.hedge_wins = hedge_win_count_.value();
+    if (stats.total_queries > 0) {
+        stats.hedge_rate = static_cast<double>(stats.hedged_queries) / static_cast<double>(stats.total_queries);
+    }
+    if (stats.hedged_queries > 0) {
+        stats.hedge_win_rate = static_cast<double>(stats.hedge_wins) / static_cast<double>(stats.hedged_queries);
+    }
+
+    // 预热与就绪
+    stats.warmup_targets = warmup_target_count_.load(std::memory_order_relaxed);
+    stats.warmup_completed = warmup_completed_count_.load(std::memory_order_relaxed);
+    stats.warmup_failed = warmup_failed_count_.load(std::memory_order_relaxed);
+    stats.ready = ready_.load(std::memory_order_relaxed);
+
+    // 统计重试信息，按时间顺序展开环形缓冲区
+    stats.total_retries = retry_count_.value();
     {
         std::lock_guard<std::mutex> lock(retry_mutex_);
-        stats.total_retries = static_cast<int64_t>(total_retries_.Value());
-        stats.retry_attempts = retry_attempts_;
+        const size_t size = retry_history_.size();
+        const size_t first = size < MAX_RETRY_HISTORY ? 0 : retry_next_;
+        for (size_t i = 0; i < size; ++i) {
+            const auto &event = retry_history_[(first + i) % size];
+            stats.retry_attempts[event.hostname].push_back(event.attempt);
+        }
     }
     return stats;
 }
 
 void DNSMetrics::resetStats() {
-    std::lock_guard<std::mutex> error_lock(error_mutex_);
-    std::lock_guard<std::mutex> latency_lock(latency_mutex_);
-    error_counts_.clear();
-    server_latencies_.clear();
+    // Prometheus计数器是单调的，这里只重置getStats()的基线
+    {
+        std::unique_lock<std::shared_mutex> lock(error_mutex_);
+        for (auto &[type, by_status]: error_counters_) {
+            for (auto &[status, counter]: by_status) {
+                counter->reset_base = counter->count.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock(latency_mutex_);
+        for (auto &[server, metrics]: server_metrics_) {
+            metrics->reset_successes = metrics->successes.load(std::memory_order_relaxed);
+            metrics->reset_failures = metrics->failures.load(std::memory_order_relaxed);
+            metrics->reset_latency_count = metrics->latency.count();
+            metrics->reset_latency_sum_us = metrics->latency.sumMicros();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(retry_mutex_);
+        retry_history_.clear();
+        retry_next_ = 0;
+    }
+}
+
+std::chrono::microseconds DNSMetrics::queryLatencyPercentile(double q) const {
+    return query_latency_.percentile(q);
 }
 
-void DNSMetrics::updateCacheHitRate() {
-    double total = cache_hits_.Value() + cache_misses_.Value();
+std::chrono::microseconds DNSMetrics::serverLatencyPercentile(const std::string &server, double q) const {
+    std::shared_lock<std::shared_mutex> lock(latency_mutex_);
+    const auto it = server_metrics_.find(server);
+    if (it == server_metrics_.end()) {
+        return std::chrono::microseconds{0};
+    }
+    return DNSLatencyHistogram::percentile(it->second->published_buckets, q);
+}
+
+void DNSMetrics::publish() {
+    std::vector<std::string> alerts;
+    {
+        std::lock_guard<std::mutex> lock(publish_mutex_);
+        Published current;
+        current.successful = successful_count_.value();
+        current.failed = failed_count_.value();
+        current.cache_hits = cache_hit_count_.value();
+        current.cache_misses = cache_miss_count_.value();
+        current.negative_hits = negative_hit_count_.value();
+        current.prefetches = prefetch_count_.value();
+        current.coalesced = coalesced_count_.value();
+        current.retries = retry_count_.value();
+        current.hedges = hedge_count_.value();
+        current.hedge_wins = hedge_win_count_.value();
+        current.latency_sum_us = query_latency_.sumMicros();
+        query_latency_.snapshot(current.latency_buckets);
+
+        bool alerting = false;
+        double error_rate_threshold{};
+        std::chrono::milliseconds latency_threshold{};
+        {
+            std::lock_guard<std::mutex> alert_lock(alert_mutex_);
+            alerting = thresholds_set_ && !alert_callbacks_.empty();
+            error_rate_threshold = error_rate_threshold_;
+            latency_threshold = latency_threshold_;
+        }
+
+        syncPrometheus(current);
+        if (alerting) {
+            evaluateAlerts(current, error_rate_threshold, latency_threshold, alerts);
+        }
+        syncServers(alerting, latency_threshold, alerts);
+        syncErrors();
+        published_ = current;
+    }
+    if (alerts.empty()) {
+        return;
+    }
+
+    // 回调在锁外执行，允许回调中注册或清除回调
+    std::vector<AlertCallback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(alert_mutex_);
+        callbacks = alert_callbacks_;
+    }
+    for (const auto &alert: alerts) {
+        for (const auto &callback: callbacks) {
+            try {
+                callback(alert);
+            } catch (const std::exception &e) {
+                std::cerr << "Alert callback failed: " << e.what() << std::endl;
+            }
+        }
+    }
+}
+
+void DNSMetrics::setPublishInterval(std::chrono::milliseconds interval) {
+    {
+        std::lock_guard<std::mutex> lock(ticker_mutex_);
+        publish_interval_ = std::max(interval, std::chrono::milliseconds{1});
+    }
+    ticker_cv_.notify_all();
+}
+
+void DNSMetrics::runTicker() {
+    std::unique_lock<std::mutex> lock(ticker_mutex_);
+    while (!ticker_stop_) {
+        auto interval = publish_interval_;
+        if (ticker_cv_.wait_for(lock, interval, [&] { return ticker_stop_ || publish_interval_ != interval; })) {
+            continue;
+        }
+        lock.unlock();
+        publish();
+        lock.lock();
+    }
+}
+
+void DNSMetrics::syncPrometheus(const Published &current) {
+    const Published &previous = published_;
+    const uint64_t successful = delta(current.successful, previous.successful);
+    const uint64_t failed = delta(current.failed, previous.failed);
+    total_queries_.Increment(static_cast<double>(successful + failed));
+    successful_queries_.Increment(static_cast<double>(successful));
+    failed_queries_.Increment(static_cast<double>(failed));
+    cache_hits_.Increment(static_cast<double>(delta(current.cache_hits, previous.cache_hits)));
+    cache_misses_.Increment(static_cast<double>(delta(current.cache_misses, previous.cache_misses)));
+    negative_cache_hits_.Increment(static_cast<double>(delta(current.negative_hits, previous.negative_hits)));
+    prefetches_.Increment(static_cast<double>(delta(current.prefetches, previous.prefetches)));
+    coalesced_queries_.Increment(static_cast<double>(delta(current.coalesced, previous.coalesced)));
+    total_retries_.Increment(static_cast<double>(delta(current.retries, previous.retries)));
+    hedged_queries_.Increment(static_cast<double>(delta(current.hedges, previous.hedges)));
+    hedge_wins_.Increment(static_cast<double>(delta(current.hedge_wins, previous.hedge_wins)));
+
+    const double lookups = static_cast<double>(current.cache_hits + current.cache_misses);
+    if (lookups > 0) {
+        cache_hit_rate_.Set(static_cast<double>(current.cache_hits) / lookups);
+    }
+
+    observeDelta(query_duration_, current.latency_buckets, previous.latency_buckets,
+                 delta(current.latency_sum_us, previous.latency_sum_us));
+}
+
+void DNSMetrics::syncServers(bool check_latency, std::chrono::milliseconds latency_threshold,
+                             std::vector<std::string> &alerts) {
+    // 独占锁：published_buckets同时被serverLatencyPercentile()读取
+    std::unique_lock<std::shared_mutex> lock(latency_mutex_);
+    for (auto &[server, metrics]: server_metrics_) {
+        const uint64_t successes = metrics->successes.load(std::memory_order_relaxed);
+        const uint64_t failures = metrics->failures.load(std::memory_order_relaxed);
+        metrics->success_counter->Increment(static_cast<double>(successes - metrics->published_successes));
+        metrics->failure_counter->Increment(static_cast<double>(failures - metrics->published_failures));
+        metrics->published_successes = successes;
+        metrics->published_failures = failures;
+
+        DNSLatencyHistogram::Buckets buckets{};
+        metrics->latency.snapshot(buckets);
+        const uint64_t sum_us = metrics->latency.sumMicros();
+        uint64_t count = 0;
+        for (size_t i = 0; i < DNSLatencyHistogram::BUCKET_COUNT; ++i) {
+            count += buckets[i] - metrics->published_buckets[i];
+        }
+        const uint64_t window_sum_us = sum_us - metrics->published_latency_sum_us;
+        observeDelta(*metrics->latency_histogram, buckets, metrics->published_buckets, window_sum_us);
+        metrics->published_buckets = buckets;
+        metrics->published_latency_sum_us = sum_us;
+
+        // 服务器延迟告警：本窗口的平均值
+        if (check_latency && count > 0) {
+            const double avg_ms = static_cast<double>(window_sum_us) / static_cast<double>(count) / 1000.0;
+            if (avg_ms > static_cast<double>(latency_threshold.count())) {
+                alerts.push_back("High server latency detected for " + server + ": " + formatMs(avg_ms));
+            }
+        }
+    }
+}
+
+void DNSMetrics::syncErrors() {
+    std::shared_lock<std::shared_mutex> lock(error_mutex_);
+    for (auto &[type, by_status]: error_counters_) {
+        for (auto &[status, counter]: by_status) {
+            const uint64_t count = counter->count.load(std::memory_order_relaxed);
+            counter->counter->Increment(static_cast<double>(count - counter->published));
+            counter->published = count;
+        }
+    }
+}
+
+void DNSMetrics::evaluateAlerts(const Published &current, double error_rate_threshold,
+                                std::chrono::milliseconds latency_threshold, std::vector<std::string> &alerts) const {
+    const Published &previous = published_;
+
+    // 错误率：只看本窗口内完成的查询
+    const uint64_t failed = delta(current.failed, previous.failed);
+    const uint64_t total = delta(current.successful, previous.successful) + failed;
     if (total > 0) {
-        cache_hit_rate_.Set(cache_hits_.Value() / total);
+        const double error_rate = static_cast<double>(failed) / static_cast<double>(total);
+        if (error_rate > error_rate_threshold) {
+            std::ostringstream oss;
+            oss << "High error rate detected: " << std::fixed << std::setprecision(1) << error_rate * 100
+                << "% of " << total << " queries";
+            alerts.push_back(oss.str());
+        }
+    }
+
+    // 延迟：本窗口的p99
+    DNSLatencyHistogram::Buckets window{};
+    for (size_t i = 0; i < DNSLatencyHistogram::BUCKET_COUNT; ++i) {
+        window[i] = delta(current.latency_buckets[i], previous.latency_buckets[i]);
+    }
+    const auto p99 = DNSLatencyHistogram::percentile(window, 0.99);
+    if (p99 > latency_threshold) {
+        alerts.push_back("High latency detected: p99 " + formatMs(static_cast<double>(p99.count()) / 1000.0) +
+                         " over " + std::to_string(total) + " queries");
     }
 }
 
@@ -200,12 +587,13 @@ void DNSMetrics::setAlertThresholds(double error_rate_threshold, std::chrono::mi
     if (error_rate_threshold < 0.0 || error_rate_threshold > 1.0) {
         throw std::invalid_argument("Error rate threshold must be between 0 and 1");
     }
-    error_rate_threshold_ = error_rate_threshold;
-
     if (latency_threshold.count() <= 0) {
         throw std::invalid_argument("Latency threshold must be positive");
     }
+    std::lock_guard<std::mutex> lock(alert_mutex_);
+    error_rate_threshold_ = error_rate_threshold;
     latency_threshold_ = latency_threshold;
+    thresholds_set_ = true;
 }
 
 void DNSMetrics::registerAlertCallback(AlertCallback callback) {
@@ -237,10 +625,20 @@ void DNSMetrics::exportToFile(const std::string &filename) const {
         j["failed_queries"] = stats.failed_queries;
         j["cache_hits"] = stats.cache_hits;
         j["cache_misses"] = stats.cache_misses;
+        j["negative_cache_hits"] = stats.negative_cache_hits;
+        j["prefetches"] = stats.prefetches;
+        j["coalesced_queries"] = stats.coalesced_queries;
         j["cache_hit_rate"] = stats.cache_hit_rate;
         j["avg_query_time_ms"] = stats.avg_query_time_ms;
         j["total_retries"] = stats.total_retries;
-
+        j["hedged_queries"] = stats.hedged_queries;
+        j["hedge_wins"] = stats.hedge_wins;
+        j["warmup_targets"] = stats.warmup_targets;
+        j["warmup_completed"] = stats.warmup_completed;
+        j["warmup_failed"] = stats.warmup_failed;
+        j["ready"] = stats.ready;
+        j["server_successes"] = stats.server_successes;
+        j["server_failures"] = stats.server_failures;
         // 服务器延迟
         j["server_latencies"] = stats.server_latencies;
 
@@ -258,4 +656,61 @@ void DNSMetrics::exportToFile(const std::string &filename) const {
     } catch (const std::exception &e) {
         std::cerr << "Failed to export metrics: " << e.what() << std::endl;
     }
-}
\ No newline at end of file
+}
+
+const char *DNSMetrics::aresStatusName(int status) {
+    switch (status) {
+        case ARES_SUCCESS:
+            return "SUCCESS";
+        case ARES_ENODATA:
+            return "ENODATA";
+        case ARES_EFORMERR:
+            return "EFORMERR";
+        case ARES_ESERVFAIL:
+            return "ESERVFAIL";
+        case ARES_ENOTFOUND:
+            return "ENOTFOUND";
+        case ARES_ENOTIMP:
+            return "ENOTIMP";
+        case ARES_EREFUSED:
+            return "EREFUSED";
+        case ARES_EBADQUERY:
+            return "EBADQUERY";
+        case ARES_EBADNAME:
+            return "EBADNAME";
+        case ARES_EBADFAMILY:
+            return "EBADFAMILY";
+        case ARES_EBADRESP:
+            return "EBADRESP";
+        case ARES_ECONNREFUSED:
+            return "ECONNREFUSED";
+        case ARES_ETIMEOUT:
+            return "ETIMEOUT";
+        case ARES_EOF:
+            return "EOF";
+        case ARES_EFILE:
+            return "EFILE";
+        case ARES_ENOMEM:
+            return "ENOMEM";
+        case ARES_EDESTRUCTION:
+            return "EDESTRUCTION";
+        case ARES_EBADSTR:
+            return "EBADSTR";
+        case ARES_EBADFLAGS:
+            return "EBADFLAGS";
+        case ARES_ENONAME:
+            return "ENONAME";
+        case ARES_EBADHINTS:
+            return "EBADHINTS";
+        case ARES_ENOTINITIALIZED:
+            return "ENOTINITIALIZED";
+        case ARES_ECANCELLED:
+            return "ECANCELLED";
+        case ARES_ESERVICE:
+            return "ESERVICE";
+        case ARES_ENOSERVER:
+            return "ENOSERVER";
+        default:
+            return "UNKNOWN";
+    }
+}
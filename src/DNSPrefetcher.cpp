@@ -0,0 +1,124 @@
+#include "DNSPrefetcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+DNSPrefetcher::DNSPrefetcher(RefreshFn refresh_fn, uint32_t max_per_second, size_t max_pending)
+    : refresh_fn_(std::move(refresh_fn)), max_pending_(std::max<size_t>(1, max_pending)) {
+    setRate(max_per_second);
+}
+
+DNSPrefetcher::~DNSPrefetcher() {
+    stop();
+}
+
+void DNSPrefetcher::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    tokens_ = 1.0;
+    last_refill_ = std::chrono::steady_clock::now();
+    thread_ = std::thread(&DNSPrefetcher::run, this);
+}
+
+void DNSPrefetcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool DNSPrefetcher::enqueue(const std::string &name, uint32_t hits) {
+    // 提交的是缓存键，原样驻留（AAAA记录的键带有"/AAAA"后缀）
+    const auto hostname = DNSHostname::verbatim(name);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (const auto it = index_.find(hostname); it != index_.end()) {
+            // 已在队列中，只提升优先级
+            if (hits > it->second->first) {
+                queue_.erase(it->second);
+                it->second = queue_.emplace(hits, hostname);
+            }
+            return true;
+        }
+
+        if (queue_.size() >= max_pending_) {
+            auto coldest = std::prev(queue_.end());
+            if (coldest->first >= hits) {
+                ++dropped_;
+                return false;
+            }
+            index_.erase(coldest->second);
+            queue_.erase(coldest);
+            ++dropped_;
+        }
+        index_.emplace(hostname, queue_.emplace(hits, hostname));
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void DNSPrefetcher::setRate(uint32_t max_per_second) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rate_ = std::max<uint32_t>(1, max_per_second);
+}
+
+size_t DNSPrefetcher::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+uint64_t DNSPrefetcher::dispatched() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dispatched_;
+}
+
+uint64_t DNSPrefetcher::dropped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dropped_;
+}
+
+void DNSPrefetcher::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        cv_.wait(lock, [this] { return !running_ || !queue_.empty(); });
+        if (!running_) {
+            break;
+        }
+
+        // 补充令牌，桶容量为1秒的速率
+        const auto now = std::chrono::steady_clock::now();
+        tokens_ = std::min(rate_, tokens_ + std::chrono::duration<double>(now - last_refill_).count() * rate_);
+        last_refill_ = now;
+        if (tokens_ < 1.0) {
+            const auto wait = std::chrono::duration<double>((1.0 - tokens_) / rate_);
+            cv_.wait_for(lock, wait, [this] { return !running_; });
+            continue;
+        }
+        tokens_ -= 1.0;
+
+        // 取出命中次数最多的请求
+        auto hottest = queue_.begin();
+        const DNSHostname hostname = hottest->second;
+        index_.erase(hostname);
+        queue_.erase(hottest);
+        ++dispatched_;
+
+        lock.unlock();
+        try {
+            refresh_fn_(hostname.str());
+        } catch (const std::exception &e) {
+            std::cerr << "Error prefetching " << hostname.str() << ": " << e.what() << std::endl;
+        }
+        lock.lock();
+    }
+}
@@ -1,406 +1,1717 @@
-
-#include "DNSResolver.h"
-#include "DNSCachePersistor.h"
-#include "DNSConfigValidator.h"
-#include "DNSEvent.h"
-
-#include <csignal>
-#include <iostream>
-
-DNSResolver::DNSResolver() {
-    int status = ares_library_init(ARES_LIB_INIT_ALL);
-    if (status != ARES_SUCCESS) {
-        throw std::runtime_error("c-ares library initialization failed");
-    }
-
-    // 初始化指标收集器
-    metrics_ = std::make_shared<DNSMetrics>();
-}
-
-DNSResolver::~DNSResolver() {
-    if (initialized_) {
-        // 保存缓存（如果配置了持久化）
-        if (config_ && config_->cache().persistent) {
-            [[maybe_unused]] auto ret = save_cache(config_->cache().cache_file);
-        }
-
-        // 清理资源
-        ares_destroy(channel_);
-        initialized_ = false;
-    }
-    ares_library_cleanup();
-}
-
-bool DNSResolver::init(const std::vector<std::string> &dns_servers, std::chrono::seconds cache_ttl) {
-    ares_options options{};
-    int optmask = 0;
-
-    // 设置c-ares选项
-    memset(&options, 0, sizeof(options));
-    options.flags = ARES_FLAG_NOCHECKRESP;// 不检查响应的id
-    options.timeout = 2000;               // 2秒超时
-    options.tries = 3;                    // 重试3次
-    options.ndots = 1;                    // 域名中的点数阈值
-    options.sock_state_cb = socket_callback;
-    options.sock_state_cb_data = this;
-    optmask = ARES_OPT_FLAGS | ARES_OPT_TIMEOUT | ARES_OPT_TRIES | ARES_OPT_NDOTS | ARES_OPT_SOCK_STATE_CB;
-
-    int status = ares_init_options(&channel_, &options, optmask);
-    if (status != ARES_SUCCESS) {
-        std::cerr << "Failed to initialize c-ares: " << ares_strerror(status) << std::endl;
-        return false;
-    }
-
-    if (!dns_servers.empty()) {
-        dns_server_list_ = dns_servers;
-        std::ostringstream servers;
-        servers << dns_servers[0];// 第一个元素不加逗号
-
-        // 后续元素前加逗号
-        for (size_t i = 1; i < dns_servers.size(); ++i) {
-            servers << "," << dns_servers[i];
-        }
-
-        // 设置DNS服务器
-        status = ares_set_servers_ports_csv(channel_, servers.str().c_str());
-
-        if (status != ARES_SUCCESS) {
-            std::cerr << "Failed to set DNS servers: " << ares_strerror(status) << std::endl;
-            return false;
-        }
-    }
-
-    cache_ = std::make_shared<DNSCache>(cache_ttl);
-    initialized_ = true;
-    return true;
-}
-
-bool DNSResolver::loadConfig(const DNSResolverConfig &config) {
-    try {
-        // 验证配置
-        DNSConfigValidator::validate(config);
-        // 获取启用的DNS服务器
-        std::vector<std::string> active_servers;
-        for (const auto &server: config.servers()) {
-            if (server.enabled) {
-                active_servers.push_back(server.address);
-            }
-        }
-        // 重新初始化
-        if (!init(active_servers, config.cache().ttl)) {
-            return false;
-        }
-        // 配置指标收集
-        if (config.metrics().enabled) {
-            metrics_->startPrometheusExporter(config.metrics().prometheus_address);
-        }
-        // 加载持久化缓存
-        if (config.cache().enabled && config.cache().persistent) {
-            load_cache(config.cache().cache_file);
-        }
-        config_ = std::make_shared<DNSResolverConfig>(config);
-    } catch (const ConfigValidationError &e) {
-        std::cerr << "Configuration validation error: " << e.what() << std::endl;
-        return false;
-    } catch (const std::exception &e) {
-        std::cerr << "Error loading configuration: " << e.what() << std::endl;
-        return false;
-    }
-
-    return true;
-}
-
-bool DNSResolver::loadConfig(const std::string &config_file) {
-    try {
-        auto &config = DNSResolverConfig::getInstance();
-        if (!config.loadFromFile(config_file)) {
-            return false;
-        }
-        return loadConfig(config);
-    } catch (const std::exception &e) {
-        std::cerr << "Error loading configuration file: " << e.what() << std::endl;
-        return false;
-    }
-}
-
-bool DNSResolver::reloadConfig() {
-    if (!config_) {
-        return false;
-    }
-
-    // 保存当前缓存
-    if (config_->cache().enabled && config_->cache().persistent) {
-        [[maybe_unused]] auto ret = save_cache(config_->cache().cache_file);
-    }
-
-    return loadConfig(config_->metrics().metrics_file);
-}
-
-std::future<DNSResolver::ResolveResult> DNSResolver::resolve(const std::string &hostname) {
-
-    if (!initialized_) {
-        std::promise<ResolveResult> promise;
-        promise.set_value({ARES_ENOTINITIALIZED, hostname, {}});
-        return promise.get_future();
-    }
-
-    // 检查缓存
-    std::vector<std::string> cached_ips;
-    if (cache_->get(hostname, cached_ips)) {
-        metrics_->recordCacheHit(hostname);
-        std::promise<ResolveResult> promise;
-        ResolveResult result;
-        result.hostname = hostname;
-        result.ip_addresses = cached_ips;
-        result.status = ARES_SUCCESS;
-        result.resolution_time = std::chrono::milliseconds(0);
-        promise.set_value(std::move(result));
-        return promise.get_future();
-    }
-
-    metrics_->recordCacheMiss(hostname);
-
-    auto context = new QueryContext{
-            hostname,
-            std::promise<ResolveResult>(),
-            std::chrono::steady_clock::now(),
-            std::vector<char>(512),
-            shared_from_this()};
-
-    struct ares_addrinfo_hints hints = {};
-    hints.ai_family = config_ && config_->ipv6_enabled() ? AF_UNSPEC : AF_INET;
-    hints.ai_flags = ARES_AI_CANONNAME;
-
-    ares_getaddrinfo(channel_, hostname.c_str(), nullptr, &hints, addrinfo_callback, context);
-
-    return context->promise.get_future();
-}
-
-std::vector<std::future<DNSResolver::ResolveResult>> DNSResolver::resolve_batch(const std::vector<std::string> &hostnames) {
-
-    std::vector<std::future<ResolveResult>> results;
-    results.reserve(hostnames.size());
-    // 检查并应用并发限制
-    size_t max_concurrent = config_ ? config_->max_concurrent_queries() : 100;
-    size_t batch_size = std::min(hostnames.size(), max_concurrent);
-    std::vector<std::string> current_batch;
-    current_batch.reserve(batch_size);
-    for (const auto &hostname: hostnames) {
-        current_batch.push_back(hostname);
-        if (current_batch.size() >= batch_size) {
-            // 处理当前批次
-            for (const auto &h: current_batch) {
-                results.push_back(resolve(h));
-            }
-            // 等待当前批次完成
-            wait_for_completion();
-            current_batch.clear();
-        }
-    }
-
-    // 处理剩余的主机名
-    if (!current_batch.empty()) {
-        for (const auto &h: current_batch) {
-            results.push_back(resolve(h));
-        }
-        wait_for_completion();
-    }
-
-    return results;
-}
-
-std::future<DNSResolver::ResolveResult> DNSResolver::refresh(const std::string &hostname) {
-    if (cache_) {
-        cache_->remove(hostname);
-    }
-    return resolve(hostname);
-}
-
-void DNSResolver::clear_cache() {
-    if (cache_) {
-        cache_->clear();
-    }
-}
-
-bool DNSResolver::save_cache(const std::string &filename) const {
-    if (!cache_) {
-        return false;
-    }
-    return DNSCachePersistor::save(*cache_, filename);
-}
-
-bool DNSResolver::load_cache(const std::string &filename) {
-    if (!cache_) {
-        return false;
-    }
-    return DNSCachePersistor::load(*cache_, filename);
-}
-
-std::shared_ptr<DNSCache> DNSResolver::getCache() const {
-    return cache_;
-}
-
-std::shared_ptr<DNSMetrics> DNSResolver::getMetrics() const {
-    return metrics_;
-}
-
-DNSMetrics::Stats DNSResolver::getStats() const {
-    if (metrics_) {
-        return metrics_->getStats();
-    }
-    return {};
-}
-
-void DNSResolver::socket_callback(void *data, ares_socket_t socket_fd, int readable, int writable) {
-    // auto *resolver = static_cast<DNSResolver *>(data);
-    sockaddr_storage addr{};
-    socklen_t addr_len = sizeof(addr);
-    char ipstr[INET6_ADDRSTRLEN] = {0};
-    // 获取远端地址
-    if (getpeername(socket_fd, reinterpret_cast<struct sockaddr *>(&addr), &addr_len) == 0) {
-        void *src = nullptr;
-        if (addr.ss_family == AF_INET) {
-            src = &(reinterpret_cast<struct sockaddr_in *>(&addr)->sin_addr);
-        } else if (addr.ss_family == AF_INET6) {
-            src = &(reinterpret_cast<struct sockaddr_in6 *>(&addr)->sin6_addr);
-        }
-
-        if (src && inet_ntop(addr.ss_family, src, ipstr, sizeof(ipstr))) {
-            // std::lock_guard<std::mutex> lock(resolver->mutex_);
-            // resolver->socket_server_map_[socket_fd] = ipstr;
-        }
-    } else {
-        std::cerr << "getpeername" << std::endl;
-    }
-
-    if (!readable && !writable) {
-        // std::lock_guard<std::mutex> lock(resolver->mutex_);
-        // resolver->socket_server_map_.erase(socket_fd);
-    }
-}
-
-void DNSResolver::addrinfo_callback(void *arg, int status, int timeouts, struct ares_addrinfo *result) {
-    auto *context = static_cast<QueryContext *>(arg);
-    context->resolver->process_result(context, status, result);
-    if (result) {
-        ares_freeaddrinfo(result);
-    }
-    delete context;
-}
-
-void DNSResolver::process_result(QueryContext *context, int status, const ares_addrinfo *result) {
-    auto end_time = std::chrono::steady_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - context->start_time);
-
-    ResolveResult resolve_result;
-    resolve_result.hostname = context->hostname;
-    resolve_result.status = status;
-    resolve_result.resolution_time = duration;
-
-    std::vector<std::string> old_addresses;
-    cache_->get(context->hostname, old_addresses);
-
-    if (status == ARES_SUCCESS && result) {
-        for (struct ares_addrinfo_node *node = result->nodes;
-             node != nullptr;
-             node = node->ai_next) {
-
-            char ip[INET6_ADDRSTRLEN];
-            const void *addr;
-
-            if (node->ai_family == AF_INET) {
-                const auto *addr_in = reinterpret_cast<struct sockaddr_in *>(node->ai_addr);
-                addr = &(addr_in->sin_addr);
-            } else if (node->ai_family == AF_INET6) {
-                const auto *addr_in6 = reinterpret_cast<struct sockaddr_in6 *>(node->ai_addr);
-                addr = &(addr_in6->sin6_addr);
-            } else {
-                continue;
-            }
-
-            if (inet_ntop(node->ai_family, addr, ip, sizeof(ip))) {
-                resolve_result.ip_addresses.emplace_back(ip);
-            }
-        }
-
-        // 更新缓存
-        if (!resolve_result.ip_addresses.empty()) {
-            cache_->update(context->hostname, resolve_result.ip_addresses);
-
-            // 检查地址是否发生变化
-            if (old_addresses != resolve_result.ip_addresses) {
-                notifyAddressChange(context->hostname, old_addresses, resolve_result.ip_addresses, "query");
-            }
-        }
-    } else {
-        // 处理错误
-        metrics_->recordError("resolution_failure", std::string(ares_strerror(status)));
-        // 实施重试策略
-        if (config_ && status != ARES_ENODATA && status != ARES_ENOTFOUND) {
-            static uint32_t retry_count = 0;
-            if (retry_count < config_->retry().max_attempts) {
-                retry_count++;
-                metrics_->recordRetry(context->hostname, retry_count);
-                // 使用指数退避
-                auto delay = config_->retry().base_delay_ms * (1 << (retry_count - 1));
-                delay = std::min(delay, config_->retry().max_delay_ms);
-                std::this_thread::sleep_for(std::chrono::milliseconds(delay));
-
-                // 重新发起查询
-                ares_getaddrinfo(channel_, context->hostname.c_str(),
-                                 nullptr, nullptr, addrinfo_callback, context);
-                return;// 不要设置promise结果
-            }
-            retry_count = 0;// 重置重试计数
-        }
-    }
-
-    metrics_->recordQuery(context->hostname, duration, status == ARES_SUCCESS);
-
-    context->promise.set_value(std::move(resolve_result));
-}
-
-void DNSResolver::notifyAddressChange(const std::string &hostname, const std::vector<std::string> &old_addresses,
-                                      const std::vector<std::string> &new_addresses, const std::string &source) {
-
-    DNSAddressEvent event;
-    event.hostname = hostname;
-    event.old_addresses = old_addresses;
-    event.new_addresses = new_addresses;
-    event.timestamp = std::chrono::system_clock::now();
-    event.source = source;
-    if (config_) {
-        event.ttl = config_->cache().ttl.count();
-    }
-    event.record_type = "A";       // 或 "AAAA" 取决于地址类型
-    event.is_authoritative = false;// 需要从DNS响应中获取
-
-    DNSEventManager::getInstance().notifyAddressChanged(event);
-}
-
-void DNSResolver::wait_for_completion() {
-    while (true) {
-        fd_set readers, writers;
-        int nfds = 0;
-        timeval tv{};
-
-        FD_ZERO(&readers);
-        FD_ZERO(&writers);
-
-        tv.tv_sec = 0;
-        tv.tv_usec = 100000;// 100ms timeout
-
-        ares_fds(channel_, &readers, &writers);
-        nfds = ares_fds(channel_, &readers, &writers);
-
-        if (nfds == 0) {
-            break;
-        }
-
-        if (select(nfds, &readers, &writers, nullptr, &tv) < 0) {
-            break;
-        }
-
-        ares_process(channel_, &readers, &writers);
-    }
-}
\ No newline at end of file
+
+#include "DNSResolver.h"
+#include "DNSBatchWindow.h"
+#include "DNSCachePersistor.h"
+#include "DNSCacheWarmer.h"
+#include "DNSConfigValidator.h"
+#include "DNSConfigVersion.h"
+#include "DNSEvent.h"
+#include "DNSHostname.h"
+
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <unordered_set>
+
+DNSResolver::DNSResolver() {
+    int status = ares_library_init(ARES_LIB_INIT_ALL);
+    if (status != ARES_SUCCESS) {
+        throw std::runtime_error("c-ares library initialization failed");
+    }
+
+    // 初始化指标收集器
+    metrics_ = std::make_shared<DNSMetrics>();
+    event_loop_ = std::make_unique<DNSEventLoop>();
+}
+
+DNSResolver::~DNSResolver() {
+    if (initialized_) {
+        // 保存缓存（如果配置了持久化）
+        const auto config = config_.load();
+        if (owns_cache_ && !journal_ && config && config->cache().persistent) {
+            [[maybe_unused]] auto ret = save_cache(config->cache().cache_file);
+        }
+
+        // 清理资源
+        shutdown_channel();
+    }
+    ares_library_cleanup();
+}
+
+void DNSResolver::shutdown() {
+    std::lock_guard<std::mutex> lock(reload_mutex_);
+    shutdown_channel();
+}
+
+void DNSResolver::shutdown_channel() {
+    if (!initialized_) {
+        return;
+    }
+    // 先停止预取与I/O线程，再销毁channel，避免与之并发访问
+    if (prefetcher_) {
+        prefetcher_->stop();
+        prefetcher_.reset();
+    }
+    close_channels();
+    // 查询都已结束，最后一次检查点包含全部写入
+    if (journal_) {
+        journal_->stop();
+        journal_.reset();
+    }
+    initialized_ = false;
+}
+
+void DNSResolver::close_channels(Upstreams replacement, const std::vector<DNSUpstreamSelector::Upstream> &selection) {
+    event_loop_->stop();
+    const bool rebuild = !replacement.empty();
+    const auto retired = swap_channels(std::move(replacement), selection);
+    for (const auto &upstream: retired) {
+        event_loop_->removeChannel(upstream->channel);
+    }
+    // 在途查询由ares_destroy以ARES_EDESTRUCTION结束。重建时回调把查询转发到新channel，因此在锁外销毁
+    migrating_ = rebuild;
+    for (const auto &upstream: retired) {
+        ares_destroy(upstream->channel);
+    }
+    migrating_ = false;
+    if (rebuild) {
+        // 等待重试与对冲的查询不在channel中，定时器保留，I/O线程重启后照常发往新channel
+        return;
+    }
+
+    // 关闭时取消等待重试的查询的定时器并单独结束
+    std::unordered_map<QueryContext *, DNSEventLoop::TimerId> retrying;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retrying.swap(retrying_queries_);
+    }
+    for (const auto &[context, timer]: retrying) {
+        event_loop_->cancel(timer);
+        complete_query(context, {ARES_EDESTRUCTION, context->hostname(), {}, {}});
+        context_pool_.release(context);
+    }
+    // 在途查询均已结束，剩余的对冲定时器不再需要
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &[context, timer]: hedge_timers_) {
+            event_loop_->cancel(timer);
+        }
+        hedge_timers_.clear();
+    }
+}
+
+DNSResolver::Upstreams DNSResolver::swap_channels(Upstreams upstreams,
+                                                  const std::vector<DNSUpstreamSelector::Upstream> &selection) {
+    std::unique_lock<std::shared_mutex> lock(channels_mutex_);
+    upstreams_.swap(upstreams);
+    // 选择器与channel同时替换，持读锁时选出的下标总在upstreams_范围内
+    if (!upstreams_.empty()) {
+        selector_.reset(selection);
+    }
+    return upstreams;
+}
+
+bool DNSResolver::init(const std::vector<std::string> &dns_servers, std::chrono::seconds cache_ttl) {
+    // 其余缓存参数使用默认配置
+    CacheConfig cache_config = DNSResolverConfig().cache();
+    cache_config.ttl = cache_ttl;
+    cache_config.min_ttl = std::min(cache_config.min_ttl, cache_ttl);
+    return init(dns_servers, cache_config);
+}
+
+bool DNSResolver::init(const std::vector<std::string> &dns_servers, const CacheConfig &cache_config) {
+    return init(toServerConfigs(dns_servers), cache_config);
+}
+
+bool DNSResolver::init(const std::vector<std::string> &dns_servers, std::shared_ptr<DNSCache> cache,
+                       std::shared_ptr<DNSMetrics> metrics) {
+    return init(toServerConfigs(dns_servers), std::move(cache), std::move(metrics));
+}
+
+bool DNSResolver::init(const std::vector<DNSServerConfig> &servers, const CacheConfig &cache_config) {
+    // 重复初始化时释放旧的channel
+    shutdown_channel();
+    if (!open_channels(servers)) {
+        return false;
+    }
+
+    cache_ = std::make_shared<DNSCache>(cache_config);
+    owns_cache_ = true;
+    cache_->startExpiryThread();
+
+    // 热点记录在过期前由后台按限速重新解析
+    if (cache_config.prefetch_enabled) {
+        prefetcher_ = std::make_shared<DNSPrefetcher>(
+                [this](const std::string &hostname) { prefetch(hostname); },
+                cache_config.prefetch_max_qps);
+        // 缓存可能比解析器存活更久，回调只持有弱引用
+        cache_->setRefreshCallback(
+                [weak = std::weak_ptr<DNSPrefetcher>(prefetcher_)](const std::string &hostname, uint32_t hits) {
+                    if (auto prefetcher = weak.lock()) {
+                        prefetcher->enqueue(hostname, hits);
+                    }
+                },
+                cache_config.prefetch_threshold);
+    }
+
+    if (!start_event_loop()) {
+        return false;
+    }
+    if (prefetcher_) {
+        prefetcher_->start();
+    }
+    metrics_->setReady(!warming_);
+    return true;
+}
+
+bool DNSResolver::init(const std::vector<DNSServerConfig> &servers, std::shared_ptr<DNSCache> cache,
+                       std::shared_ptr<DNSMetrics> metrics) {
+    if (!cache || !metrics) {
+        return false;
+    }
+    shutdown_channel();
+    if (!open_channels(servers)) {
+        return false;
+    }
+
+    cache_ = std::move(cache);
+    metrics_ = std::move(metrics);
+    owns_cache_ = false;
+    return start_event_loop();
+}
+
+std::vector<DNSServerConfig> DNSResolver::toServerConfigs(const std::vector<std::string> &dns_servers) {
+    std::vector<DNSServerConfig> servers;
+    servers.reserve(dns_servers.size());
+    for (const auto &address: dns_servers) {
+        // 端口为0表示address本身已是c-ares可解析的格式（可带端口）
+        servers.push_back({address, 0, 1, 2000, true});
+    }
+    return servers;
+}
+
+bool DNSResolver::open_channels(const std::vector<DNSServerConfig> &servers) {
+    Upstreams upstreams;
+    std::vector<DNSUpstreamSelector::Upstream> selection;
+    if (!create_channels(servers, upstreams, selection)) {
+        return false;
+    }
+    swap_channels(std::move(upstreams), selection);
+    return true;
+}
+
+bool DNSResolver::create_channels(const std::vector<DNSServerConfig> &servers, Upstreams &upstreams,
+                                  std::vector<DNSUpstreamSelector::Upstream> &selection) {
+    if (servers.empty()) {
+        // 未指定服务器时使用系统配置
+        if (!open_channel(nullptr, 1, upstreams)) {
+            return false;
+        }
+        selection.push_back({"system", 1});
+        return true;
+    }
+    if (servers.size() > DNSUpstreamSelector::MAX_UPSTREAMS) {
+        std::cerr << "Too many DNS servers, only the first " << DNSUpstreamSelector::MAX_UPSTREAMS
+                  << " are used" << std::endl;
+    }
+    const size_t count = std::min(servers.size(), DNSUpstreamSelector::MAX_UPSTREAMS);
+    for (size_t i = 0; i < count; ++i) {
+        if (!open_channel(&servers[i], count, upstreams)) {
+            for (const auto &upstream: upstreams) {
+                ares_destroy(upstream->channel);
+            }
+            upstreams.clear();
+            selection.clear();
+            return false;
+        }
+        selection.push_back({channel_name(upstreams.back()->channel, servers[i].address), servers[i].weight});
+    }
+    return true;
+}
+
+bool DNSResolver::open_channel(const DNSServerConfig *server, size_t server_count, Upstreams &upstreams) {
+    auto upstream = std::make_unique<Upstream>();
+    upstream->resolver = this;
+
+    ares_options options{};
+    int optmask = 0;
+
+    // 设置c-ares选项
+    memset(&options, 0, sizeof(options));
+    options.flags = ARES_FLAG_NOCHECKRESP;// 不检查响应的id
+    options.timeout = server && server->timeout_ms > 0 ? static_cast<int>(server->timeout_ms) : 2000;
+    // 多个上游时超时后立即切换到其他上游；只有一个上游时仍由c-ares重传3次
+    options.tries = server_count > 1 ? 1 : 3;
+    options.ndots = 1;// 域名中的点数阈值
+    options.sock_state_cb = socket_callback;
+    options.sock_state_cb_data = upstream.get();
+    // 关闭c-ares自带的查询缓存：地址与类型化记录都只缓存在DNSCache中，预取与刷新总是到达上游
+    options.qcache_max_ttl = 0;
+    optmask = ARES_OPT_FLAGS | ARES_OPT_TIMEOUTMS | ARES_OPT_TRIES | ARES_OPT_NDOTS | ARES_OPT_SOCK_STATE_CB |
+              ARES_OPT_QUERY_CACHE;
+
+    int status = ares_init_options(&upstream->channel, &options, optmask);
+    if (status != ARES_SUCCESS) {
+        std::cerr << "Failed to initialize c-ares: " << ares_strerror(status) << std::endl;
+        return false;
+    }
+
+    if (server) {
+        const std::string address = server_address(*server);
+        // 设置DNS服务器
+        status = ares_set_servers_ports_csv(upstream->channel, address.c_str());
+        if (status != ARES_SUCCESS) {
+            std::cerr << "Failed to set DNS server " << address << ": " << ares_strerror(status) << std::endl;
+            ares_destroy(upstream->channel);
+            return false;
+        }
+    }
+    upstreams.push_back(std::move(upstream));
+    return true;
+}
+
+std::string DNSResolver::server_address(const DNSServerConfig &server) {
+    // 配置中的端口为0时address可自带端口
+    std::string address = server.address;
+    if (server.port != 0) {
+        if (address.find(':') != std::string::npos && address.front() != '[') {
+            address = "[" + address + "]";
+        }
+        address += ":" + std::to_string(server.port);
+    }
+    return address;
+}
+
+std::string DNSResolver::channel_name(ares_channel channel, const std::string &fallback) {
+    std::string name = fallback;
+    if (char *csv = ares_get_servers_csv(channel)) {
+        name = csv;
+        ares_free_string(csv);
+    }
+    return name;
+}
+
+bool DNSResolver::start_event_loop() {
+    // 由独立的I/O线程驱动所有channel，resolve()返回的future无需调用方轮询即可完成
+    for (const auto &upstream: upstreams_) {
+        event_loop_->addChannel(upstream->channel);
+    }
+    if (!event_loop_->start()) {
+        for (const auto &upstream: swap_channels({}, {})) {
+            event_loop_->removeChannel(upstream->channel);
+            ares_destroy(upstream->channel);
+        }
+        return false;
+    }
+    initialized_ = true;
+    return true;
+}
+
+bool DNSResolver::loadConfig(const DNSResolverConfig &config) {
+    try {
+        // 验证配置
+        DNSConfigValidator::validate(config);
+        warming_ = !config.cache().warmup_file.empty();
+        // 重新初始化（保留启用服务器的端口、权重与超时）
+        if (!init(active_servers(config), config.cache())) {
+            return false;
+        }
+        // 配置指标收集
+        if (config.metrics().enabled) {
+            metrics_->startPrometheusExporter(config.metrics().prometheus_address);
+        }
+        // 加载持久化缓存；启用日志时重放快照之后的写入，并在后台定期做检查点
+        if (config.cache().enabled && config.cache().persistent) {
+            if (config.cache().journal_enabled) {
+                journal_ = std::make_unique<DNSCacheJournal>(cache_, config.cache());
+                journal_->recover();
+                journal_->start();
+            } else {
+                load_cache(config.cache().cache_file);
+            }
+        }
+        applyConfig(config);
+        // 已从快照恢复的主机名在预热时直接命中缓存
+        if (warming_) {
+            warmup(config.cache().warmup_file, config.cache());
+        }
+    } catch (const ConfigValidationError &e) {
+        std::cerr << "Configuration validation error: " << e.what() << std::endl;
+        return false;
+    } catch (const std::exception &e) {
+        std::cerr << "Error loading configuration: " << e.what() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool DNSResolver::loadConfig(const std::string &config_file) {
+    try {
+        auto &config = DNSResolverConfig::getInstance();
+        if (!config.loadFromFile(config_file) || !loadConfig(config)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(reload_mutex_);
+        config_file_ = config_file;
+        return true;
+    } catch (const std::exception &e) {
+        std::cerr << "Error loading configuration file: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DNSResolver::reloadConfig() {
+    std::string config_file;
+    {
+        std::lock_guard<std::mutex> lock(reload_mutex_);
+        config_file = config_file_;
+    }
+    if (config_file.empty()) {
+        std::cerr << "No configuration file to reload" << std::endl;
+        return false;
+    }
+    try {
+        DNSResolverConfig config;
+        if (!config.loadFromFile(config_file)) {
+            return false;
+        }
+        return reloadConfig(config);
+    } catch (const std::exception &e) {
+        std::cerr << "Error reloading configuration file: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DNSResolver::reloadConfig(const DNSResolverConfig &config, std::vector<std::string> *differences) {
+    std::lock_guard<std::mutex> lock(reload_mutex_);
+    const auto current = config_.load();
+    if (!initialized_ || !current) {
+        std::cerr << "Resolver is not configured, use loadConfig() first" << std::endl;
+        return false;
+    }
+    try {
+        DNSConfigValidator::validate(config);
+    } catch (const ConfigValidationError &e) {
+        std::cerr << "Configuration validation error: " << e.what() << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> changes;
+    DNSConfigVersion::compareConfigs(current->toJson(), config.toJson(), changes);
+    if (differences) {
+        *differences = changes;
+    }
+    if (changes.empty()) {
+        return true;
+    }
+    // 差异路径的第一段即配置分区（servers、cache、retry等）
+    std::unordered_set<std::string> sections;
+    for (const auto &change: changes) {
+        sections.insert(change.substr(0, change.find_first_of(".[:")));
+    }
+
+    if (sections.contains("servers") && !apply_servers(active_servers(*current), active_servers(config))) {
+        return false;
+    }
+    if (sections.contains("cache")) {
+        // 共享缓存（如DNSResolverPool）由所有者调整
+        if (owns_cache_) {
+            cache_->reconfigure(config.cache());
+            if (prefetcher_) {
+                prefetcher_->setRate(config.cache().prefetch_max_qps);
+            }
+        }
+        if (config.cache().shard_count != current->cache().shard_count ||
+            config.cache().prefetch_enabled != current->cache().prefetch_enabled) {
+            std::cerr << "Cache shard_count and prefetch_enabled changes take effect after restart" << std::endl;
+        }
+        if (config.cache().persistent != current->cache().persistent ||
+            config.cache().cache_file != current->cache().cache_file ||
+            config.cache().journal_enabled != current->cache().journal_enabled ||
+            config.cache().journal_flush_interval_ms != current->cache().journal_flush_interval_ms ||
+            config.cache().checkpoint_interval != current->cache().checkpoint_interval ||
+            config.cache().journal_max_size != current->cache().journal_max_size) {
+            std::cerr << "Cache persistence changes take effect after restart" << std::endl;
+        }
+    }
+    if (sections.contains("metrics")) {
+        // 不重建Prometheus exporter，避免重复绑定端口与丢失已导出的指标
+        std::cerr << "Metrics configuration changes take effect after restart" << std::endl;
+    }
+    // 重试、上游选择与全局配置随新快照生效
+    applyConfig(config);
+    return true;
+}
+
+bool DNSResolver::apply_servers(const std::vector<DNSServerConfig> &old_servers,
+                                const std::vector<DNSServerConfig> &servers) {
+    const size_t count = std::min(servers.size(), DNSUpstreamSelector::MAX_UPSTREAMS);
+    bool in_place = count > 0 && count == upstreams_.size() &&
+                    std::min(old_servers.size(), DNSUpstreamSelector::MAX_UPSTREAMS) == count;
+    for (size_t i = 0; in_place && i < count; ++i) {
+        // 超时属于channel选项，修改需要重建
+        in_place = old_servers[i].timeout_ms == servers[i].timeout_ms;
+    }
+
+    if (in_place) {
+        // 原地替换每个channel的服务器，c-ares会把在途查询转到新服务器，其余查询不受影响。
+        // 只有热更新线程替换upstreams_，这里读取无需加锁（c-ares可能同步回调并再次发送查询）
+        std::vector<DNSUpstreamSelector::Upstream> selection;
+        selection.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            const std::string address = server_address(servers[i]);
+            const int status = ares_set_servers_ports_csv(upstreams_[i]->channel, address.c_str());
+            if (status != ARES_SUCCESS) {
+                std::cerr << "Failed to set DNS server " << address << ": " << ares_strerror(status) << std::endl;
+                // 已修改的channel恢复为原来的服务器，与选择器和配置快照保持一致
+                for (size_t j = 0; j < i; ++j) {
+                    ares_set_servers_ports_csv(upstreams_[j]->channel, server_address(old_servers[j]).c_str());
+                }
+                return false;
+            }
+            selection.push_back({channel_name(upstreams_[i]->channel, servers[i].address), servers[i].weight});
+        }
+        return selector_.update(selection);
+    }
+
+    // 上游数量或超时变化：先建好新channel，失败时保留原来的上游；缓存、指标与预取器保留
+    Upstreams upstreams;
+    std::vector<DNSUpstreamSelector::Upstream> selection;
+    if (!create_channels(servers, upstreams, selection)) {
+        return false;
+    }
+    if (prefetcher_) {
+        prefetcher_->stop();
+    }
+    close_channels(std::move(upstreams), selection);
+    if (!start_event_loop()) {
+        // 新channel已随之销毁，等待重试的查询无法再发出
+        close_channels();
+        initialized_ = false;
+        return false;
+    }
+    if (prefetcher_) {
+        prefetcher_->start();
+    }
+    return true;
+}
+
+std::vector<DNSServerConfig> DNSResolver::active_servers(const DNSResolverConfig &config) {
+    std::vector<DNSServerConfig> servers;
+    for (const auto &server: config.servers()) {
+        if (server.enabled) {
+            servers.push_back(server);
+        }
+    }
+    return servers;
+}
+
+void DNSResolver::applyConfig(const DNSResolverConfig &config) {
+    retry_policy_.configure(config.retry());
+    selector_.configure(config.upstream());
+    config_.store(std::make_shared<const DNSResolverConfig>(config));
+}
+
+std::shared_ptr<const DNSResolverConfig> DNSResolver::getConfig() const {
+    return config_.load();
+}
+
+std::future<DNSResolver::ResolveResult> DNSResolver::resolve(const std::string &hostname) {
+    // future接口基于回调接口实现
+    auto promise = std::make_shared<std::promise<ResolveResult>>();
+    auto future = promise->get_future();
+    resolve_async(hostname, [promise](const ResolveResult &result) {
+        promise->set_value(result);
+    });
+    return future;
+}
+
+void DNSResolver::resolve_async(const std::string &name, ResolveCallback callback) {
+    std::string canonical;
+    const std::string &hostname = DNSHostname::canonicalize(name, canonical);
+    if (!initialized_) {
+        callback({ARES_ENOTINITIALIZED, hostname, {}, {}});
+        return;
+    }
+
+    const bool traced = tracing();
+    std::chrono::steady_clock::time_point lookup_start{};
+    if (traced) [[unlikely]] {
+        lookup_start = std::chrono::steady_clock::now();
+    }
+
+    // 命中时复用线程局部的结果对象，稳定状态下不产生堆分配；回调中再次解析时退回局部对象
+    thread_local ResolveResult scratch;
+    thread_local bool scratch_in_use = false;
+    if (!scratch_in_use) {
+        if (try_resolve_cached(hostname, scratch)) {
+            if (traced) [[unlikely]] {
+                trace_lookup(hostname, 0, lookup_start, &scratch);
+            }
+            scratch_in_use = true;
+            try {
+                callback(scratch);
+            } catch (...) {
+                scratch_in_use = false;
+                throw;
+            }
+            scratch_in_use = false;
+            return;
+        }
+    } else {
+        ResolveResult result;
+        if (try_resolve_cached(hostname, result)) {
+            if (traced) [[unlikely]] {
+                trace_lookup(hostname, 0, lookup_start, &result);
+            }
+            callback(result);
+            return;
+        }
+    }
+
+    start_query(hostname, std::move(callback), traced ? trace_lookup(hostname, 0, lookup_start, nullptr) : nullptr);
+}
+
+DNSResolver::ResolveAwaitable DNSResolver::resolve_co(const std::string &hostname) {
+    return {*this, DNSHostname::canonicalize(std::string_view(hostname))};
+}
+
+void DNSResolver::resolve_dual_stack(const std::string &name, DualStackCallback callback) {
+    std::string canonical;
+    const std::string &hostname = DNSHostname::canonicalize(name, canonical);
+    if (!initialized_) {
+        callback({ARES_ENOTINITIALIZED, hostname, {}, {}}, true);
+        return;
+    }
+    if (!split_families()) {
+        resolve_async(hostname, [callback = std::move(callback)](const ResolveResult &result) {
+            callback(result, true);
+        });
+        return;
+    }
+
+    auto race = std::make_shared<FamilyRace>();
+    race->hostname = hostname;
+    race->callback = std::move(callback);
+    race->updates = true;
+    bool positive = false;
+    bool nxdomain = false;
+    const int families[2] = {AF_INET6, AF_INET};
+    for (size_t slot = 0; slot < 2; ++slot) {
+        auto &result = race->results[slot];
+        race->done[slot] = lookup_cached(cache_key(hostname, families[slot]), result);
+        result.hostname = hostname;
+        result.resolution_time = std::chrono::milliseconds(0);
+        positive = positive || (race->done[slot] && result.status == ARES_SUCCESS);
+        nxdomain = nxdomain || (race->done[slot] && result.status == ARES_ENOTFOUND);
+    }
+    const bool final = (race->done[0] && race->done[1]) || (nxdomain && !positive);
+    if (positive) {
+        metrics_->recordCacheHit(hostname);
+    } else if (final) {
+        metrics_->recordNegativeCacheHit(hostname);
+    } else {
+        metrics_->recordCacheMiss(hostname);
+    }
+
+    // 缓存中的地址无需等待宽限期，立即交付，缺失的地址族查询后再交付一次
+    if (positive || final) {
+        race->delivered = true;
+        deliver(*race, merge_families(*race), final);
+    }
+    if (!final) {
+        start_split_query(race);
+    }
+}
+
+bool DNSResolver::try_resolve_cached(const std::string &hostname, ResolveResult &result) {
+    if (!initialized_) {
+        result = {ARES_ENOTINITIALIZED, hostname, {}, {}};
+        return true;
+    }
+    if (split_families()) {
+        return try_resolve_split_cached(hostname, result);
+    }
+    // 检查缓存，正向记录未命中时再查否定记录
+    if (!lookup_cached(hostname, result)) {
+        metrics_->recordCacheMiss(hostname);
+        return false;
+    }
+    if (result.status == ARES_SUCCESS) {
+        metrics_->recordCacheHit(hostname);
+    } else {
+        metrics_->recordNegativeCacheHit(hostname);
+    }
+    result.hostname = hostname;
+    result.resolution_time = std::chrono::milliseconds(0);
+    return true;
+}
+
+bool DNSResolver::try_resolve_split_cached(const std::string &hostname, ResolveResult &result) {
+    // A与AAAA分别缓存：任一地址族有地址即返回，尚无记录的地址族在后台补齐
+    thread_local std::string v6_key;
+    thread_local ResolveResult v4;
+    v6_key.assign(hostname).append(AAAA_KEY_SUFFIX);
+    const bool has_v6 = lookup_cached(v6_key, result);
+    const bool has_v4 = lookup_cached(hostname, v4);
+    const bool v6_ok = has_v6 && result.status == ARES_SUCCESS;
+    const bool v4_ok = has_v4 && v4.status == ARES_SUCCESS;
+    // NXDOMAIN表示名字不存在，对两个地址族都成立
+    const bool nxdomain = (has_v6 && result.status == ARES_ENOTFOUND) || (has_v4 && v4.status == ARES_ENOTFOUND);
+    if (v6_ok || v4_ok) {
+        if (!v6_ok) {
+            result.ip_addresses.clear();
+            result.ttl = v4.ttl;
+        }
+        if (v4_ok) {
+            for (const auto &address: v4.ip_addresses) {
+                result.ip_addresses.push_back(address);
+            }
+            result.ttl = std::min(result.ttl, v4.ttl);
+        }
+        if (!has_v4) {
+            fill_family(hostname, AF_INET);
+        }
+        if (!has_v6) {
+            fill_family(hostname, AF_INET6);
+        }
+        result.status = ARES_SUCCESS;
+        metrics_->recordCacheHit(hostname);
+    } else if (nxdomain || (has_v6 && has_v4)) {
+        result.status = nxdomain ? ARES_ENOTFOUND : ARES_ENODATA;
+        result.ip_addresses.clear();
+        result.ttl = has_v6 && has_v4 ? std::min(result.ttl, v4.ttl) : (has_v6 ? result.ttl : v4.ttl);
+        metrics_->recordNegativeCacheHit(hostname);
+    } else {
+        metrics_->recordCacheMiss(hostname);
+        return false;
+    }
+    result.hostname = hostname;
+    result.resolution_time = std::chrono::milliseconds(0);
+    return true;
+}
+
+bool DNSResolver::lookup_cached(std::string_view key, ResolveResult &result) {
+    // 只在分片锁内取得记录的引用，地址在锁外复制
+    if (const auto record = cache_->find(key, result.ttl)) {
+        result.ip_addresses = record->ip_addresses;
+        result.records = record->records;
+        result.status = ARES_SUCCESS;
+        return true;
+    }
+    switch (cache_->getNegative(key, result.ttl)) {
+        case DNSNegativeKind::NXDomain:
+            result.status = ARES_ENOTFOUND;
+            break;
+        case DNSNegativeKind::NoData:
+            result.status = ARES_ENODATA;
+            break;
+        default:
+            return false;
+    }
+    result.ip_addresses.clear();
+    result.records.reset();
+    return true;
+}
+
+bool DNSResolver::resolve_cached(const std::string &name, ResolveResult &result) {
+    std::string canonical;
+    return try_resolve_cached(DNSHostname::canonicalize(name, canonical), result);
+}
+
+bool DNSResolver::resolve_cached(const std::string &name, int family, ResolveResult &result) {
+    std::string canonical;
+    const std::string &hostname = DNSHostname::canonicalize(name, canonical);
+    if (!initialized_ || !split_families()) {
+        return try_resolve_cached(hostname, result);
+    }
+    // 与try_resolve_split_cached不同，只有本地址族的记录才能回答本地址族的查询
+    thread_local std::string key;
+    key.assign(hostname);
+    if (family == AF_INET6) {
+        key.append(AAAA_KEY_SUFFIX);
+    }
+    if (!lookup_cached(key, result)) {
+        metrics_->recordCacheMiss(hostname);
+        return false;
+    }
+    if (result.status == ARES_SUCCESS) {
+        metrics_->recordCacheHit(hostname);
+    } else {
+        metrics_->recordNegativeCacheHit(hostname);
+    }
+    result.hostname = hostname;
+    result.resolution_time = std::chrono::milliseconds(0);
+    return true;
+}
+
+void DNSResolver::resolve_miss_async(const std::string &name, ResolveCallback callback) {
+    std::string canonical;
+    const std::string &hostname = DNSHostname::canonicalize(name, canonical);
+    if (!initialized_) {
+        callback({ARES_ENOTINITIALIZED, hostname, {}, {}});
+        return;
+    }
+    start_query(hostname, std::move(callback));
+}
+
+void DNSResolver::resolve_miss_async(const std::string &name, int family, ResolveCallback callback) {
+    std::string canonical;
+    const std::string &hostname = DNSHostname::canonicalize(name, canonical);
+    if (!initialized_) {
+        callback({ARES_ENOTINITIALIZED, hostname, {}, {}});
+        return;
+    }
+    if (split_families()) {
+        start_family_query(hostname, family, std::move(callback));
+    } else {
+        start_query(hostname, std::move(callback));
+    }
+}
+
+void DNSResolver::prefetch(const std::string &hostname) {
+    if (!initialized_) {
+        return;
+    }
+    metrics_->recordPrefetch(hostname);
+    // 结果通过process_result写回缓存，无需等待；AAAA与类型化记录的缓存键需还原为主机名
+    if (const auto slash = hostname.rfind('/'); slash != std::string::npos) {
+        if (const auto type = parseRecordType(std::string_view(hostname).substr(slash + 1))) {
+            start_record_query(hostname.substr(0, slash), *type, nullptr);
+            return;
+        }
+    }
+    if (hostname.ends_with(AAAA_KEY_SUFFIX)) {
+        start_family_query(hostname.substr(0, hostname.size() - AAAA_KEY_SUFFIX.size()), AF_INET6, nullptr);
+    } else if (split_families()) {
+        start_family_query(hostname, AF_INET, nullptr);
+    } else {
+        start_query(hostname, nullptr);
+    }
+}
+
+void DNSResolver::resolve_records_async(const std::string &name, DNSRecordType type, ResolveCallback callback) {
+    std::string canonical;
+    const std::string &hostname = DNSHostname::canonicalize(name, canonical);
+    if (!initialized_) {
+        callback({ARES_ENOTINITIALIZED, hostname, {}, {}});
+        return;
+    }
+
+    const bool traced = tracing();
+    std::chrono::steady_clock::time_point lookup_start{};
+    if (traced) [[unlikely]] {
+        lookup_start = std::chrono::steady_clock::now();
+    }
+    // 命中与未命中计入与地址查询相同的缓存指标
+    ResolveResult result;
+    if (lookup_cached(record_key(hostname, type), result)) {
+        if (result.status == ARES_SUCCESS) {
+            metrics_->recordCacheHit(hostname);
+        } else {
+            metrics_->recordNegativeCacheHit(hostname);
+        }
+        result.hostname = hostname;
+        result.resolution_time = std::chrono::milliseconds(0);
+        if (traced) [[unlikely]] {
+            trace_lookup(hostname, static_cast<uint16_t>(type), lookup_start, &result);
+        }
+        callback(result);
+        return;
+    }
+    metrics_->recordCacheMiss(hostname);
+    start_record_query(hostname, type, std::move(callback),
+                       traced ? trace_lookup(hostname, static_cast<uint16_t>(type), lookup_start, nullptr) : nullptr);
+}
+
+void DNSResolver::fill_family(const std::string &hostname, int family) {
+    // 有预取器时交给它限速与去重，否则直接发起（同名查询在途时会被合并）
+    if (prefetcher_) {
+        prefetcher_->enqueue(cache_key(hostname, family), 0);
+    } else {
+        start_family_query(hostname, family, nullptr);
+    }
+}
+
+bool DNSResolver::split_families() const {
+    const auto config = config_.load();
+    return config && config->ipv6_enabled() && config->split_family_queries();
+}
+
+void DNSResolver::start_query(const std::string &hostname, ResolveCallback callback,
+                              std::unique_ptr<DNSQuerySpan> span) {
+    if (split_families()) {
+        auto race = std::make_shared<FamilyRace>();
+        race->hostname = hostname;
+        race->lookup_span = std::move(span);
+        if (callback) {
+            race->callback = [callback = std::move(callback)](const ResolveResult &result, bool) {
+                callback(result);
+            };
+        }
+        start_split_query(race);
+        return;
+    }
+    const auto config = config_.load();
+    start_family_query(hostname, config && config->ipv6_enabled() ? AF_UNSPEC : AF_INET, std::move(callback),
+                       std::move(span));
+}
+
+void DNSResolver::start_split_query(const std::shared_ptr<FamilyRace> &race) {
+    // 先发起AAAA：两者同时到达时按RFC 8305优先使用IPv6
+    static constexpr int FAMILIES[2] = {AF_INET6, AF_INET};
+    bool pending[2];
+    {
+        std::lock_guard<std::mutex> lock(race->mutex);
+        pending[0] = !race->done[0];
+        pending[1] = !race->done[1];
+    }
+    for (size_t slot = 0; slot < 2; ++slot) {
+        if (pending[slot]) {
+            start_family_query(
+                    race->hostname, FAMILIES[slot],
+                    [this, race, slot](const ResolveResult &result) { on_family_result(race, slot, result); },
+                    race->lookup_span ? std::make_unique<DNSQuerySpan>(*race->lookup_span) : nullptr);
+        }
+    }
+    race->lookup_span.reset();
+}
+
+void DNSResolver::on_family_result(const std::shared_ptr<FamilyRace> &race, size_t slot, const ResolveResult &result) {
+    ResolveResult delivery;
+    bool deliver_now = false;
+    bool final = false;
+    DNSEventLoop::TimerId grace_timer = 0;
+    {
+        std::lock_guard<std::mutex> lock(race->mutex);
+        race->results[slot] = result;
+        race->done[slot] = true;
+        if (race->done[0] && race->done[1]) {
+            grace_timer = std::exchange(race->grace_timer, 0);
+            deliver_now = !race->delivered || race->updates;
+            final = true;
+        } else if (result.status == ARES_SUCCESS) {
+            // 先到的地址族成功：宽限期内另一地址族到达则合并交付，否则到期后先交付这一个
+            const auto config = config_.load();
+            const auto grace = std::chrono::milliseconds(config ? config->family_grace_ms() : 0);
+            if (grace.count() == 0) {
+                deliver_now = true;
+            } else {
+                race->grace_timer = event_loop_->schedule(grace, [this, race] { on_family_grace_expired(race); });
+            }
+        }
+        // 先到的地址族失败时不交付，等待另一地址族的结果
+        if (deliver_now) {
+            race->delivered = true;
+            delivery = merge_families(*race);
+        }
+    }
+    if (grace_timer != 0) {
+        event_loop_->cancel(grace_timer);
+    }
+    if (deliver_now) {
+        deliver(*race, delivery, final);
+    }
+}
+
+void DNSResolver::on_family_grace_expired(const std::shared_ptr<FamilyRace> &race) {
+    ResolveResult delivery;
+    {
+        std::lock_guard<std::mutex> lock(race->mutex);
+        race->grace_timer = 0;
+        if (race->delivered || (race->done[0] && race->done[1])) {
+            return;
+        }
+        race->delivered = true;
+        delivery = merge_families(*race);
+    }
+    deliver(*race, delivery, false);
+}
+
+DNSResolver::ResolveResult DNSResolver::merge_families(const FamilyRace &race) {
+    ResolveResult merged{ARES_ENODATA, race.hostname, {}, std::chrono::milliseconds(0)};
+    bool succeeded = false;
+    for (size_t slot = 0; slot < 2; ++slot) {
+        if (!race.done[slot]) {
+            continue;
+        }
+        const auto &result = race.results[slot];
+        merged.resolution_time = std::max(merged.resolution_time, result.resolution_time);
+        if (result.status == ARES_SUCCESS) {
+            merged.ttl = succeeded ? std::min(merged.ttl, result.ttl) : result.ttl;
+            succeeded = true;
+            for (const auto &address: result.ip_addresses) {
+                merged.ip_addresses.push_back(address);
+            }
+        } else if (!succeeded) {
+            // 都失败时报告A查询的状态
+            merged.status = result.status;
+        }
+    }
+    if (succeeded) {
+        merged.status = ARES_SUCCESS;
+    }
+    return merged;
+}
+
+void DNSResolver::deliver(const FamilyRace &race, const ResolveResult &result, bool final) {
+    if (!race.callback) {
+        return;
+    }
+    try {
+        race.callback(result, final);
+    } catch (const std::exception &e) {
+        std::cerr << "Error executing resolve callback for " << result.hostname << ": " << e.what() << std::endl;
+    }
+}
+
+void DNSResolver::start_upstream_query(const std::string &hostname, int family, uint16_t record_type,
+                                       ResolveCallback callback, std::unique_ptr<DNSQuerySpan> span) {
+    if (!initialized_) {
+        if (callback) {
+            callback({ARES_ENOTINITIALIZED, hostname, {}, {}});
+        }
+        return;
+    }
+
+    if (hostname.size() > QueryContext::MAX_HOSTNAME_LENGTH) {
+        if (callback) {
+            callback({ARES_EBADNAME, hostname, {}, {}});
+        }
+        return;
+    }
+
+    std::string key = make_key(hostname, family, record_type);
+    {
+        // 已有相同的在途查询时直接等待其结果
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto [it, inserted] = pending_queries_.try_emplace(key);
+        if (callback) {
+            it->second.push_back(std::move(callback));
+        }
+        if (!inserted) {
+            metrics_->recordCoalescedQuery(hostname);
+            return;
+        }
+    }
+    retry_policy_.recordQuery();
+
+    auto *context = context_pool_.acquire();
+    context->resolver = this;
+    context->family = family;
+    context->record_type = record_type;
+    context->start_time = std::chrono::steady_clock::now();
+    context->hostname_length = static_cast<uint16_t>(hostname.size());
+    context->key_length = static_cast<uint16_t>(key.size());
+    std::memcpy(context->name, key.data(), key.size());
+    if (tracing()) [[unlikely]] {
+        if (!span) {
+            span = std::make_unique<DNSQuerySpan>();
+            span->hostname = hostname;
+            span->start = context->start_time;
+        }
+        span->family = family;
+        span->record_type = record_type;
+        span->events.push_back({DNSTraceEvent::Kind::Enqueue, context->start_time});
+        context->span = span.release();
+    }
+
+    // 对冲在发送前登记，此时context不会被并发释放；定时器在发送后才调度，
+    // send_query写入的context字段经事件循环的锁交给I/O线程
+    const size_t upstream = selector_.select(context->tried);
+    context->upstream = static_cast<uint16_t>(upstream);
+    const auto hedge_delay = prepare_hedge(context);
+    send_query(context, upstream);
+    if (hedge_delay) {
+        schedule_hedge(context, *hedge_delay);
+    }
+}
+
+std::string DNSResolver::make_key(const std::string &hostname, int family, uint16_t record_type) {
+    std::string key;
+    key.reserve(hostname.size() + 7);
+    key.append(hostname);
+    key.push_back('\0');
+    if (record_type != 0) {
+        key.push_back('#');
+        key.append(std::to_string(record_type));
+    } else {
+        key.append(std::to_string(family));
+    }
+    return key;
+}
+
+std::string DNSResolver::cache_key(const std::string &hostname, int family) {
+    if (family != AF_INET6) {
+        return hostname;
+    }
+    std::string key;
+    key.reserve(hostname.size() + AAAA_KEY_SUFFIX.size());
+    key.append(hostname);
+    key.append(AAAA_KEY_SUFFIX);
+    return key;
+}
+
+std::string DNSResolver::record_key(const std::string &hostname, DNSRecordType type) {
+    std::string key;
+    key.reserve(hostname.size() + 6);
+    key.append(hostname);
+    key.push_back('/');
+    key.append(recordTypeName(type));
+    return key;
+}
+
+void DNSResolver::issue_query(QueryContext *context) {
+    send_query(context, selector_.select(context->tried));
+}
+
+void DNSResolver::send_query(QueryContext *context, size_t upstream) {
+    // c-ares可能在发送调用内同步回调（如hosts文件命中），回调中再次发送时本线程已持有该解析器的读锁
+    thread_local std::vector<const DNSResolver *> reading;
+    std::shared_lock<std::shared_mutex> lock(channels_mutex_, std::defer_lock);
+    if (std::ranges::find(reading, this) == reading.end()) {
+        lock.lock();
+    }
+    if (upstreams_.empty()) {
+        // channel已关闭（重建失败或正在关闭），按销毁结束查询
+        if (lock.owns_lock()) {
+            lock.unlock();
+        }
+        if (context->record_type != 0) {
+            dnsrec_callback(context, ARES_EDESTRUCTION, 0, nullptr);
+        } else {
+            addrinfo_callback(context, ARES_EDESTRUCTION, 0, nullptr);
+        }
+        return;
+    }
+    if (upstream >= upstreams_.size()) {
+        // 下标在channel替换之前选出，按新的上游列表重新选择
+        upstream = selector_.select(context->tried);
+    }
+    context->upstream = static_cast<uint16_t>(upstream);
+    context->tried |= uint32_t{1} << upstream;
+    context->sent_time = std::chrono::steady_clock::now();
+    if (auto *span = span_of(context)) [[unlikely]] {
+        span->events.push_back({DNSTraceEvent::Kind::Send, context->sent_time, context->upstream});
+    }
+    const ares_channel channel = upstreams_[upstream]->channel;
+    const bool nested = !lock.owns_lock();
+    if (!nested) {
+        reading.push_back(this);
+    }
+    if (context->record_type != 0) {
+        // 发送失败时c-ares同样通过回调报告，不必检查返回值
+        ares_query_dnsrec(channel, context->hostname(), ARES_CLASS_IN,
+                          static_cast<ares_dns_rec_type_t>(context->record_type), dnsrec_callback, context, nullptr);
+    } else {
+        struct ares_addrinfo_hints hints = {};
+        hints.ai_family = context->family;
+        hints.ai_flags = ARES_AI_CANONNAME;
+        ares_getaddrinfo(channel, context->hostname(), nullptr, &hints, addrinfo_callback, context);
+    }
+    if (!nested) {
+        std::erase(reading, this);
+        lock.unlock();
+    }
+    // 新查询可能带来更早的超时时间，通知I/O线程重新计算（重试在I/O线程中发起，无需唤醒）
+    if (!event_loop_->inLoopThread()) {
+        event_loop_->wakeup();
+    }
+}
+
+std::optional<std::chrono::milliseconds> DNSResolver::prepare_hedge(QueryContext *context) {
+    if (selector_.size() < 2 || !retry_policy_.hedgeEnabled({context->hostname(), context->hostname_length})) {
+        return std::nullopt;
+    }
+    // 等待时间取首选上游RTT的分位，RTT快照由指标后台线程定期更新
+    const auto rtt = metrics_->serverLatencyPercentile(selector_.name(context->upstream), retry_policy_.hedgePercentile());
+    const auto delay = retry_policy_.hedgeDelay(rtt);
+    std::lock_guard<std::mutex> lock(mutex_);
+    hedge_timers_[context] = 0;
+    return delay;
+}
+
+void DNSResolver::schedule_hedge(QueryContext *context, std::chrono::milliseconds delay) {
+    // 查询可能已在发送调用内同步结束并被释放，登记项已删除时不再调度；
+    // 持锁调度，避免结束查询时在记录定时器id之前取消
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = hedge_timers_.find(context);
+    if (it == hedge_timers_.end() || it->second != 0) {
+        return;
+    }
+    it->second = event_loop_->schedule(delay, [this, context] { hedge_query(context); });
+}
+
+void DNSResolver::hedge_query(QueryContext *context) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (hedge_timers_.erase(context) == 0) {
+            return;// 查询已结束
+        }
+    }
+    if (context->peer || !selector_.hasAlternative(context->tried) || !retry_policy_.tryHedge()) {
+        return;
+    }
+
+    // 对冲查询复制主机名与在途查询表的键，两者先到的应答结束查询
+    auto *hedge = context_pool_.acquire();
+    *hedge = *context;
+    hedge->span = nullptr;
+    hedge->hedge = true;
+    hedge->cancelled = false;
+    hedge->peer = context;
+    context->peer = hedge;
+    metrics_->recordHedge(std::string(context->hostname(), context->hostname_length));
+    trace_event(context, DNSTraceEvent::Kind::Hedge);
+    issue_query(hedge);
+}
+
+void DNSResolver::cancel_hedge(QueryContext *context) {
+    DNSEventLoop::TimerId timer = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = hedge_timers_.find(context);
+        if (it == hedge_timers_.end()) {
+            return;
+        }
+        timer = it->second;
+        hedge_timers_.erase(it);
+    }
+    event_loop_->cancel(timer);
+}
+
+void DNSResolver::retry_query(QueryContext *context) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (retrying_queries_.erase(context) == 0) {
+            return;// 已在关闭channel时结束
+        }
+    }
+    trace_event(context, DNSTraceEvent::Kind::Retry);
+    // 重试时所有上游重新参与选择
+    context->tried = 0;
+    issue_query(context);
+}
+
+std::vector<std::future<DNSResolver::ResolveResult>> DNSResolver::resolve_batch(const std::vector<std::string> &hostnames,
+                                                                              size_t max_in_flight) {
+    return DNSBatchWindow::batch(
+            [self = shared_from_this()](const std::string &hostname, ResolveCallback callback) {
+                self->resolve_async(hostname, std::move(callback));
+            },
+            hostnames, max_in_flight > 0 ? max_in_flight : default_window());
+}
+
+void DNSResolver::resolve_stream(const HostnameSource &source, const ResolveCallback &on_result, size_t max_in_flight) {
+    DNSBatchWindow::stream(
+            [this](const std::string &hostname, ResolveCallback callback) {
+                resolve_async(hostname, std::move(callback));
+            },
+            source, on_result, max_in_flight > 0 ? max_in_flight : default_window());
+}
+
+size_t DNSResolver::default_window() const {
+    const auto config = config_.load();
+    return config ? config->max_concurrent_queries() : 100;
+}
+
+std::future<DNSResolver::ResolveResult> DNSResolver::refresh(const std::string &name) {
+    std::string canonical;
+    const std::string &hostname = DNSHostname::canonicalize(name, canonical);
+    if (cache_) {
+        cache_->remove(hostname);
+        cache_->remove(cache_key(hostname, AF_INET6));
+    }
+    return resolve(hostname);
+}
+
+void DNSResolver::clear_cache() {
+    if (cache_) {
+        cache_->clear();
+    }
+}
+
+bool DNSResolver::save_cache(const std::string &filename) const {
+    if (!cache_) {
+        return false;
+    }
+    return DNSCachePersistor::save(*cache_, filename);
+}
+
+bool DNSResolver::load_cache(const std::string &filename) {
+    if (!cache_) {
+        return false;
+    }
+    return DNSCachePersistor::load(*cache_, filename);
+}
+
+bool DNSResolver::warmup(const std::string &filename, const CacheConfig &cache_config) {
+    if (!initialized_) {
+        return false;
+    }
+    warming_ = true;
+    metrics_->setReady(false);
+    auto options = DNSCacheWarmer::fromConfig(cache_config);
+    options.split_families = split_families();
+    DNSCacheWarmer warmer(
+            [this](const std::string &hostname, ResolveCallback callback) {
+                resolve_async(hostname, std::move(callback));
+            },
+            cache_, metrics_, options);
+    const bool loaded = warmer.loadFile(filename);
+    if (loaded) {
+        warmer.run();
+    }
+    warming_ = false;
+    metrics_->setReady(true);
+    return loaded;
+}
+
+bool DNSResolver::is_ready() const {
+    return initialized_ && !warming_.load(std::memory_order_relaxed);
+}
+
+std::shared_ptr<DNSCache> DNSResolver::getCache() const {
+    return cache_;
+}
+
+std::shared_ptr<DNSMetrics> DNSResolver::getMetrics() const {
+    return metrics_;
+}
+
+DNSMetrics::Stats DNSResolver::getStats() const {
+    if (metrics_) {
+        return metrics_->getStats();
+    }
+    return {};
+}
+
+std::vector<DNSUpstreamSelector::UpstreamStats> DNSResolver::getUpstreamStats() const {
+    return selector_.stats();
+}
+
+void DNSResolver::socket_callback(void *data, ares_socket_t socket_fd, int readable, int writable) {
+    const auto *upstream = static_cast<Upstream *>(data);
+    upstream->resolver->event_loop_->updateSocket(upstream->channel, socket_fd, readable != 0, writable != 0);
+}
+
+bool DNSResolver::is_server_failure(int status) {
+    switch (status) {
+        case ARES_ETIMEOUT:
+        case ARES_ECONNREFUSED:
+        case ARES_ESERVFAIL:
+        case ARES_EREFUSED:
+        case ARES_EBADRESP:
+        case ARES_EFORMERR:
+        case ARES_ENOTIMP:
+        case ARES_EOF:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void DNSResolver::addrinfo_callback(void *arg, int status, int timeouts, struct ares_addrinfo *result) {
+    auto *context = static_cast<QueryContext *>(arg);
+    const bool completed = context->resolver->process_result(context, status, result);
+    if (result) {
+        ares_freeaddrinfo(result);
+    }
+    if (completed) {
+        context->resolver->context_pool_.release(context);
+    }
+}
+
+void DNSResolver::dnsrec_callback(void *arg, ares_status_t status, size_t timeouts, const ares_dns_record_t *dnsrec) {
+    // dnsrec由c-ares在回调返回后释放
+    auto *context = static_cast<QueryContext *>(arg);
+    if (context->resolver->process_result(context, status, nullptr, dnsrec)) {
+        context->resolver->context_pool_.release(context);
+    }
+}
+
+bool DNSResolver::process_result(QueryContext *context, int status, const ares_addrinfo *result,
+                                 const ares_dns_record_t *dnsrec) {
+    auto end_time = std::chrono::steady_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - context->start_time);
+    if (auto *span = span_of(context)) [[unlikely]] {
+        span->events.push_back({DNSTraceEvent::Kind::Answer, end_time, context->upstream, status});
+    }
+
+    // 重建channel时被销毁的查询：下标属于旧的上游列表，不计入统计
+    const bool migrated = status == ARES_EDESTRUCTION && migrating_;
+    // 上游统计：RTT只计本次发送，不含之前的重试与切换
+    const bool abandoned = status == ARES_EDESTRUCTION || status == ARES_ECANCELLED;
+    const bool server_ok = !abandoned && !is_server_failure(status);
+    if (abandoned) {
+        if (!migrated) {
+            selector_.onAbandon(context->upstream);
+        }
+    } else {
+        const auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(end_time - context->sent_time);
+        selector_.onResult(context->upstream, server_ok, rtt);
+        const std::string server = selector_.name(context->upstream);
+        metrics_->recordServerQuery(server, server_ok);
+        if (server_ok) {
+            metrics_->recordServerLatency(server, rtt);
+        }
+    }
+
+    // 对冲的另一方已经给出结果（c-ares无法取消单个查询，只能丢弃这次应答）
+    if (context->cancelled) {
+        return true;
+    }
+    // 另一方仍在途时，本次失败交由它给出结果
+    if (!server_ok && context->peer) {
+        if (context->span) {
+            context->peer->span = std::exchange(context->span, nullptr);
+        }
+        context->peer->peer = nullptr;
+        return true;
+    }
+    if (migrated) {
+        // 转到新channel重新发送，不占用重试预算；新旧上游下标不对应，所有上游重新参与选择
+        context->tried = 0;
+        issue_query(context);
+        return false;
+    }
+    if (!abandoned && !server_ok && selector_.hasAlternative(context->tried)) {
+        // 上游故障时立即切换到本轮尚未尝试的上游，不占用重试预算
+        metrics_->recordError("upstream_failure", status);
+        issue_query(context);
+        return false;
+    }
+
+    ResolveResult resolve_result;
+    resolve_result.hostname.assign(context->hostname(), context->hostname_length);
+    resolve_result.status = status;
+    resolve_result.resolution_time = duration;
+    const std::string &hostname = resolve_result.hostname;
+
+    // 本次应答胜出：取消尚未触发的对冲，另一方的应答到达时丢弃
+    cancel_hedge(context);
+    if (context->peer) {
+        if (context->peer->span) {
+            context->span = std::exchange(context->peer->span, nullptr);
+        }
+        context->peer->cancelled = true;
+        context->peer->peer = nullptr;
+        context->peer = nullptr;
+        if (context->hedge) {
+            metrics_->recordHedgeWin(hostname);
+        }
+    }
+
+    // 分地址族查询的结果按地址族分别缓存，类型化记录按记录类型缓存
+    const std::string key = context->record_type != 0
+                                    ? record_key(hostname, static_cast<DNSRecordType>(context->record_type))
+                                    : cache_key(hostname, context->family);
+
+    bool answered = false;
+    if (context->record_type != 0) {
+        status = parse_records(static_cast<DNSRecordType>(context->record_type), hostname, status, dnsrec,
+                               resolve_result);
+        resolve_result.status = status;
+        if (status == ARES_SUCCESS) {
+            answered = true;
+            cache_->update(key, resolve_result.records, resolve_result.ttl);
+        }
+    } else if (status == ARES_SUCCESS && result) {
+        answered = true;
+        // 比较用的旧值不计为缓存命中
+        DNSAddressList old_addresses;
+        if (const auto old_record = cache_->peek(key)) {
+            old_addresses = old_record->ip_addresses;
+        }
+        // 记录的TTL取所有应答中的最小值
+        int min_ttl = -1;
+        for (struct ares_addrinfo_node *node = result->nodes;
+             node != nullptr;
+             node = node->ai_next) {
+
+            // 直接保存二进制地址，文本形式在需要时才生成
+            if (const auto address = DNSAddress::fromSockaddr(node->ai_addr)) {
+                resolve_result.ip_addresses.push_back(*address);
+                if (min_ttl < 0 || node->ai_ttl < min_ttl) {
+                    min_ttl = node->ai_ttl;
+                }
+            }
+        }
+
+        // 更新缓存
+        if (!resolve_result.ip_addresses.empty()) {
+            const auto ttl = std::chrono::seconds(std::max(min_ttl, 0));
+            resolve_result.ttl = ttl;
+            cache_->update(key, resolve_result.ip_addresses, ttl);
+
+            // 检查地址是否发生变化
+            if (old_addresses != resolve_result.ip_addresses) {
+                notifyAddressChange(hostname, context->family, old_addresses, resolve_result.ip_addresses, "query",
+                                    ttl);
+            }
+        }
+    }
+    if (!answered) {
+        // 处理错误
+        metrics_->recordError("resolution_failure", status);
+        if (status == ARES_ENOTFOUND || status == ARES_ENODATA) {
+            // 否定应答按否定TTL缓存，同名的正向记录随之失效；getaddrinfo不返回SOA，类型化查询使用SOA给出的TTL
+            const auto kind = status == ARES_ENOTFOUND ? DNSNegativeKind::NXDomain : DNSNegativeKind::NoData;
+            if (resolve_result.ttl > std::chrono::seconds(0)) {
+                cache_->updateNegative(key, kind, resolve_result.ttl);
+            } else {
+                cache_->updateNegative(key, kind);
+            }
+        }
+        // 重试由事件循环的定时器在退避后发起，不阻塞同一channel上的其他查询
+        std::chrono::milliseconds delay{};
+        if (retry_policy_.shouldRetry(status, context->attempt + 1, delay)) {
+            ++context->attempt;
+            metrics_->recordRetry(hostname, context->attempt);
+            {
+                // 定时器可能在记录id之前就在I/O线程触发，因此先登记再调度
+                std::lock_guard<std::mutex> lock(mutex_);
+                retrying_queries_[context] = 0;
+            }
+            const auto timer = event_loop_->schedule(delay, [this, context] { retry_query(context); });
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (const auto it = retrying_queries_.find(context); it != retrying_queries_.end()) {
+                    it->second = timer;
+                }
+            }
+            return false;// 查询尚未结束，等待者继续等待
+        }
+    }
+
+    metrics_->recordQuery(hostname, std::chrono::duration_cast<std::chrono::microseconds>(end_time - context->start_time),
+                          status == ARES_SUCCESS);
+
+    complete_query(context, std::move(resolve_result));
+    return true;
+}
+
+int DNSResolver::parse_records(DNSRecordType type, const std::string &hostname, int status,
+                               const ares_dns_record_t *dnsrec, ResolveResult &result) {
+    result.records.reset();
+    result.ttl = std::chrono::seconds(0);
+    if (!dnsrec) {
+        return status;
+    }
+    if (status == ARES_ENOTFOUND || status == ARES_ENODATA) {
+        result.ttl = negative_ttl(dnsrec);
+        return status;
+    }
+    if (status != ARES_SUCCESS) {
+        return status;
+    }
+
+    auto records = std::make_shared<DNSRecordSet>();
+    records->type = type;
+    records->received = std::chrono::system_clock::now();
+    const size_t count = ares_dns_record_rr_cnt(dnsrec, ARES_SECTION_ANSWER);
+    uint32_t min_ttl = UINT32_MAX;
+
+    // 沿CNAME链找到记录的所有者，链长不超过应答中的记录数，环形的链因此也会结束
+    std::string owner = hostname;
+    for (size_t hop = 0; type != DNSRecordType::CNAME && hop < count; ++hop) {
+        const ares_dns_rr_t *alias = nullptr;
+        for (size_t i = 0; i < count && !alias; ++i) {
+            const auto *rr = ares_dns_record_rr_get_const(dnsrec, ARES_SECTION_ANSWER, i);
+            if (ares_dns_rr_get_type(rr) == ARES_REC_TYPE_CNAME && canonical_name(ares_dns_rr_get_name(rr)) == owner) {
+                alias = rr;
+            }
+        }
+        if (!alias) {
+            break;
+        }
+        auto &cname = records->cname_chain.emplace_back();
+        read_rdata(alias, cname);
+        min_ttl = std::min(min_ttl, static_cast<uint32_t>(cname.ttl.count()));
+        owner = cname.target;
+    }
+
+    const auto collect = [&]<typename Record>(std::vector<Record> &out) {
+        for (size_t i = 0; i < count; ++i) {
+            const auto *rr = ares_dns_record_rr_get_const(dnsrec, ARES_SECTION_ANSWER, i);
+            if (ares_dns_rr_get_type(rr) != static_cast<ares_dns_rec_type_t>(type) ||
+                canonical_name(ares_dns_rr_get_name(rr)) != owner) {
+                continue;
+            }
+            read_rdata(rr, out.emplace_back());
+            min_ttl = std::min(min_ttl, static_cast<uint32_t>(out.back().ttl.count()));
+        }
+        return !out.empty();
+    };
+    bool found = false;
+    switch (type) {
+        case DNSRecordType::SRV:
+            found = collect(records->records.emplace<std::vector<DNSSrvRecord>>());
+            break;
+        case DNSRecordType::TXT:
+            found = collect(records->records.emplace<std::vector<DNSTxtRecord>>());
+            break;
+        case DNSRecordType::CNAME:
+            found = collect(records->records.emplace<std::vector<DNSCnameRecord>>());
+            break;
+    }
+    // 只有别名而没有所查询类型的记录：链的终点没有该类型的记录
+    if (!found) {
+        result.ttl = negative_ttl(dnsrec);
+        return ARES_ENODATA;
+    }
+    result.ttl = std::chrono::seconds(min_ttl);
+    result.records = std::move(records);
+    return ARES_SUCCESS;
+}
+
+std::string DNSResolver::canonical_name(const char *name) {
+    return DNSHostname::canonicalize(std::string_view(name ? name : ""));
+}
+
+std::chrono::seconds DNSResolver::negative_ttl(const ares_dns_record_t *dnsrec) {
+    // RFC 2308：否定应答的TTL取权威段中SOA记录的TTL与MINIMUM中较小者
+    for (size_t i = 0; i < ares_dns_record_rr_cnt(dnsrec, ARES_SECTION_AUTHORITY); ++i) {
+        const auto *rr = ares_dns_record_rr_get_const(dnsrec, ARES_SECTION_AUTHORITY, i);
+        if (ares_dns_rr_get_type(rr) == ARES_REC_TYPE_SOA) {
+            return std::chrono::seconds(std::min(ares_dns_rr_get_ttl(rr), ares_dns_rr_get_u32(rr, ARES_RR_SOA_MINIMUM)));
+        }
+    }
+    return std::chrono::seconds(0);
+}
+
+void DNSResolver::read_rdata(const ares_dns_rr_t *rr, DNSSrvRecord &record) {
+    record.priority = ares_dns_rr_get_u16(rr, ARES_RR_SRV_PRIORITY);
+    record.weight = ares_dns_rr_get_u16(rr, ARES_RR_SRV_WEIGHT);
+    record.port = ares_dns_rr_get_u16(rr, ARES_RR_SRV_PORT);
+    record.target = canonical_name(ares_dns_rr_get_str(rr, ARES_RR_SRV_TARGET));
+    record.ttl = std::chrono::seconds(ares_dns_rr_get_ttl(rr));
+}
+
+void DNSResolver::read_rdata(const ares_dns_rr_t *rr, DNSTxtRecord &record) {
+    const size_t count = ares_dns_rr_get_abin_cnt(rr, ARES_RR_TXT_DATA);
+    record.strings.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t length = 0;
+        const unsigned char *data = ares_dns_rr_get_abin(rr, ARES_RR_TXT_DATA, i, &length);
+        record.strings.emplace_back(reinterpret_cast<const char *>(data), data ? length : 0);
+    }
+    record.ttl = std::chrono::seconds(ares_dns_rr_get_ttl(rr));
+}
+
+void DNSResolver::read_rdata(const ares_dns_rr_t *rr, DNSCnameRecord &record) {
+    record.name = canonical_name(ares_dns_rr_get_name(rr));
+    record.target = canonical_name(ares_dns_rr_get_str(rr, ARES_RR_CNAME_CNAME));
+    record.ttl = std::chrono::seconds(ares_dns_rr_get_ttl(rr));
+}
+
+void DNSResolver::complete_query(QueryContext *context, ResolveResult &&result) {
+    if (DNS_TRACING_ENABLED && context->span) [[unlikely]] {
+        std::unique_ptr<DNSQuerySpan> span(std::exchange(context->span, nullptr));
+        span->end = std::chrono::steady_clock::now();
+        span->status = result.status;
+        span->attempts = context->attempt;
+        span->upstream = selector_.name(context->upstream);
+        export_span(*span);
+    }
+
+    std::vector<ResolveCallback> waiters;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = pending_queries_.find(context->key());
+        if (it != pending_queries_.end()) {
+            waiters = std::move(it->second);
+            pending_queries_.erase(it);
+        }
+    }
+
+    // 一次上游应答同时满足所有等待者
+    for (const auto &callback: waiters) {
+        try {
+            callback(result);
+        } catch (const std::exception &e) {
+            std::cerr << "Error executing resolve callback for " << result.hostname
+                      << ": " << e.what() << std::endl;
+        }
+    }
+}
+
+void DNSResolver::setTraceExporter(DNSTraceExporter exporter) {
+    trace_exporter_.store(exporter ? std::make_shared<const DNSTraceExporter>(std::move(exporter)) : nullptr,
+                          std::memory_order_release);
+    tracing_.store(trace_exporter_.load(std::memory_order_relaxed) != nullptr, std::memory_order_relaxed);
+}
+
+void DNSResolver::trace_event(const QueryContext *context, DNSTraceEvent::Kind kind, int status) {
+    if (auto *span = span_of(context)) [[unlikely]] {
+        span->events.push_back({kind, std::chrono::steady_clock::now(), context->upstream, status});
+    }
+}
+
+std::unique_ptr<DNSQuerySpan> DNSResolver::trace_lookup(const std::string &hostname, uint16_t record_type,
+                                                        std::chrono::steady_clock::time_point start,
+                                                        const ResolveResult *hit) const {
+    auto span = std::make_unique<DNSQuerySpan>();
+    span->hostname = hostname;
+    span->record_type = record_type;
+    span->start = start;
+    span->end = std::chrono::steady_clock::now();
+    span->events.push_back({DNSTraceEvent::Kind::CacheLookup, span->end});
+    if (hit) {
+        span->status = hit->status;
+        span->cache_hit = true;
+        export_span(*span);
+    }
+    return span;
+}
+
+void DNSResolver::export_span(const DNSQuerySpan &span) const {
+    const auto exporter = trace_exporter_.load(std::memory_order_acquire);
+    if (!exporter) {
+        return;// 查询途中关闭了追踪
+    }
+    try {
+        (*exporter)(span);
+    } catch (const std::exception &e) {
+        std::cerr << "Trace exporter failed for " << span.hostname << ": " << e.what() << std::endl;
+    }
+}
+
+void DNSResolver::notifyAddressChange(const std::string &hostname, int family, const DNSAddressList &old_addresses,
+                                      const DNSAddressList &new_addresses, const std::string &source,
+                                      std::chrono::seconds ttl) {
+    // 每个地址族单独产生事件，只比较本次查询覆盖的地址族
+    for (const int record_family: {AF_INET, AF_INET6}) {
+        if (family != AF_UNSPEC && family != record_family) {
+            continue;
+        }
+        DNSAddressList old_records;
+        DNSAddressList new_records;
+        for (const auto &address: old_addresses) {
+            if (address.family() == record_family) {
+                old_records.push_back(address);
+            }
+        }
+        for (const auto &address: new_addresses) {
+            if (address.family() == record_family) {
+                new_records.push_back(address);
+            }
+        }
+        if (old_records == new_records) {
+            continue;
+        }
+
+        DNSAddressEvent event;
+        event.hostname = hostname;
+        event.old_addresses = old_records.toStrings();
+        event.new_addresses = new_records.toStrings();
+        event.timestamp = std::chrono::system_clock::now();
+        event.source = source;
+        event.ttl = static_cast<uint32_t>(ttl.count());
+        event.record_type = record_family == AF_INET6 ? "AAAA" : "A";
+        event.is_authoritative = false;// 需要从DNS响应中获取
+
+        DNSEventManager::getInstance().notifyAddressChanged(event);
+    }
+}
@@ -0,0 +1,335 @@
+#include "DNSResolverPool.h"
+#include "DNSBatchWindow.h"
+#include "DNSCachePersistor.h"
+#include "DNSCacheWarmer.h"
+#include "DNSConfigValidator.h"
+#include "DNSHostname.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+DNSResolverPool::DNSResolverPool(size_t size) {
+    if (size == 0) {
+        size = std::max(1u, std::thread::hardware_concurrency());
+    }
+    metrics_ = std::make_shared<DNSMetrics>();
+    resolvers_.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        resolvers_.push_back(std::make_shared<DNSResolver>());
+    }
+}
+
+DNSResolverPool::~DNSResolverPool() {
+    const auto config = config_.load();
+    const bool save = cache_ && !journal_ && config && config->cache().persistent;
+    shutdown();
+    // 成员的查询都已结束后再保存缓存（如果配置了持久化）
+    if (save) {
+        [[maybe_unused]] auto ret = save_cache(config->cache().cache_file);
+    }
+}
+
+void DNSResolverPool::shutdown() {
+    // 先停止预取，避免其向正在关闭的成员提交查询
+    if (prefetcher_) {
+        prefetcher_->stop();
+        prefetcher_.reset();
+    }
+    for (const auto &resolver: resolvers_) {
+        resolver->shutdown();
+    }
+    // 成员的查询都已结束，最后一次检查点包含全部写入
+    if (journal_) {
+        journal_->stop();
+        journal_.reset();
+    }
+    if (cache_) {
+        cache_->stopExpiryThread();
+    }
+}
+
+bool DNSResolverPool::init(const std::vector<std::string> &dns_servers, const CacheConfig &cache_config) {
+    shutdown();
+    return init_members(DNSResolver::toServerConfigs(dns_servers), cache_config);
+}
+
+bool DNSResolverPool::init_members(const std::vector<DNSServerConfig> &servers, const CacheConfig &cache_config) {
+    cache_ = std::make_shared<DNSCache>(cache_config);
+    cache_->startExpiryThread();
+
+    for (const auto &resolver: resolvers_) {
+        if (!resolver->init(servers, cache_, metrics_)) {
+            return false;
+        }
+    }
+
+    // 预取请求同样按主机名路由，保证与普通查询落在同一成员上合并
+    if (cache_config.prefetch_enabled) {
+        prefetcher_ = std::make_shared<DNSPrefetcher>(
+                [this](const std::string &hostname) { resolverFor(hostname).prefetch(hostname); },
+                cache_config.prefetch_max_qps);
+        cache_->setRefreshCallback(
+                [weak = std::weak_ptr<DNSPrefetcher>(prefetcher_)](const std::string &hostname, uint32_t hits) {
+                    if (auto prefetcher = weak.lock()) {
+                        prefetcher->enqueue(hostname, hits);
+                    }
+                },
+                cache_config.prefetch_threshold);
+        prefetcher_->start();
+    }
+    metrics_->setReady(!warming_);
+    return true;
+}
+
+bool DNSResolverPool::loadConfig(const DNSResolverConfig &config) {
+    try {
+        // 验证配置
+        DNSConfigValidator::validate(config);
+        // 获取启用的DNS服务器
+        std::vector<DNSServerConfig> active_servers;
+        for (const auto &server: config.servers()) {
+            if (server.enabled) {
+                active_servers.push_back(server);
+            }
+        }
+        shutdown();
+        warming_ = !config.cache().warmup_file.empty();
+        if (!init_members(active_servers, config.cache())) {
+            return false;
+        }
+        for (const auto &resolver: resolvers_) {
+            resolver->applyConfig(config);
+        }
+        // 配置指标收集（所有成员共用一个导出端点）
+        if (config.metrics().enabled) {
+            metrics_->startPrometheusExporter(config.metrics().prometheus_address);
+        }
+        // 加载持久化缓存；启用日志时重放快照之后的写入，并在后台定期做检查点
+        if (config.cache().enabled && config.cache().persistent) {
+            if (config.cache().journal_enabled) {
+                journal_ = std::make_unique<DNSCacheJournal>(cache_, config.cache());
+                journal_->recover();
+                journal_->start();
+            } else {
+                load_cache(config.cache().cache_file);
+            }
+        }
+        config_.store(std::make_shared<const DNSResolverConfig>(config));
+        if (warming_) {
+            warmup(config.cache().warmup_file, config.cache());
+        }
+    } catch (const ConfigValidationError &e) {
+        std::cerr << "Configuration validation error: " << e.what() << std::endl;
+        return false;
+    } catch (const std::exception &e) {
+        std::cerr << "Error loading configuration: " << e.what() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool DNSResolverPool::loadConfig(const std::string &config_file) {
+    try {
+        auto &config = DNSResolverConfig::getInstance();
+        if (!config.loadFromFile(config_file) || !loadConfig(config)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(reload_mutex_);
+        config_file_ = config_file;
+        return true;
+    } catch (const std::exception &e) {
+        std::cerr << "Error loading configuration file: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DNSResolverPool::reloadConfig() {
+    std::string config_file;
+    {
+        std::lock_guard<std::mutex> lock(reload_mutex_);
+        config_file = config_file_;
+    }
+    if (config_file.empty()) {
+        std::cerr << "No configuration file to reload" << std::endl;
+        return false;
+    }
+    try {
+        DNSResolverConfig config;
+        if (!config.loadFromFile(config_file)) {
+            return false;
+        }
+        return reloadConfig(config);
+    } catch (const std::exception &e) {
+        std::cerr << "Error reloading configuration file: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DNSResolverPool::reloadConfig(const DNSResolverConfig &config, std::vector<std::string> *differences) {
+    std::lock_guard<std::mutex> lock(reload_mutex_);
+    if (!config_.load()) {
+        std::cerr << "Resolver pool is not configured, use loadConfig() first" << std::endl;
+        return false;
+    }
+    // 成员可能需要重建channel，期间暂停预取
+    if (prefetcher_) {
+        prefetcher_->stop();
+    }
+    bool ok = true;
+    for (size_t i = 0; i < resolvers_.size(); ++i) {
+        if (!resolvers_[i]->reloadConfig(config, differences)) {
+            // 已更新的成员恢复为当前配置，避免不同主机名按散列落到不同的上游集合
+            const auto current = config_.load();
+            for (size_t j = 0; j < i; ++j) {
+                if (!resolvers_[j]->reloadConfig(*current)) {
+                    std::cerr << "Failed to roll back resolver " << j << " to the previous configuration" << std::endl;
+                }
+            }
+            ok = false;
+            break;
+        }
+    }
+    if (ok) {
+        cache_->reconfigure(config.cache());
+        if (prefetcher_) {
+            prefetcher_->setRate(config.cache().prefetch_max_qps);
+        }
+        config_.store(std::make_shared<const DNSResolverConfig>(config));
+    }
+    if (prefetcher_) {
+        prefetcher_->start();
+    }
+    return ok;
+}
+
+std::future<DNSResolverPool::ResolveResult> DNSResolverPool::resolve(const std::string &hostname) {
+    return resolverFor(hostname).resolve(hostname);
+}
+
+void DNSResolverPool::resolve_async(const std::string &hostname, ResolveCallback callback) {
+    resolverFor(hostname).resolve_async(hostname, std::move(callback));
+}
+
+DNSResolver::ResolveAwaitable DNSResolverPool::resolve_co(const std::string &hostname) {
+    return resolverFor(hostname).resolve_co(hostname);
+}
+
+void DNSResolverPool::resolve_dual_stack(const std::string &hostname, DNSResolver::DualStackCallback callback) {
+    resolverFor(hostname).resolve_dual_stack(hostname, std::move(callback));
+}
+
+void DNSResolverPool::resolve_records_async(const std::string &name, DNSRecordType type, ResolveCallback callback) {
+    resolverFor(name).resolve_records_async(name, type, std::move(callback));
+}
+
+std::future<DNSResolverPool::ResolveResult> DNSResolverPool::refresh(const std::string &hostname) {
+    return resolverFor(hostname).refresh(hostname);
+}
+
+std::vector<std::future<DNSResolverPool::ResolveResult>> DNSResolverPool::resolve_batch(
+        const std::vector<std::string> &hostnames, size_t max_in_flight) {
+    // 成员解析器由shared_ptr持有，窗口状态中的回调捕获成员而不是池本身
+    return DNSBatchWindow::batch(
+            [resolvers = resolvers_](const std::string &hostname, ResolveCallback callback) {
+                resolvers[indexFor(hostname, resolvers.size())]->resolve_async(hostname, std::move(callback));
+            },
+            hostnames, max_in_flight > 0 ? max_in_flight : default_window());
+}
+
+void DNSResolverPool::resolve_stream(const HostnameSource &source, const ResolveCallback &on_result,
+                                     size_t max_in_flight) {
+    DNSBatchWindow::stream(
+            [this](const std::string &hostname, ResolveCallback callback) {
+                resolve_async(hostname, std::move(callback));
+            },
+            source, on_result, max_in_flight > 0 ? max_in_flight : default_window());
+}
+
+size_t DNSResolverPool::default_window() const {
+    const auto config = config_.load();
+    return config ? config->max_concurrent_queries() : 100;
+}
+
+DNSResolver &DNSResolverPool::resolverFor(const std::string &hostname) const {
+    return *resolvers_[indexFor(hostname, resolvers_.size())];
+}
+
+size_t DNSResolverPool::indexFor(const std::string &hostname, size_t count) {
+    // 与缓存分片使用不同的散列位，避免每个成员只对应部分分片；按规范形式散列，大小写不同的主机名落在同一成员
+    std::string canonical;
+    const auto h = static_cast<uint64_t>(DNSHostname::hashOf(DNSHostname::canonicalize(hostname, canonical)));
+    return static_cast<size_t>((h * 0x9E3779B97F4A7C15ull) >> 40) % count;
+}
+
+size_t DNSResolverPool::size() const {
+    return resolvers_.size();
+}
+
+void DNSResolverPool::clear_cache() {
+    if (cache_) {
+        cache_->clear();
+    }
+}
+
+bool DNSResolverPool::save_cache(const std::string &filename) const {
+    if (!cache_) {
+        return false;
+    }
+    return DNSCachePersistor::save(*cache_, filename);
+}
+
+bool DNSResolverPool::load_cache(const std::string &filename) {
+    if (!cache_) {
+        return false;
+    }
+    return DNSCachePersistor::load(*cache_, filename);
+}
+
+bool DNSResolverPool::warmup(const std::string &filename, const CacheConfig &cache_config) {
+    if (!cache_) {
+        return false;
+    }
+    warming_ = true;
+    metrics_->setReady(false);
+    auto options = DNSCacheWarmer::fromConfig(cache_config);
+    const auto config = config_.load();
+    options.split_families = config && config->ipv6_enabled() && config->split_family_queries();
+    DNSCacheWarmer warmer(
+            [this](const std::string &hostname, ResolveCallback callback) {
+                resolve_async(hostname, std::move(callback));
+            },
+            cache_, metrics_, options);
+    const bool loaded = warmer.loadFile(filename);
+    if (loaded) {
+        warmer.run();
+    }
+    warming_ = false;
+    metrics_->setReady(true);
+    return loaded;
+}
+
+bool DNSResolverPool::is_ready() const {
+    return cache_ && !warming_.load(std::memory_order_relaxed) &&
+           std::all_of(resolvers_.begin(), resolvers_.end(),
+                       [](const std::shared_ptr<DNSResolver> &resolver) { return resolver->is_ready(); });
+}
+
+std::shared_ptr<DNSCache> DNSResolverPool::getCache() const {
+    return cache_;
+}
+
+std::shared_ptr<DNSMetrics> DNSResolverPool::getMetrics() const {
+    return metrics_;
+}
+
+DNSMetrics::Stats DNSResolverPool::getStats() const {
+    return metrics_->getStats();
+}
+
+void DNSResolverPool::setTraceExporter(const DNSTraceExporter &exporter) {
+    for (const auto &resolver: resolvers_) {
+        resolver->setTraceExporter(exporter);
+    }
+}
@@ -0,0 +1,131 @@
+#include "DNSRetryPolicy.h"
+
+#include <algorithm>
+#include <ares.h>
+#include <random>
+
+namespace {
+    // 预算最多累积的秒数，防止长时间空闲后突发大量重试
+    constexpr double BUDGET_WINDOW_SEC = 10.0;
+    // 对冲预算最多累积的查询数
+    constexpr double HEDGE_BURST_QUERIES = 1000.0;
+}// namespace
+
+DNSRetryPolicy::DNSRetryPolicy() = default;
+
+void DNSRetryPolicy::configure(const RetryConfig &config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    enabled_ = config.max_attempts > 0;
+    max_tokens_ = std::max(1.0, config.budget_min_per_sec * BUDGET_WINDOW_SEC);
+    tokens_ = std::min(tokens_, max_tokens_);
+    last_refill_ = std::chrono::steady_clock::now();
+    max_hedge_tokens_ = config.hedge_enabled ? std::max(1.0, config.hedge_budget_ratio * HEDGE_BURST_QUERIES) : 0.0;
+    hedge_tokens_ = std::min(hedge_tokens_, max_hedge_tokens_);
+}
+
+void DNSRetryPolicy::recordQuery() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tokens_ = std::min(max_tokens_, tokens_ + config_.budget_ratio);
+    hedge_tokens_ = std::min(max_hedge_tokens_, hedge_tokens_ + config_.hedge_budget_ratio);
+}
+
+bool DNSRetryPolicy::shouldRetry(int status, uint32_t attempt, std::chrono::milliseconds &delay) {
+    if (!isRetryable(status)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!enabled_ || attempt == 0 || attempt > config_.max_attempts) {
+        return false;
+    }
+    refill(std::chrono::steady_clock::now());
+    if (tokens_ < 1.0) {
+        ++exhausted_;
+        return false;
+    }
+    tokens_ -= 1.0;
+    delay = backoff(attempt);
+    return true;
+}
+
+uint64_t DNSRetryPolicy::budgetExhausted() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return exhausted_;
+}
+
+bool DNSRetryPolicy::hedgeEnabled(std::string_view hostname) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!enabled_ || !config_.hedge_enabled) {
+        return false;
+    }
+    if (config_.hedge_domains.empty()) {
+        return true;
+    }
+    // 域名本身或其子域
+    for (const auto &domain: config_.hedge_domains) {
+        if (hostname.size() == domain.size() ? hostname == domain
+                                             : hostname.size() > domain.size() && hostname.ends_with(domain) &&
+                                                       hostname[hostname.size() - domain.size() - 1] == '.') {
+            return true;
+        }
+    }
+    return false;
+}
+
+double DNSRetryPolicy::hedgePercentile() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_.hedge_percentile;
+}
+
+std::chrono::milliseconds DNSRetryPolicy::hedgeDelay(std::chrono::microseconds rtt_percentile) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (rtt_percentile.count() <= 0) {
+        return std::chrono::milliseconds(config_.hedge_max_delay_ms);
+    }
+    const auto delay = std::chrono::ceil<std::chrono::milliseconds>(rtt_percentile);
+    return std::clamp(delay, std::chrono::milliseconds(config_.hedge_min_delay_ms),
+                      std::chrono::milliseconds(config_.hedge_max_delay_ms));
+}
+
+bool DNSRetryPolicy::tryHedge() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (hedge_tokens_ < 1.0) {
+        return false;
+    }
+    hedge_tokens_ -= 1.0;
+    return true;
+}
+
+bool DNSRetryPolicy::isRetryable(int status) {
+    switch (status) {
+        case ARES_SUCCESS:
+        case ARES_ENODATA:
+        case ARES_ENOTFOUND:
+        case ARES_EBADNAME:
+        case ARES_EBADFAMILY:
+        case ARES_ECANCELLED:
+        case ARES_EDESTRUCTION:
+        case ARES_ENOTINITIALIZED:
+            return false;
+        default:
+            return true;
+    }
+}
+
+void DNSRetryPolicy::refill(std::chrono::steady_clock::time_point now) {
+    // 保底额度按时间补充
+    const double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+    tokens_ = std::min(max_tokens_, tokens_ + elapsed * config_.budget_min_per_sec);
+    last_refill_ = now;
+}
+
+std::chrono::milliseconds DNSRetryPolicy::backoff(uint32_t attempt) const {
+    // 等量抖动：在[d/2, d]内均匀取值，d为按指数增长并受max_delay_ms限制的退避时间
+    const uint32_t shift = std::min<uint32_t>(attempt - 1, 16);
+    const uint64_t exp_delay = std::min<uint64_t>(static_cast<uint64_t>(config_.base_delay_ms) << shift,
+                                                  config_.max_delay_ms);
+    thread_local std::minstd_rand rng{std::random_device{}()};
+    std::uniform_int_distribution<uint64_t> dist(exp_delay / 2, exp_delay);
+    return std::chrono::milliseconds(dist(rng));
+}
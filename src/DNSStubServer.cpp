@@ -0,0 +1,789 @@
+#include "DNSStubServer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32)
+#define DNS_STUB_SERVER_UNSUPPORTED
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__linux__)
+#define DNS_STUB_SERVER_MMSG
+#endif
+#endif
+
+#if defined(MSG_NOSIGNAL)
+#define DNS_STUB_SEND_FLAGS (MSG_NOSIGNAL | MSG_DONTWAIT)
+#else
+#define DNS_STUB_SEND_FLAGS MSG_DONTWAIT
+#endif
+
+namespace {
+    constexpr size_t HEADER_SIZE = 12;
+    constexpr size_t MAX_NAME_SIZE = 255;
+    constexpr size_t MAX_QUESTION_SIZE = MAX_NAME_SIZE + 4;
+    constexpr size_t MIN_UDP_PAYLOAD = 512;
+
+    constexpr uint16_t TYPE_A = 1;
+    constexpr uint16_t TYPE_AAAA = 28;
+    constexpr uint16_t TYPE_OPT = 41;
+    constexpr uint16_t CLASS_IN = 1;
+
+    constexpr int RCODE_NOERROR = 0;
+    constexpr int RCODE_FORMERR = 1;
+    constexpr int RCODE_SERVFAIL = 2;
+    constexpr int RCODE_NXDOMAIN = 3;
+    constexpr int RCODE_NOTIMP = 4;
+    constexpr int RCODE_REFUSED = 5;
+
+    constexpr uint16_t FLAG_QR = 0x8000;
+    constexpr uint16_t FLAG_TC = 0x0200;
+    constexpr uint16_t FLAG_RD = 0x0100;
+    constexpr uint16_t FLAG_RA = 0x0080;
+
+    // 接收超时，工作线程借此检查停止标志
+    constexpr int POLL_INTERVAL_MS = 100;
+
+    uint16_t read16(const uint8_t *p) {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    void write16(uint8_t *p, uint16_t value) {
+        p[0] = static_cast<uint8_t>(value >> 8);
+        p[1] = static_cast<uint8_t>(value);
+    }
+
+    void write32(uint8_t *p, uint32_t value) {
+        p[0] = static_cast<uint8_t>(value >> 24);
+        p[1] = static_cast<uint8_t>(value >> 16);
+        p[2] = static_cast<uint8_t>(value >> 8);
+        p[3] = static_cast<uint8_t>(value);
+    }
+
+    bool parseAddress(const std::string &address, uint16_t port, sockaddr_storage &out, socklen_t &out_len) {
+        std::memset(&out, 0, sizeof(out));
+        auto *v4 = reinterpret_cast<sockaddr_in *>(&out);
+        if (inet_pton(AF_INET, address.c_str(), &v4->sin_addr) == 1) {
+            v4->sin_family = AF_INET;
+            v4->sin_port = htons(port);
+            out_len = sizeof(sockaddr_in);
+            return true;
+        }
+        auto *v6 = reinterpret_cast<sockaddr_in6 *>(&out);
+        if (inet_pton(AF_INET6, address.c_str(), &v6->sin6_addr) == 1) {
+            v6->sin6_family = AF_INET6;
+            v6->sin6_port = htons(port);
+            out_len = sizeof(sockaddr_in6);
+            return true;
+        }
+        return false;
+    }
+
+    void setPort(sockaddr_storage &address, uint16_t port) {
+        if (address.ss_family == AF_INET) {
+            reinterpret_cast<sockaddr_in *>(&address)->sin_port = htons(port);
+        } else {
+            reinterpret_cast<sockaddr_in6 *>(&address)->sin6_port = htons(port);
+        }
+    }
+
+    uint16_t boundPort(int fd) {
+        sockaddr_storage address{};
+        socklen_t len = sizeof(address);
+        if (getsockname(fd, reinterpret_cast<sockaddr *>(&address), &len) != 0) {
+            return 0;
+        }
+        if (address.ss_family == AF_INET) {
+            return ntohs(reinterpret_cast<sockaddr_in *>(&address)->sin_port);
+        }
+        return ntohs(reinterpret_cast<sockaddr_in6 *>(&address)->sin6_port);
+    }
+
+    // 转发查询的应答在解析器的I/O线程中构造，每个线程复用一个缓冲区
+    uint8_t *replyBuffer() {
+        thread_local std::vector<uint8_t> buffer(DNSStubServer::MAX_MESSAGE_SIZE);
+        return buffer.data();
+    }
+}// namespace
+
+struct DNSStubServer::Query {
+    uint16_t id{};
+    uint16_t flags{};
+    uint16_t qtype{};
+    bool edns{false};
+    uint16_t udp_payload{0};// 客户端在OPT记录中声明的UDP载荷上限
+    size_t limit{MIN_UDP_PAYLOAD};// 应答长度上限，超出时置TC位
+    uint8_t question[MAX_QUESTION_SIZE]{};// 原样复制到应答中的问题段
+    size_t question_size{0};
+};
+
+struct DNSStubServer::UdpWorker {
+    int fd{-1};
+    bool owns_fd{true};// 非Linux平台所有线程共用一个socket，只由第一个工作线程关闭
+    std::thread thread{};
+};
+
+struct DNSStubServer::TcpConnection {
+    std::mutex mutex;// 保护fd与closed，应答可能来自I/O线程
+    int fd{-1};
+    bool closed{false};
+    // 以下字段只由TCP线程访问
+    std::vector<uint8_t> buffer{};
+    std::chrono::steady_clock::time_point last_active{};
+
+    // 发送带长度前缀的应答。socket不可写时不等待，直接关闭连接，由客户端重试
+    void send(const uint8_t *data, size_t size) {
+#if !defined(DNS_STUB_SERVER_UNSUPPORTED)
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closed) {
+            return;
+        }
+        uint8_t prefix[2];
+        write16(prefix, static_cast<uint16_t>(size));
+        iovec iov[2]{{prefix, sizeof(prefix)}, {const_cast<uint8_t *>(data), size}};
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+        const ssize_t sent = ::sendmsg(fd, &msg, DNS_STUB_SEND_FLAGS);
+        if (sent != static_cast<ssize_t>(size + sizeof(prefix))) {
+            // 由TCP线程在读到连接关闭后释放fd
+            ::shutdown(fd, SHUT_RDWR);
+            closed = true;
+        }
+#endif
+    }
+
+    // 只由TCP线程调用
+    void close() {
+#if !defined(DNS_STUB_SERVER_UNSUPPORTED)
+        std::lock_guard<std::mutex> lock(mutex);
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        closed = true;
+#endif
+    }
+};
+
+DNSStubServer::DNSStubServer(std::shared_ptr<DNSResolver> resolver, Options options)
+    : resolver_(std::move(resolver)), options_(std::move(options)) {
+}
+
+DNSStubServer::DNSStubServer(std::shared_ptr<DNSResolver> resolver)
+    : DNSStubServer(std::move(resolver), Options{}) {
+}
+
+DNSStubServer::~DNSStubServer() {
+    stop();
+}
+
+bool DNSStubServer::running() const {
+    return running_;
+}
+
+uint16_t DNSStubServer::port() const {
+    return port_;
+}
+
+DNSStubServer::Stats DNSStubServer::getStats() const {
+    Stats stats;
+    stats.queries = queries_.load(std::memory_order_relaxed);
+    stats.cache_hits = cache_hits_.load(std::memory_order_relaxed);
+    stats.forwarded = forwarded_.load(std::memory_order_relaxed);
+    stats.malformed = malformed_.load(std::memory_order_relaxed);
+    stats.unsupported = unsupported_.load(std::memory_order_relaxed);
+    stats.truncated = truncated_.load(std::memory_order_relaxed);
+    stats.overloaded = overloaded_.load(std::memory_order_relaxed);
+    stats.tcp_connections = tcp_connections_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void DNSStubServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    for (auto &worker: udp_workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    if (tcp_thread_.joinable()) {
+        tcp_thread_.join();
+    }
+    // 转发查询的回调仍会使用UDP socket发送应答
+    {
+        std::unique_lock<std::mutex> lock(pending_mutex_);
+        pending_cv_.wait(lock, [this] { return pending_ == 0; });
+    }
+    closeSockets();
+}
+
+#if defined(DNS_STUB_SERVER_UNSUPPORTED)
+
+bool DNSStubServer::start() {
+    std::cerr << "DNS stub server is not supported on this platform" << std::endl;
+    return false;
+}
+
+void DNSStubServer::closeSockets() {
+}
+
+#else
+
+bool DNSStubServer::start() {
+    if (running_) {
+        return true;
+    }
+    if (!resolver_) {
+        std::cerr << "DNS stub server requires a resolver" << std::endl;
+        return false;
+    }
+    sockaddr_storage address{};
+    socklen_t address_len = 0;
+    if (!parseAddress(options_.address, options_.port, address, address_len)) {
+        std::cerr << "Invalid DNS stub server address: " << options_.address << std::endl;
+        return false;
+    }
+    if (!openUdpSockets(address, address_len)) {
+        closeSockets();
+        return false;
+    }
+    // 端口为0时TCP与UDP使用相同的实际端口
+    setPort(address, port_);
+    if (options_.tcp_enabled && !openTcpSocket(address, address_len)) {
+        closeSockets();
+        return false;
+    }
+
+    running_ = true;
+    for (auto &worker: udp_workers_) {
+        worker->thread = std::thread(&DNSStubServer::runUdp, this, std::ref(*worker));
+    }
+    if (tcp_fd_ >= 0) {
+        tcp_thread_ = std::thread(&DNSStubServer::runTcp, this);
+    }
+    return true;
+}
+
+bool DNSStubServer::openUdpSockets(const sockaddr_storage &address, socklen_t address_len) {
+    const size_t threads = options_.udp_threads > 0
+                                   ? options_.udp_threads
+                                   : std::max<size_t>(1, std::thread::hardware_concurrency());
+    sockaddr_storage bind_address = address;
+    port_ = options_.port;
+    for (size_t i = 0; i < threads; ++i) {
+        auto worker = std::make_unique<UdpWorker>();
+#if !defined(DNS_STUB_SERVER_MMSG)
+        if (i > 0) {
+            worker->fd = udp_workers_.front()->fd;
+            worker->owns_fd = false;
+            udp_workers_.push_back(std::move(worker));
+            continue;
+        }
+#endif
+        const int fd = ::socket(address.ss_family, SOCK_DGRAM, 0);
+        if (fd < 0) {
+            std::cerr << "Failed to create UDP socket: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        worker->fd = fd;
+        udp_workers_.push_back(std::move(worker));
+#if defined(DNS_STUB_SERVER_MMSG)
+        // 每个工作线程一个socket，由内核按四元组把报文分散到各socket
+        const int one = 1;
+        if (threads > 1 && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+            std::cerr << "Failed to set SO_REUSEPORT: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+#endif
+        const timeval timeout{0, POLL_INTERVAL_MS * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        if (::bind(fd, reinterpret_cast<const sockaddr *>(&bind_address), address_len) != 0) {
+            std::cerr << "Failed to bind UDP socket to " << options_.address << ":" << port_ << ": "
+                      << std::strerror(errno) << std::endl;
+            return false;
+        }
+        if (port_ == 0) {
+            port_ = boundPort(fd);
+            setPort(bind_address, port_);
+        }
+    }
+    return true;
+}
+
+bool DNSStubServer::openTcpSocket(const sockaddr_storage &address, socklen_t address_len) {
+    tcp_fd_ = ::socket(address.ss_family, SOCK_STREAM, 0);
+    if (tcp_fd_ < 0) {
+        std::cerr << "Failed to create TCP socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    const int one = 1;
+    setsockopt(tcp_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    fcntl(tcp_fd_, F_SETFL, fcntl(tcp_fd_, F_GETFL, 0) | O_NONBLOCK);
+    if (::bind(tcp_fd_, reinterpret_cast<const sockaddr *>(&address), address_len) != 0 ||
+        ::listen(tcp_fd_, SOMAXCONN) != 0) {
+        std::cerr << "Failed to listen on TCP " << options_.address << ":" << port_ << ": "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void DNSStubServer::closeSockets() {
+    for (auto &worker: udp_workers_) {
+        if (worker->owns_fd && worker->fd >= 0) {
+            ::close(worker->fd);
+        }
+    }
+    udp_workers_.clear();
+    if (tcp_fd_ >= 0) {
+        ::close(tcp_fd_);
+        tcp_fd_ = -1;
+    }
+}
+
+void DNSStubServer::runUdp(UdpWorker &worker) {
+    const int fd = worker.fd;
+    const size_t reply_capacity = std::max<size_t>(options_.max_udp_payload, MIN_UDP_PAYLOAD);
+    Query query;
+    std::string hostname;
+    DNSResolver::ResolveResult scratch;
+
+    auto forward_udp = [this, fd, &query, &hostname](const sockaddr_storage &peer, socklen_t peer_len) {
+        forward(query, hostname, [fd, peer, peer_len](const uint8_t *data, size_t size) {
+            ::sendto(fd, data, size, 0, reinterpret_cast<const sockaddr *>(&peer), peer_len);
+        });
+    };
+
+#if defined(DNS_STUB_SERVER_MMSG)
+    // 接收与发送缓冲区按批次大小一次性分配，命中缓存的应答直接写入发送槽位
+    const size_t batch = std::max<size_t>(1, options_.batch_size);
+    std::vector<uint8_t> rx_buffers(batch * MAX_QUERY_SIZE);
+    std::vector<uint8_t> tx_buffers(batch * reply_capacity);
+    std::vector<sockaddr_storage> peers(batch);
+    std::vector<iovec> rx_iov(batch);
+    std::vector<iovec> tx_iov(batch);
+    std::vector<mmsghdr> rx_msgs(batch);
+    std::vector<mmsghdr> tx_msgs(batch);
+    for (size_t i = 0; i < batch; ++i) {
+        rx_iov[i] = {rx_buffers.data() + i * MAX_QUERY_SIZE, MAX_QUERY_SIZE};
+        rx_msgs[i] = {};
+        rx_msgs[i].msg_hdr.msg_iov = &rx_iov[i];
+        rx_msgs[i].msg_hdr.msg_iovlen = 1;
+        rx_msgs[i].msg_hdr.msg_name = &peers[i];
+        tx_msgs[i] = {};
+        tx_msgs[i].msg_hdr.msg_iov = &tx_iov[i];
+        tx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (running_) {
+        for (size_t i = 0; i < batch; ++i) {
+            rx_msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+            rx_msgs[i].msg_hdr.msg_flags = 0;
+        }
+        const int received = ::recvmmsg(fd, rx_msgs.data(), static_cast<unsigned int>(batch), MSG_WAITFORONE, nullptr);
+        if (received <= 0) {
+            if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && running_) {
+                std::cerr << "Error receiving DNS queries: " << std::strerror(errno) << std::endl;
+            }
+            continue;
+        }
+
+        size_t replies = 0;
+        for (int i = 0; i < received; ++i) {
+            const auto &header = rx_msgs[i].msg_hdr;
+            if (header.msg_flags & MSG_TRUNC) {
+                queries_.fetch_add(1, std::memory_order_relaxed);
+                malformed_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            uint8_t *reply = tx_buffers.data() + replies * reply_capacity;
+            size_t reply_size = 0;
+            switch (process(rx_buffers.data() + i * MAX_QUERY_SIZE, rx_msgs[i].msg_len, false, query, hostname,
+                            scratch, reply, reply_size)) {
+                case Disposition::Reply:
+                    tx_iov[replies] = {reply, reply_size};
+                    tx_msgs[replies].msg_hdr.msg_name = &peers[i];
+                    tx_msgs[replies].msg_hdr.msg_namelen = header.msg_namelen;
+                    ++replies;
+                    break;
+                case Disposition::Forward:
+                    forward_udp(peers[i], header.msg_namelen);
+                    break;
+                case Disposition::Drop:
+                    break;
+            }
+        }
+
+        size_t sent = 0;
+        while (sent < replies) {
+            const int n = ::sendmmsg(fd, tx_msgs.data() + sent, static_cast<unsigned int>(replies - sent), 0);
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            sent += static_cast<size_t>(n);
+        }
+    }
+#else
+    std::vector<uint8_t> rx_buffer(MAX_QUERY_SIZE);
+    std::vector<uint8_t> tx_buffer(reply_capacity);
+    sockaddr_storage peer{};
+    while (running_) {
+        socklen_t peer_len = sizeof(peer);
+        const ssize_t received = ::recvfrom(fd, rx_buffer.data(), rx_buffer.size(), 0,
+                                            reinterpret_cast<sockaddr *>(&peer), &peer_len);
+        if (received < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && running_) {
+                std::cerr << "Error receiving DNS queries: " << std::strerror(errno) << std::endl;
+            }
+            continue;
+        }
+        size_t reply_size = 0;
+        switch (process(rx_buffer.data(), static_cast<size_t>(received), false, query, hostname, scratch,
+                        tx_buffer.data(), reply_size)) {
+            case Disposition::Reply:
+                ::sendto(fd, tx_buffer.data(), reply_size, 0, reinterpret_cast<const sockaddr *>(&peer), peer_len);
+                break;
+            case Disposition::Forward:
+                forward_udp(peer, peer_len);
+                break;
+            case Disposition::Drop:
+                break;
+        }
+    }
+#endif
+}
+
+void DNSStubServer::runTcp() {
+    std::vector<std::shared_ptr<TcpConnection>> connections;
+    std::vector<pollfd> fds;
+    std::vector<uint8_t> reply(MAX_MESSAGE_SIZE);
+    Query query;
+    std::string hostname;
+    DNSResolver::ResolveResult scratch;
+    constexpr size_t READ_CHUNK = 4096;
+
+    while (running_) {
+        fds.clear();
+        fds.push_back({tcp_fd_, POLLIN, 0});
+        for (const auto &connection: connections) {
+            fds.push_back({connection->fd, POLLIN, 0});
+        }
+        const int ready = ::poll(fds.data(), static_cast<nfds_t>(fds.size()), POLL_INTERVAL_MS);
+        if (ready < 0 && errno != EINTR) {
+            std::cerr << "Error polling DNS stub TCP sockets: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        const auto now = std::chrono::steady_clock::now();
+
+        // fds[i + 1]对应connections[i]
+        for (size_t i = 0; i < connections.size(); ++i) {
+            const auto &connection = connections[i];
+            if (ready <= 0 || fds[i + 1].revents == 0) {
+                if (now - connection->last_active > options_.tcp_idle_timeout) {
+                    connection->close();
+                }
+                continue;
+            }
+            auto &buffer = connection->buffer;
+            const size_t offset = buffer.size();
+            buffer.resize(offset + READ_CHUNK);
+            const ssize_t n = ::recv(connection->fd, buffer.data() + offset, READ_CHUNK, MSG_DONTWAIT);
+            if (n <= 0) {
+                buffer.resize(offset);
+                if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                    connection->close();
+                }
+                continue;
+            }
+            buffer.resize(offset + static_cast<size_t>(n));
+            connection->last_active = now;
+
+            // 处理缓冲区中所有完整的报文（支持流水线查询）
+            size_t consumed = 0;
+            while (buffer.size() - consumed >= 2) {
+                const size_t length = read16(buffer.data() + consumed);
+                if (buffer.size() - consumed - 2 < length) {
+                    break;
+                }
+                const uint8_t *message = buffer.data() + consumed + 2;
+                consumed += 2 + length;
+                size_t reply_size = 0;
+                switch (process(message, length, true, query, hostname, scratch, reply.data(), reply_size)) {
+                    case Disposition::Reply:
+                        connection->send(reply.data(), reply_size);
+                        break;
+                    case Disposition::Forward:
+                        forward(query, hostname, [connection](const uint8_t *data, size_t size) {
+                            connection->send(data, size);
+                        });
+                        break;
+                    case Disposition::Drop:
+                        break;
+                }
+            }
+            buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(consumed));
+        }
+        std::erase_if(connections, [](const std::shared_ptr<TcpConnection> &connection) {
+            return connection->fd < 0;
+        });
+
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            while (true) {
+                const int fd = ::accept(tcp_fd_, nullptr, nullptr);
+                if (fd < 0) {
+                    break;
+                }
+                if (connections.size() >= options_.max_tcp_connections) {
+                    ::close(fd);
+                    continue;
+                }
+                auto connection = std::make_shared<TcpConnection>();
+                connection->fd = fd;
+                connection->last_active = now;
+                connections.push_back(std::move(connection));
+                tcp_connections_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    for (const auto &connection: connections) {
+        connection->close();
+    }
+}
+
+#endif
+
+DNSStubServer::Disposition DNSStubServer::process(const uint8_t *data, size_t size, bool tcp, Query &query,
+                                                  std::string &hostname, DNSResolver::ResolveResult &scratch,
+                                                  uint8_t *out, size_t &out_size) {
+    queries_.fetch_add(1, std::memory_order_relaxed);
+    const int rcode = parseQuery(data, size, query, hostname);
+    if (rcode < 0) {
+        malformed_.fetch_add(1, std::memory_order_relaxed);
+        return Disposition::Drop;
+    }
+    if (tcp) {
+        query.limit = MAX_MESSAGE_SIZE;
+    } else if (query.edns) {
+        query.limit = std::clamp<size_t>(query.udp_payload, MIN_UDP_PAYLOAD,
+                                         std::max<size_t>(options_.max_udp_payload, MIN_UDP_PAYLOAD));
+    } else {
+        query.limit = MIN_UDP_PAYLOAD;
+    }
+
+    bool truncated = false;
+    if (rcode != RCODE_NOERROR) {
+        (rcode == RCODE_FORMERR ? malformed_ : unsupported_).fetch_add(1, std::memory_order_relaxed);
+        out_size = buildResponse(query, rcode, nullptr, out, truncated);
+        return Disposition::Reply;
+    }
+    // 按问题的类型查对应地址族的缓存，不使用合并后的双栈结果，避免另一地址族的记录被当作本地址族的NODATA
+    if (!resolver_->resolve_cached(hostname, query.qtype == TYPE_AAAA ? AF_INET6 : AF_INET, scratch)) {
+        return Disposition::Forward;
+    }
+    cache_hits_.fetch_add(1, std::memory_order_relaxed);
+    out_size = buildResponse(query, responseCode(scratch), &scratch, out, truncated);
+    if (truncated) {
+        truncated_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return Disposition::Reply;
+}
+
+void DNSStubServer::forward(const Query &query, const std::string &hostname, ReplySender sender) {
+    bool admitted = false;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        if (pending_ < options_.max_pending) {
+            ++pending_;
+            admitted = true;
+        }
+    }
+    if (!admitted) {
+        overloaded_.fetch_add(1, std::memory_order_relaxed);
+        bool truncated = false;
+        uint8_t *buffer = replyBuffer();
+        sender(buffer, buildResponse(query, RCODE_SERVFAIL, nullptr, buffer, truncated));
+        return;
+    }
+
+    forwarded_.fetch_add(1, std::memory_order_relaxed);
+    const int family = query.qtype == TYPE_AAAA ? AF_INET6 : AF_INET;
+    resolver_->resolve_miss_async(hostname, family, [this, query, sender = std::move(sender)](
+                                                            const DNSResolver::ResolveResult &result) {
+        bool truncated = false;
+        uint8_t *buffer = replyBuffer();
+        const size_t size = buildResponse(query, responseCode(result), &result, buffer, truncated);
+        if (truncated) {
+            truncated_.fetch_add(1, std::memory_order_relaxed);
+        }
+        sender(buffer, size);
+        finishPending();
+    });
+}
+
+void DNSStubServer::finishPending() {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    if (--pending_ == 0) {
+        pending_cv_.notify_all();
+    }
+}
+
+int DNSStubServer::parseQuery(const uint8_t *data, size_t size, Query &query, std::string &hostname) {
+    if (size < HEADER_SIZE) {
+        return -1;
+    }
+    query.id = read16(data);
+    query.flags = read16(data + 2);
+    query.qtype = 0;
+    query.edns = false;
+    query.udp_payload = 0;
+    query.question_size = 0;
+    if (query.flags & FLAG_QR) {
+        return -1;
+    }
+    if (((query.flags >> 11) & 0x0F) != 0) {
+        return RCODE_NOTIMP;
+    }
+    if (read16(data + 4) != 1) {
+        return RCODE_FORMERR;
+    }
+
+    // 问题段的名称不应使用压缩指针，标签中出现'.'或NUL的名称无法作为主机名查询
+    hostname.clear();
+    bool valid_hostname = true;
+    size_t pos = HEADER_SIZE;
+    while (true) {
+        if (pos >= size) {
+            return RCODE_FORMERR;
+        }
+        const uint8_t length = data[pos];
+        if (length == 0) {
+            ++pos;
+            break;
+        }
+        if (length > 63 || pos + 1 + length > size || pos - HEADER_SIZE + length + 2 > MAX_NAME_SIZE) {
+            return RCODE_FORMERR;
+        }
+        if (!hostname.empty()) {
+            hostname.push_back('.');
+        }
+        for (size_t i = pos + 1; i <= pos + length; ++i) {
+            char c = static_cast<char>(data[i]);
+            if (c == '.' || c == '\0') {
+                valid_hostname = false;
+            }
+            if (c >= 'A' && c <= 'Z') {
+                c = static_cast<char>(c - 'A' + 'a');
+            }
+            hostname.push_back(c);
+        }
+        pos += 1 + length;
+    }
+    if (pos + 4 > size) {
+        return RCODE_FORMERR;
+    }
+    query.qtype = read16(data + pos);
+    const uint16_t qclass = read16(data + pos + 2);
+    pos += 4;
+    query.question_size = pos - HEADER_SIZE;
+    std::memcpy(query.question, data + HEADER_SIZE, query.question_size);
+
+    // 只在没有应答与授权段时查找紧随问题段的OPT记录
+    if (read16(data + 6) == 0 && read16(data + 8) == 0 && read16(data + 10) > 0 && pos + 11 <= size &&
+        data[pos] == 0 && read16(data + pos + 1) == TYPE_OPT) {
+        query.edns = true;
+        query.udp_payload = read16(data + pos + 3);
+    }
+
+    if (qclass != CLASS_IN || hostname.empty() || !valid_hostname) {
+        return RCODE_REFUSED;
+    }
+    if (query.qtype != TYPE_A && query.qtype != TYPE_AAAA) {
+        return RCODE_NOTIMP;
+    }
+    return RCODE_NOERROR;
+}
+
+size_t DNSStubServer::buildResponse(const Query &query, int rcode, const DNSResolver::ResolveResult *result,
+                                    uint8_t *out, bool &truncated) const {
+    const int family = query.qtype == TYPE_AAAA ? AF_INET6 : AF_INET;
+    // 压缩名称(2) + TYPE(2) + CLASS(2) + TTL(4) + RDLENGTH(2) + RDATA
+    const size_t record_size = 12 + (family == AF_INET6 ? sizeof(in6_addr) : sizeof(in_addr));
+    const size_t opt_size = query.edns ? 11 : 0;
+
+    size_t answers = 0;
+    if (result && rcode == RCODE_NOERROR) {
+        for (const auto &address: result->ip_addresses) {
+            if (address.family() == family) {
+                ++answers;
+            }
+        }
+    }
+    truncated = HEADER_SIZE + query.question_size + answers * record_size + opt_size > query.limit;
+    if (truncated) {
+        answers = 0;
+    }
+
+    const auto flags = static_cast<uint16_t>(FLAG_QR | FLAG_RA | (query.flags & (FLAG_RD | 0x7800)) |
+                                             (truncated ? FLAG_TC : 0) | (rcode & 0x0F));
+    write16(out, query.id);
+    write16(out + 2, flags);
+    write16(out + 4, query.question_size > 0 ? 1 : 0);
+    write16(out + 6, static_cast<uint16_t>(answers));
+    write16(out + 8, 0);
+    write16(out + 10, query.edns ? 1 : 0);
+    size_t pos = HEADER_SIZE;
+    std::memcpy(out + pos, query.question, query.question_size);
+    pos += query.question_size;
+
+    if (answers > 0) {
+        const auto ttl = static_cast<uint32_t>(std::clamp<int64_t>(result->ttl.count(), 0, INT32_MAX));
+        for (const auto &address: result->ip_addresses) {
+            if (address.family() != family) {
+                continue;
+            }
+            write16(out + pos, 0xC00C);// 指向问题段的名称
+            write16(out + pos + 2, query.qtype);
+            write16(out + pos + 4, CLASS_IN);
+            write32(out + pos + 6, ttl);
+            write16(out + pos + 10, static_cast<uint16_t>(address.size()));
+            std::memcpy(out + pos + 12, address.data(), address.size());
+            pos += 12 + address.size();
+        }
+    }
+
+    if (query.edns) {
+        out[pos] = 0;
+        write16(out + pos + 1, TYPE_OPT);
+        write16(out + pos + 3, std::max<uint16_t>(options_.max_udp_payload, MIN_UDP_PAYLOAD));
+        write32(out + pos + 5, 0);
+        write16(out + pos + 9, 0);
+        pos += opt_size;
+    }
+    return pos;
+}
+
+int DNSStubServer::responseCode(const DNSResolver::ResolveResult &result) {
+    switch (result.status) {
+        case ARES_SUCCESS:
+        case ARES_ENODATA:
+            return RCODE_NOERROR;
+        case ARES_ENOTFOUND:
+            return RCODE_NXDOMAIN;
+        default:
+            return RCODE_SERVFAIL;
+    }
+}
@@ -0,0 +1,294 @@
+#include "DNSUpstreamSelector.h"
+
+#include <algorithm>
+#include <random>
+
+DNSUpstreamSelector::DNSUpstreamSelector()
+    : rng_state_(std::random_device{}() | 1) {
+    config_ = DNSResolverConfig().upstream();
+}
+
+void DNSUpstreamSelector::reset(const std::vector<Upstream> &upstreams) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    servers_.clear();
+    servers_.reserve(std::min(upstreams.size(), MAX_UPSTREAMS));
+    for (const auto &upstream: upstreams) {
+        if (servers_.size() == MAX_UPSTREAMS) {
+            break;
+        }
+        Server server;
+        server.name = upstream.name;
+        server.weight = std::max<uint32_t>(1, upstream.weight);
+        servers_.push_back(std::move(server));
+    }
+    candidates_.reserve(servers_.size());
+}
+
+bool DNSUpstreamSelector::update(const std::vector<Upstream> &upstreams) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (upstreams.size() != servers_.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < servers_.size(); ++i) {
+        auto &server = servers_[i];
+        if (server.name != upstreams[i].name) {
+            // 在途计数属于同一个channel，保留以便结果到达时正确递减
+            const uint32_t in_flight = server.in_flight;
+            server = Server{};
+            server.name = upstreams[i].name;
+            server.in_flight = in_flight;
+        }
+        server.weight = std::max<uint32_t>(1, upstreams[i].weight);
+    }
+    return true;
+}
+
+void DNSUpstreamSelector::configure(const UpstreamConfig &config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+}
+
+size_t DNSUpstreamSelector::select(uint32_t tried) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const size_t count = servers_.size();
+    if (count <= 1) {
+        if (count == 1) {
+            ++servers_[0].in_flight;
+            ++servers_[0].selected;
+        }
+        return 0;
+    }
+
+    const uint32_t all = count >= 32 ? ~uint32_t{0} : (uint32_t{1} << count) - 1;
+    if ((tried & all) == all) {
+        tried = 0;
+    }
+    const auto untried = [tried](size_t i) { return (tried & (uint32_t{1} << i)) == 0; };
+    const auto now = Clock::now();
+
+    size_t chosen = count;
+    // 摘除到期的上游优先放行一个查询作为探测
+    for (size_t i = 0; i < count && chosen == count; ++i) {
+        if (untried(i) && servers_[i].state == State::Ejected && now >= servers_[i].ejected_until) {
+            servers_[i].state = State::Probing;
+            chosen = i;
+        }
+    }
+
+    if (chosen == count) {
+        candidates_.clear();
+        uint64_t total_weight = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (untried(i) && servers_[i].state == State::Healthy) {
+                candidates_.push_back(i);
+                total_weight += servers_[i].weight;
+            }
+        }
+
+        if (candidates_.empty()) {
+            // 没有健康的上游时退而选择最早恢复的一个
+            for (size_t i = 0; i < count; ++i) {
+                if (untried(i) && (chosen == count || servers_[i].ejected_until < servers_[chosen].ejected_until)) {
+                    chosen = i;
+                }
+            }
+        } else if (candidates_.size() == 1 || config_.selection == "weighted") {
+            chosen = pickWeighted(candidates_, total_weight);
+        } else {
+            // P2C：按权重随机抽取两个不同的上游，取代价较低者
+            const size_t first = pickWeighted(candidates_, total_weight);
+            size_t second = first;
+            for (int i = 0; i < 4 && second == first; ++i) {
+                second = pickWeighted(candidates_, total_weight);
+            }
+            chosen = cost(servers_[second]) < cost(servers_[first]) ? second : first;
+        }
+    }
+
+    ++servers_[chosen].in_flight;
+    ++servers_[chosen].selected;
+    return chosen;
+}
+
+void DNSUpstreamSelector::onResult(size_t index, bool server_ok, std::chrono::microseconds rtt) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index >= servers_.size()) {
+        return;
+    }
+    auto &server = servers_[index];
+    if (server.in_flight > 0) {
+        --server.in_flight;
+    }
+    const double alpha = config_.rtt_ewma_alpha;
+    const auto now = Clock::now();
+
+    if (server_ok) {
+        const auto sample = static_cast<double>(rtt.count());
+        // 探测成功后以新样本重新开始平滑，否则摘除前的高RTT会让它立即再次被摘除
+        if (!server.has_rtt || server.state == State::Probing) {
+            server.rtt_us = sample;
+            server.has_rtt = true;
+        } else {
+            server.rtt_us += alpha * (sample - server.rtt_us);
+        }
+        ++server.samples;
+        server.error_rate *= 1.0 - alpha;
+        server.consecutive_failures = 0;
+
+        if (server.state == State::Probing) {
+            if (isLatencyOutlier(index)) {
+                eject(server, now);
+            } else {
+                server.state = State::Healthy;
+                server.ejection_time = std::chrono::milliseconds{0};
+            }
+        } else if (server.state == State::Healthy && isLatencyOutlier(index) && canEject()) {
+            eject(server, now);
+        }
+        return;
+    }
+
+    ++server.failures;
+    server.error_rate += alpha * (1.0 - server.error_rate);
+    ++server.consecutive_failures;
+    if (server.state == State::Probing) {
+        eject(server, now);
+    } else if (server.state == State::Healthy && server.consecutive_failures >= config_.failure_threshold &&
+               canEject()) {
+        eject(server, now);
+    }
+}
+
+void DNSUpstreamSelector::onAbandon(size_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index >= servers_.size()) {
+        return;
+    }
+    auto &server = servers_[index];
+    if (server.in_flight > 0) {
+        --server.in_flight;
+    }
+    // 探测没有结果，回到摘除状态等待下一次探测
+    if (server.state == State::Probing) {
+        server.state = State::Ejected;
+    }
+}
+
+bool DNSUpstreamSelector::hasAlternative(uint32_t tried) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto now = Clock::now();
+    for (size_t i = 0; i < servers_.size(); ++i) {
+        if (tried & (uint32_t{1} << i)) {
+            continue;
+        }
+        const auto &server = servers_[i];
+        if (server.state == State::Healthy || (server.state == State::Ejected && now >= server.ejected_until)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::chrono::microseconds DNSUpstreamSelector::smoothedRtt(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index >= servers_.size() || !servers_[index].has_rtt) {
+        return std::chrono::microseconds{0};
+    }
+    return std::chrono::microseconds{static_cast<int64_t>(servers_[index].rtt_us)};
+}
+
+std::string DNSUpstreamSelector::name(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index < servers_.size() ? servers_[index].name : std::string();
+}
+
+size_t DNSUpstreamSelector::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return servers_.size();
+}
+
+std::vector<DNSUpstreamSelector::UpstreamStats> DNSUpstreamSelector::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<UpstreamStats> result;
+    result.reserve(servers_.size());
+    for (const auto &server: servers_) {
+        UpstreamStats stats;
+        stats.name = server.name;
+        stats.weight = server.weight;
+        stats.rtt_ms = server.has_rtt ? server.rtt_us / 1000.0 : 0.0;
+        stats.error_rate = server.error_rate;
+        stats.in_flight = server.in_flight;
+        stats.ejected = server.state != State::Healthy;
+        stats.selected = server.selected;
+        stats.failures = server.failures;
+        stats.ejections = server.ejections;
+        result.push_back(std::move(stats));
+    }
+    return result;
+}
+
+double DNSUpstreamSelector::cost(const Server &server) const {
+    // 还没有RTT样本的上游代价最低，从而尽快获得样本
+    const double rtt = server.has_rtt ? server.rtt_us : 0.0;
+    return (rtt + 1.0) * (server.in_flight + 1) * (1.0 + ERROR_PENALTY * server.error_rate) / server.weight;
+}
+
+size_t DNSUpstreamSelector::pickWeighted(const std::vector<size_t> &candidates, uint64_t total_weight) {
+    uint64_t target = nextRandom() % total_weight;
+    for (const auto i: candidates) {
+        if (target < servers_[i].weight) {
+            return i;
+        }
+        target -= servers_[i].weight;
+    }
+    return candidates.back();
+}
+
+void DNSUpstreamSelector::eject(Server &server, Clock::time_point now) {
+    const std::chrono::milliseconds base{config_.ejection_time_ms};
+    const std::chrono::milliseconds max{config_.max_ejection_time_ms};
+    server.ejection_time = server.ejection_time.count() == 0 ? base : std::min(server.ejection_time * 2, max);
+    server.ejected_until = now + server.ejection_time;
+    server.state = State::Ejected;
+    server.consecutive_failures = 0;
+    ++server.ejections;
+}
+
+bool DNSUpstreamSelector::canEject() const {
+    // 最多摘除一半的上游
+    size_t ejected = 0;
+    for (const auto &server: servers_) {
+        if (server.state != State::Healthy) {
+            ++ejected;
+        }
+    }
+    return (ejected + 1) * 2 <= servers_.size();
+}
+
+bool DNSUpstreamSelector::isLatencyOutlier(size_t index) const {
+    const auto &server = servers_[index];
+    if (config_.latency_outlier_factor <= 0.0 || server.samples < MIN_OUTLIER_SAMPLES) {
+        return false;
+    }
+    std::vector<double> others;
+    for (size_t i = 0; i < servers_.size(); ++i) {
+        if (i != index && servers_[i].state == State::Healthy && servers_[i].samples >= MIN_OUTLIER_SAMPLES) {
+            others.push_back(servers_[i].rtt_us);
+        }
+    }
+    if (others.empty()) {
+        return false;
+    }
+    const auto middle = others.begin() + static_cast<std::ptrdiff_t>(others.size() / 2);
+    std::nth_element(others.begin(), middle, others.end());
+    const double median = *middle;
+    return server.rtt_us > config_.latency_outlier_factor * median && server.rtt_us - median > MIN_OUTLIER_GAP_US;
+}
+
+uint64_t DNSUpstreamSelector::nextRandom() {
+    // xorshift64*，调用方持有mutex_
+    rng_state_ ^= rng_state_ >> 12;
+    rng_state_ ^= rng_state_ << 25;
+    rng_state_ ^= rng_state_ >> 27;
+    return rng_state_ * 0x2545F4914F6CDD1DULL;
+}